@@ -2,7 +2,8 @@
  * Pybind11 bindings for Corridors MCTS implementation.
  * 
  * This module provides Python bindings for the C++ MCTS engine using pybind11.
- * The module exports a class _corridors_mcts that wraps the MCTS functionality.
+ * The module exports a class _corridors_mcts that wraps the MCTS functionality, and
+ * _corridors_mcts_7x7 and _corridors_mcts_5x5 that do the same for the smaller boards.
  */
 
 #include <pybind11/pybind11.h>
@@ -13,19 +14,45 @@
 #include <memory>
 #include <random>
 #include <tuple>
+#include <algorithm>
 #include <optional>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <mutex>
+#include <exception>
 
 #include "board.h"
 #include "mcts.hpp"
+#include "self_play.hpp"
+#include "search_pool.hpp"
 
 namespace py = pybind11;
 
 /**
- * Python-facing MCTS wrapper class that matches the interface defined in _corridors_mcts.pyi
+ * Cancellation flag that can be raised from Python while a search runs with the GIL released.
+ * Mirrors the threading.Event interface so it can stand in for one.
  */
-class _corridors_mcts {
+class cancel_token {
 private:
-    std::shared_ptr<mcts::uct_node<corridors::board>> root_node;
+    std::atomic<bool> flag{false};
+
+public:
+    void set() { flag.store(true); }
+    void clear() { flag.store(false); }
+    bool is_set() const { return flag.load(); }
+    const std::atomic<bool> * get() const { return &flag; }
+};
+
+/**
+ * Python-facing MCTS wrapper class that matches the interface defined in _corridors_mcts.pyi,
+ * for games on a board of type B (see corridors::basic_board)
+ */
+template <typename B>
+class basic_corridors_mcts {
+private:
+    std::shared_ptr<mcts::uct_node<B>> root_node;
     mcts::Rand random_generator;
     
     // MCTS configuration parameters
@@ -35,47 +62,124 @@ private:
     bool use_puct;
     bool use_probs;
     bool decide_using_visits;
+    size_t threads;
+    mcts::parallelism parallelism; // how the threads share a search
+    double early_stop; // 0, or the factor searches stop early by (see mcts::early_stop)
+    size_t memory_budget; // bytes per tree, 0 for no limit
+    bool collect_stats;
+    std::unique_ptr<mcts::transposition_table> table; // null unless enabled
+    typename B::rollout_policy rollout_policy;
+    std::unique_ptr<mcts::batch_evaluator<B>> evaluator; // null unless set
+    std::unique_ptr<mcts::reclaimer> reclaimer; // null unless discarded trees are freed in the background
+    std::unique_ptr<mcts::rollout_pool<B>> rollouts; // null unless searches are leaf-parallel; plays their other threads' rollouts
+    std::unique_ptr<mcts::opening_book<B>> book; // null unless set; seeds each new root
+    size_t reused_visits = 0; // visits carried over by the last move
+    size_t discarded_visits = 0; // visits thrown away with the old root's other subtrees
+    
+    // pondering: a background search of the current root, stopped by anything that changes
+    // the tree or the search settings (read-only queries can run alongside it)
+    std::thread ponder_thread;
+    std::atomic<bool> ponder_stop{false};
+    std::atomic<bool> ponder_running{false};
+    size_t ponder_simulations = 0;
+    std::exception_ptr ponder_error;
+    
+    // the search this engine last handed to an EnginePool (if the pool is still around), which
+    // anything that changes the tree or the search settings also stops
+    std::weak_ptr<mcts::search_pool> pool;
+    size_t pool_search = 0;
+    
+    // search counters, summed over every search (pondering included) since the last reset;
+    // the mutex lets them be read while a background search is adding to them
+    mcts::search_stats stats;
+    mutable std::mutex stats_mutex;
     
 public:
     /**
      * Initialize MCTS with configuration parameters.
      */
-    _corridors_mcts(
+    basic_corridors_mcts(
         double c,
         int seed,
         bool use_rollout,
         bool eval_children,
         bool use_puct,
         bool use_probs,
-        bool decide_using_visits
+        bool decide_using_visits,
+        int threads = 1,
+        int transposition_table_mb = 0,
+        const std::string& rollout_policy = "random",
+        double rollout_path_probability = 0.5,
+        bool background_reclaim = false,
+        int memory_budget_mb = 0,
+        bool collect_stats = false,
+        const std::string& parallelism = "tree",
+        double early_stop = 0.0
     ) : c_param(c),
         use_rollout(use_rollout),
         eval_children(eval_children),
         use_puct(use_puct),
         use_probs(use_probs),
         decide_using_visits(decide_using_visits),
-        random_generator(seed)
+        threads(threads > 1 ? static_cast<size_t>(threads) : 1),
+        parallelism(parse_parallelism(parallelism, use_rollout)),
+        early_stop(check_early_stop(early_stop, decide_using_visits)),
+        memory_budget(memory_budget_mb > 0 ? static_cast<size_t>(memory_budget_mb) << 20 : 0),
+        collect_stats(collect_stats),
+        random_generator(seed),
+        table(transposition_table_mb > 0
+            ? new mcts::transposition_table(static_cast<size_t>(transposition_table_mb))
+            : nullptr),
+        rollout_policy(parse_rollout_policy(rollout_policy, rollout_path_probability)),
+        reclaimer(background_reclaim ? new mcts::reclaimer() : nullptr),
+        rollouts(this->threads > 1 && this->parallelism == mcts::LEAF_PARALLEL
+            ? new mcts::rollout_pool<B>(this->threads, random_generator)
+            : nullptr)
     {
         // Initialize with starting board position
         reset_to_initial_state();
     }
     
+    ~basic_corridors_mcts() {
+        halt_background_search();
+    }
+    
     /**
      * Make a move in the game.
      * @param action String representation of the move
      * @param flip Whether to flip the perspective
      */
     void make_move(const std::string& action, bool flip = false) {
+        make_move_id(action_text_to_id(action), flip);
+    }
+    
+    /**
+     * Make a move in the game by action id.
+     * @param action_id Action id (0-80: pawn move to that square, 81-144: horizontal wall,
+     *                  145-208: vertical wall), as returned by get_legal_action_ids
+     * @param flip Whether to flip the perspective
+     */
+    void make_move_id(int action_id, bool flip = false) {
+        halt_background_search();
         if (!root_node) {
             throw std::runtime_error("MCTS not initialized");
         }
+        if (action_id < 0 || action_id >= static_cast<int>(B::POLICY_SIZE)) {
+            throw std::runtime_error("Invalid action id: " + std::to_string(action_id));
+        }
         
         // Find and make the move
-        auto new_node = root_node->make_move(action, flip);
+        std::shared_ptr<mcts::uct_node<B>> new_node;
+        try {
+            new_node = root_node->make_move_by_id(static_cast<size_t>(action_id), flip);
+        } catch (const std::string&) {
+            // not a legal move from this position
+        }
         if (!new_node) {
-            throw std::runtime_error("Invalid move: " + action);
+            throw std::runtime_error("Invalid move: " + B::action_id_to_text(action_id));
         }
-        root_node = new_node;
+        replace_root(std::move(new_node));
+        age_transposition_table();
     }
     
     /**
@@ -84,22 +188,27 @@ public:
      * @return Vector of move strings
      */
     std::vector<std::string> get_legal_moves(bool flip = false) {
+        std::vector<std::string> moves;
+        for (const int action_id : get_legal_action_ids(flip)) {
+            moves.push_back(B::action_id_to_text(action_id));
+        }
+        return moves;
+    }
+    
+    /**
+     * Get the action ids of the legal moves from the current position
+     * (in the same order as get_legal_moves).
+     * @param flip Whether to flip the perspective
+     * @return Vector of action ids
+     */
+    std::vector<int> get_legal_action_ids(bool flip = false) {
         if (!root_node) {
             throw std::runtime_error("MCTS not initialized");
         }
         
-        std::vector<std::string> moves;
-        
-        // Get legal moves from the board
-        std::vector<corridors::board> legal_positions;
-        root_node->get_state().get_legal_moves(legal_positions);
-        
-        // Convert to action strings
-        for (const auto& board : legal_positions) {
-            moves.push_back(board.get_action_text(flip));
-        }
-        
-        return moves;
+        std::vector<size_t> action_ids;
+        root_node->get_state().get_legal_action_ids(action_ids, flip);
+        return std::vector<int>(action_ids.begin(), action_ids.end());
     }
     
     /**
@@ -127,22 +236,66 @@ public:
         return result;
     }
     
+    /**
+     * Get sorted actions with visit counts, values, and action ids.
+     * @param flip Whether to flip the perspective
+     * @return Vector of tuples (visit_count, value, action_id)
+     */
+    std::vector<std::tuple<int, double, int>> get_sorted_action_ids(bool flip = false) {
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        
+        std::vector<std::tuple<int, double, int>> result;
+        for (const auto& action : root_node->get_sorted_action_ids(flip)) {
+            result.emplace_back(
+                static_cast<int>(std::get<0>(action)),
+                std::get<1>(action),
+                static_cast<int>(std::get<2>(action))
+            );
+        }
+        
+        return result;
+    }
+    
+    /**
+     * Convert an action id to its move string (e.g. 4 -> "*(4,0)").
+     */
+    static std::string action_id_to_text(int action_id) {
+        if (action_id < 0 || action_id >= static_cast<int>(B::POLICY_SIZE)) {
+            throw std::runtime_error("Invalid action id: " + std::to_string(action_id));
+        }
+        return B::action_id_to_text(static_cast<size_t>(action_id));
+    }
+    
+    /**
+     * Convert a move string to its action id (e.g. "H(0,0)" -> 81).
+     */
+    static int action_text_to_id(const std::string& action) {
+        try {
+            return static_cast<int>(B::action_text_to_id(action));
+        } catch (const std::string&) {
+            throw std::runtime_error("Invalid move: " + action);
+        }
+    }
+    
     /**
      * Choose the best action using epsilon-greedy selection.
      * @param epsilon Exploration probability
      * @return Action string
      */
     std::string choose_best_action(double epsilon = 0.0) {
+        halt_background_search();
         if (!root_node) {
             throw std::runtime_error("MCTS not initialized");
         }
         
-        auto best_node = root_node->choose_best_action(random_generator, epsilon, decide_using_visits);
-        if (!best_node) {
-            throw std::runtime_error("No valid actions available");
-        }
+        // the chosen child stays in the tree, so that its subtree is kept by the make_move
+        // that plays it
+        const size_t choice = root_node->select_best_action(random_generator, epsilon, decide_using_visits);
+        age_transposition_table();
         
-        return best_node->get_state().get_action_text(false);
+        return root_node->get_child_state(choice).get_action_text(false);
     }
     
     /**
@@ -150,23 +303,307 @@ public:
      * @param n Number of simulations to run
      */
     void run_simulations(int n) {
+        halt_background_search();
+        if (n <= 0) {
+            return;
+        }
+        search(static_cast<size_t>(n), mcts::NO_DEADLINE, nullptr, stopping_rule());
+    }
+    
+    /**
+     * Run MCTS simulations for a fixed amount of wall-clock time.
+     * @param milliseconds Time budget
+     * @return Number of simulations completed
+     */
+    int run_for(int milliseconds) {
+        halt_background_search();
+        if (milliseconds <= 0) {
+            return 0;
+        }
+        return search(
+            std::numeric_limits<size_t>::max(),
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(milliseconds),
+            nullptr,
+            stopping_rule()
+        );
+    }
+    
+    /**
+     * Run MCTS simulations until the simulation budget is spent, the time budget runs out,
+     * or the cancel token is set -- whichever comes first.
+     * @param n Maximum number of simulations to run
+     * @param milliseconds Optional time budget
+     * @param cancel Optional token that stops the search when set (from any thread)
+     * @return Number of simulations completed
+     */
+    int run_until(int n, std::optional<double> milliseconds, const cancel_token * cancel) {
+        halt_background_search();
+        if (n <= 0) {
+            return 0;
+        }
+        mcts::Deadline deadline = milliseconds
+            ? std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::milli>(*milliseconds))
+            : mcts::NO_DEADLINE;
+        return search(static_cast<size_t>(n), deadline, cancel ? cancel->get() : nullptr, stopping_rule());
+    }
+    
+    /**
+     * Encode the current position as feature planes (see board::encode), from the
+     * perspective of the player to move.
+     * @return float32 array of shape (planes, 9, 9), backed by a buffer allocated here
+     */
+    py::array_t<float> to_planes() {
         if (!root_node) {
             throw std::runtime_error("MCTS not initialized");
         }
+        float * data;
+        auto planes = make_owned_array({B::NUM_PLANES, B::BOARD_SIZE, B::BOARD_SIZE}, B::ENCODING_SIZE, data);
+        root_node->get_state().encode(data);
+        return planes;
+    }
+    
+    /**
+     * Get the root's visit counts as a fixed-size policy target.
+     * @return float32 array of 209 visit counts, indexed by action id (destination squares,
+     *         then horizontal and vertical walls), from the perspective of the player to move
+     */
+    py::array_t<float> get_visit_policy() {
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        float * data;
+        auto visits = make_owned_array({B::POLICY_SIZE}, B::POLICY_SIZE, data);
+        root_node->get_visit_policy(data);
+        return visits;
+    }
+    
+    /**
+     * Evaluate leaves with a Python model instead of rollouts. Each search pass hands
+     * evaluate up to batch_size positions at once, as a float32 array of shape
+     * (count, planes, 9, 9) (see board::encode). It must return a (values, policies) pair
+     * of arrays of shape (count,) and (count, 209), with values from the perspective of the
+     * player to move and policies indexed by action id.
+     * @param evaluate Callable taking the encoded batch
+     * @param batch_size Maximum number of positions per call
+     */
+    void set_evaluator(py::function evaluate, int batch_size) {
+        halt_background_search();
+        if (batch_size < 1) {
+            throw std::runtime_error("batch_size must be >= 1");
+        }
+        if (eval_children) {
+            throw std::runtime_error("eval_children is not supported with an evaluator");
+        }
+        if (parallelism == mcts::LEAF_PARALLEL && threads > 1) {
+            throw std::runtime_error("leaf parallelism is not supported with an evaluator");
+        }
+        evaluator.reset(new mcts::batch_evaluator<B>(
+            [evaluate](const float * inputs, const size_t count, float * values, float * policies) {
+                // search runs with the GIL released
+                py::gil_scoped_acquire gil;
+                try {
+                    // (copied, as the input buffer is reused once the call returns)
+                    const std::vector<py::ssize_t> shape = {
+                        static_cast<py::ssize_t>(count), B::NUM_PLANES, B::BOARD_SIZE, B::BOARD_SIZE};
+                    py::array_t<float> batch(shape);
+                    std::copy(inputs, inputs + count * B::ENCODING_SIZE, batch.mutable_data());
+                    py::tuple result = evaluate(batch);
+                    if (result.size() != 2) {
+                        throw std::runtime_error("evaluator must return (values, policies)");
+                    }
+                    auto result_values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[0]);
+                    auto result_policies = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[1]);
+                    if (!result_values || !result_policies
+                        || static_cast<size_t>(result_values.size()) != count
+                        || static_cast<size_t>(result_policies.size()) != count * B::POLICY_SIZE) {
+                        throw std::runtime_error("evaluator returned arrays of the wrong size");
+                    }
+                    std::copy(result_values.data(), result_values.data() + count, values);
+                    std::copy(result_policies.data(), result_policies.data() + count * B::POLICY_SIZE, policies);
+                } catch (py::error_already_set & e) {
+                    // rethrown as a plain exception, as it may propagate out of a worker thread
+                    throw std::runtime_error(std::string("evaluator raised: ") + e.what());
+                }
+            },
+            static_cast<size_t>(batch_size)
+        ));
+    }
+    
+    /**
+     * Go back to evaluating leaves with rollouts.
+     */
+    void clear_evaluator() {
+        halt_background_search();
+        evaluator.reset();
+    }
+    
+    /**
+     * Play games of the search against itself, natively and in bulk, with this engine's
+     * search settings (and evaluator, if one is set). The engine's own tree is left alone.
+     * Runs with the GIL released, except while calling an evaluator.
+     * @param num_games Number of games, each from the initial position
+     * @param sims_per_move Simulations per move (on top of the visits kept from the last move)
+     * @param threads Number of games played at once (each searched on a single thread)
+     * @param epsilon Chance of a random move instead of the best one
+     * @param max_moves Games still going after this many moves are recorded as unfinished
+     * @param stop_on_eval End each game at its first position with an exact evaluation
+     * @param cancel Optional token that stops the run when set, keeping the finished games
+     * @return Dict of arrays: "offsets" (int64, one more than there are games; game i made
+     *         moves offsets[i] to offsets[i+1]-1), "actions" (uint16 action ids, one per
+     *         move, from the mover's perspective), "visits" (float32 root visit counts,
+     *         shape (moves, 209), as get_visit_policy) and "outcomes" (int8, one per game:
+     *         1 if the first player won, -1 if they lost, 0 if unfinished)
+     */
+    py::dict self_play(int num_games, int sims_per_move, int threads, double epsilon, int max_moves, bool stop_on_eval, const cancel_token * cancel) {
+        halt_background_search();
+        if (num_games < 0 || sims_per_move < 1 || threads < 1 || max_moves < 1) {
+            throw std::runtime_error("num_games must be >= 0, and sims_per_move, threads and max_moves >= 1");
+        }
+        if (epsilon < 0.0 || epsilon > 1.0) {
+            throw std::runtime_error("epsilon must be between 0 and 1");
+        }
+        mcts::self_play_settings<B> settings;
+        settings.sims_per_move = static_cast<size_t>(sims_per_move);
+        settings.c = c_param;
+        settings.use_rollout = use_rollout;
+        settings.eval_children = eval_children;
+        settings.use_puct = use_puct;
+        settings.use_probs = use_probs;
+        settings.decide_using_visits = decide_using_visits;
+        settings.epsilon = epsilon;
+        settings.max_moves = static_cast<size_t>(max_moves);
+        settings.stop_on_eval = stop_on_eval;
+        settings.memory_budget = memory_budget;
+        settings.policy = rollout_policy;
         
-        if (n <= 0) {
+        mcts::self_play_records<B> records;
+        {
+            py::gil_scoped_release release;
+            records = mcts::self_play<B>(
+                static_cast<size_t>(num_games),
+                settings,
+                static_cast<size_t>(threads),
+                random_generator,
+                evaluator.get(),
+                cancel ? cancel->get() : nullptr
+            );
+        }
+        
+        const py::ssize_t moves = static_cast<py::ssize_t>(records.actions.size());
+        const py::ssize_t games = static_cast<py::ssize_t>(records.games());
+        std::vector<int64_t> offsets(records.offsets.begin(), records.offsets.end());
+        py::dict result;
+        result["offsets"] = make_array_from(std::move(offsets), {games + 1});
+        result["actions"] = make_array_from(std::move(records.actions), {moves});
+        result["visits"] = make_array_from(std::move(records.visits), {moves, static_cast<py::ssize_t>(B::POLICY_SIZE)});
+        result["outcomes"] = make_array_from(std::move(records.outcomes), {games});
+        return result;
+    }
+    
+    /**
+     * Start searching the current position on a background thread (typically while the
+     * opponent is thinking), until stop_pondering or anything that changes the tree --
+     * make_move keeps the subtree of the move actually played, pondered visits included.
+     * @param max_simulations Simulation budget for the background search
+     */
+    void start_pondering(int max_simulations = 1000000) {
+        halt_background_search();
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        if (max_simulations <= 0 || root_node->get_state().is_terminal()) {
             return;
         }
         
-        root_node->simulate(
-            static_cast<size_t>(n),
-            random_generator,
-            c_param,
-            use_rollout,
-            eval_children,
-            use_puct,
-            use_probs
-        );
+        ponder_stop.store(false);
+        ponder_running.store(true);
+        ponder_simulations = 0;
+        ponder_error = nullptr;
+        const size_t n = static_cast<size_t>(max_simulations);
+        ponder_thread = std::thread([this, n]() {
+            try {
+                ponder_simulations = static_cast<size_t>(search(n, mcts::NO_DEADLINE, &ponder_stop));
+            } catch (...) {
+                ponder_error = std::current_exception();
+            }
+            ponder_running.store(false);
+        });
+    }
+    
+    /**
+     * Stop the background search, if there is one.
+     * @return Number of simulations the background search ran
+     */
+    int stop_pondering() {
+        halt_background_search();
+        if (ponder_error) {
+            std::exception_ptr error = ponder_error;
+            ponder_error = nullptr;
+            std::rethrow_exception(error);
+        }
+        return static_cast<int>(std::min<size_t>(ponder_simulations, std::numeric_limits<int>::max()));
+    }
+    
+    /**
+     * Check whether a background search is running (it stops by itself once its budget is spent).
+     */
+    bool is_pondering() const {
+        return ponder_running.load();
+    }
+    
+    /**
+     * Queue a search of the current position on a shared pool of threads (see EnginePool),
+     * which runs it a quantum at a time alongside other engines' searches. Like pondering,
+     * it is stopped by anything that changes the tree or the search settings.
+     * @return The pool's id for the search
+     */
+    size_t submit_to(const std::shared_ptr<mcts::search_pool>& target, size_t n, int priority,
+                     mcts::Deadline deadline, mcts::search_pool::completion done) {
+        halt_background_search();
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        // (the pool runs one quantum of a search at a time, so the search is never run by
+        // two of its threads at once. Each quantum stops early on what's left of the whole
+        // search, and one cut short ends the search)
+        pool_search = target->submit(
+            [this, n, run = size_t(0)](size_t simulations, mcts::Deadline quantum_deadline, const std::atomic<bool> * stop) mutable {
+                const size_t later = n - std::min(n, run + simulations);
+                const size_t completed = static_cast<size_t>(search(simulations, quantum_deadline, stop, stopping_rule(later)));
+                run += completed;
+                return completed;
+            },
+            n, priority, deadline, std::move(done));
+        pool = target;
+        return pool_search;
+    }
+    
+    /**
+     * Stop the search handed to a pool, if there is one, without waiting for it.
+     */
+    void cancel_pool_search() {
+        if (std::shared_ptr<mcts::search_pool> current = pool.lock()) {
+            current->cancel(pool_search);
+        }
+    }
+    
+    /**
+     * Block until the search handed to a pool, if there is one, is done. May be called with
+     * or without the GIL (see halt_background_search).
+     */
+    void wait_for_pool_search() {
+        std::shared_ptr<mcts::search_pool> current = pool.lock();
+        if (!current) {
+            return;
+        }
+        if (PyGILState_Check()) {
+            py::gil_scoped_release release;
+            current->wait(pool_search);
+        } else {
+            current->wait(pool_search);
+        }
     }
     
     /**
@@ -196,6 +633,21 @@ public:
         return root_node->get_equity();
     }
     
+    /**
+     * Get the current position's proven result, once the search has solved it.
+     * @return 1 if the player to move is proven to win, -1 if proven to lose, None if unsolved
+     */
+    std::optional<int> get_proven_result() const {
+        if (!root_node) {
+            return std::nullopt;
+        }
+        const int result = root_node->get_proven_result();
+        if (result == 0) {
+            return std::nullopt;
+        }
+        return result;
+    }
+    
     /**
      * Display the current board state.
      * @param flip Whether to flip the perspective
@@ -213,11 +665,245 @@ public:
      * Reset to initial game state.
      */
     void reset_to_initial_state() {
+        halt_background_search();
+        
         // Create initial board state
-        corridors::board initial_board;
+        B initial_board;
         
-        // Create root node with initial state
-        root_node = std::make_shared<mcts::uct_node<corridors::board>>(std::move(initial_board));
+        // Create root node with initial state (the memory budget carries over to the
+        // trees that later moves descend to)
+        auto new_root = std::make_shared<mcts::uct_node<B>>(std::move(initial_board));
+        new_root->set_memory_budget(memory_budget);
+        replace_root(std::move(new_root));
+    }
+    
+    /**
+     * Get the memory used by the search tree.
+     * @return Tuple (bytes in use by the tree, bytes held for it in total)
+     */
+    std::tuple<long long, long long> get_memory_usage() const {
+        if (!root_node) {
+            return std::make_tuple(0LL, 0LL);
+        }
+        return std::make_tuple(
+            static_cast<long long>(root_node->get_memory_usage()),
+            static_cast<long long>(root_node->get_memory_reserved())
+        );
+    }
+    
+    /**
+     * Get the search counters collected since construction or the last reset_search_stats
+     * (all zero unless the engine was created with collect_stats). Times are in seconds,
+     * and the phase times are summed over the search threads.
+     * @return Dict of counter name to value
+     */
+    py::dict get_search_stats() const {
+        mcts::search_stats s;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            s = stats;
+        }
+        auto seconds = [](uint64_t ns) { return static_cast<double>(ns) * 1e-9; };
+        auto ratio = [](uint64_t n, uint64_t d) { return d ? static_cast<double>(n) / static_cast<double>(d) : 0.0; };
+        
+        py::dict result;
+        result["simulations"] = s.simulations;
+        result["simulations_saved"] = s.simulations_saved;
+        result["seconds"] = seconds(s.elapsed_ns);
+        result["sims_per_second"] = ratio(s.simulations, s.elapsed_ns) * 1e9;
+        result["select_seconds"] = seconds(s.select_ns);
+        result["expand_seconds"] = seconds(s.expand_ns);
+        result["eval_seconds"] = seconds(s.eval_ns);
+        result["backprop_seconds"] = seconds(s.backprop_ns);
+        result["nodes_expanded"] = s.expansions;
+        result["nodes_allocated"] = s.nodes_built;
+        result["mean_branching_factor"] = ratio(s.children, s.expansions);
+        result["mean_depth"] = ratio(s.depth_sum, s.leaves);
+        result["max_depth"] = s.max_depth;
+        result["rollouts"] = s.rollouts;
+        result["mean_rollout_length"] = ratio(s.rollout_plies, s.rollouts);
+        result["terminal_hits"] = s.terminal_hits;
+        result["non_terminal_eval_hits"] = s.non_terminal_eval_hits;
+        result["solved_hits"] = s.solved_hits;
+        result["transposition_hits"] = s.transposition_hits;
+        result["collisions"] = s.collisions;
+        result["exceptions"] = s.exceptions;
+        return result;
+    }
+    
+    /**
+     * Zero the search counters.
+     */
+    void reset_search_stats() {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats = mcts::search_stats();
+    }
+    
+    /**
+     * Write the search tree (from the current position down) to a file, to be loaded later
+     * by load_tree -- by this engine or another, in this process or another.
+     * @param path File to write (replaced if it exists)
+     */
+    void save_tree(const std::string& path) {
+        halt_background_search();
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        try {
+            mcts::tree_image<B>::write(path, root_node->save());
+        } catch (const std::string& e) {
+            throw std::runtime_error(e);
+        }
+    }
+    
+    /**
+     * Replace the search tree with one written by save_tree (the file is memory-mapped, and
+     * only the expanded part of the tree is rebuilt). The current position becomes the saved
+     * tree's root.
+     * @param path File to read
+     */
+    void load_tree(const std::string& path) {
+        halt_background_search();
+        try {
+            install_tree(mcts::tree_image<B>::open(path));
+        } catch (const std::string& e) {
+            throw std::runtime_error(e);
+        }
+    }
+    
+    /**
+     * Get the search tree in the format of save_tree, e.g. to move a game to another worker.
+     */
+    py::bytes save_tree_bytes() {
+        halt_background_search();
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        std::vector<char> image;
+        try {
+            image = root_node->save();
+        } catch (const std::string& e) {
+            throw std::runtime_error(e);
+        }
+        return py::bytes(image.data(), image.size());
+    }
+    
+    /**
+     * Replace the search tree with one from save_tree_bytes.
+     */
+    void load_tree_bytes(const py::bytes& data) {
+        halt_background_search();
+        const std::string bytes = data;
+        try {
+            install_tree(mcts::tree_image<B>(std::vector<char>(bytes.begin(), bytes.end())));
+        } catch (const std::string& e) {
+            throw std::runtime_error(e);
+        }
+    }
+    
+    /**
+     * Build an opening book from search trees written by save_tree (typically by deep
+     * searches of the first few positions -- see tools/build_opening_book.py).
+     * @param tree_paths Files written by save_tree
+     * @param path Book file to write (replaced if it exists)
+     * @param min_visits Positions searched fewer times than this are left out
+     * @param max_depth Positions more than this many moves below their tree's root are left out
+     * @return Number of positions in the book
+     */
+    static int build_opening_book(const std::vector<std::string>& tree_paths, const std::string& path, int min_visits, int max_depth) {
+        if (min_visits < 1 || max_depth < 0) {
+            throw std::runtime_error("min_visits must be >= 1 and max_depth >= 0");
+        }
+        try {
+            std::vector<mcts::tree_image<B>> trees;
+            for (const std::string& tree_path : tree_paths) {
+                trees.push_back(mcts::tree_image<B>::open(tree_path));
+            }
+            std::vector<char> bytes = mcts::opening_book<B>::build(trees, static_cast<size_t>(min_visits), static_cast<size_t>(max_depth));
+            mcts::opening_book<B>::write(path, bytes);
+            return static_cast<int>(mcts::opening_book<B>(std::move(bytes)).positions());
+        } catch (const std::string& e) {
+            throw std::runtime_error(e);
+        }
+    }
+    
+    /**
+     * Start every position found in an opening book (built by build_opening_book) with the
+     * book's statistics, from now on: the current position, and each one reached later by
+     * make_move or reset_to_initial_state. A position searched deeply enough by the book
+     * needs no search of its own before choose_best_action.
+     * @param path Book file (memory-mapped)
+     * @return Whether the current position is in the book
+     */
+    bool set_opening_book(const std::string& path) {
+        halt_background_search();
+        try {
+            book.reset(new mcts::opening_book<B>(mcts::opening_book<B>::open(path)));
+        } catch (const std::string& e) {
+            throw std::runtime_error(e);
+        }
+        return root_node && root_node->seed(*book);
+    }
+    
+    /**
+     * Stop seeding positions from the opening book (the statistics already taken stay).
+     */
+    void clear_opening_book() {
+        halt_background_search();
+        book.reset();
+    }
+    
+    /**
+     * Get the opening book's moves for the current position, most searched first.
+     * @param flip Whether to flip the perspective
+     * @return Vector of tuples (visit_count, value, action_string), empty if the position
+     *         isn't in the book (or there is no book)
+     */
+    std::vector<std::tuple<int, double, std::string>> get_book_moves(bool flip = false) const {
+        std::vector<std::tuple<int, double, std::string>> moves;
+        if (!book || !root_node) {
+            return moves;
+        }
+        const size_t p = book->find(root_node->get_state());
+        if (p == mcts::opening_book<B>::NOT_FOUND) {
+            return moves;
+        }
+        for (size_t m = book->first_move(p); m < book->first_move(p) + book->move_count(p); ++m) {
+            // (stored from the perspective of the player making the move, and valued from
+            // that of the position it leads to)
+            const size_t action_id = flip ? book->action_id(m) : B::flip_action_id(book->action_id(m));
+            const double visits = static_cast<double>(book->visit_count(m));
+            moves.emplace_back(
+                static_cast<int>(std::min<uint64_t>(book->visit_count(m), std::numeric_limits<int>::max())),
+                -book->Q_sum(m) / visits,
+                B::action_id_to_text(action_id)
+            );
+        }
+        std::stable_sort(moves.begin(), moves.end(), [](const auto& a, const auto& b) {
+            return std::get<0>(a) > std::get<0>(b);
+        });
+        return moves;
+    }
+    
+    /**
+     * Get how much of the search tree the last move kept.
+     * @return Tuple (visits carried over to the new root, visits discarded with the old root's other subtrees)
+     */
+    std::tuple<int, int> get_tree_reuse() const {
+        const size_t limit = static_cast<size_t>(std::numeric_limits<int>::max());
+        return std::make_tuple(
+            static_cast<int>(std::min(reused_visits, limit)),
+            static_cast<int>(std::min(discarded_visits, limit))
+        );
+    }
+    
+    /**
+     * Block until every tree handed to the background reclaimer has been freed.
+     */
+    void wait_for_reclaim() {
+        if (reclaimer) {
+            reclaimer->wait();
+        }
     }
     
     /**
@@ -249,48 +935,514 @@ public:
         
         return std::nullopt;  // Shouldn't happen if is_terminal() is true
     }
+
+private:
+    /**
+     * Shared driver for the run_* entry points. Runs with the GIL released, so it
+     * must not touch any Python objects.
+     */
+    int search(size_t n, mcts::Deadline deadline, const std::atomic<bool> * cancel,
+               const mcts::early_stop& stopping = mcts::early_stop()) {
+        if (!root_node) {
+            throw std::runtime_error("MCTS not initialized");
+        }
+        
+        // (counted locally, so that reading the totals never waits on a search)
+        mcts::search_stats run;
+        size_t completed;
+        try {
+            completed = root_node->simulate(
+                n,
+                random_generator,
+                c_param,
+                use_rollout,
+                eval_children,
+                use_puct,
+                use_probs,
+                threads,
+                deadline,
+                cancel,
+                table.get(),
+                rollout_policy,
+                evaluator.get(),
+                collect_stats ? &run : nullptr,
+                parallelism,
+                stopping,
+                rollouts.get()
+            );
+        } catch (...) {
+            add_search_stats(run);
+            throw;
+        }
+        add_search_stats(run);
+        return static_cast<int>(std::min<size_t>(completed, std::numeric_limits<int>::max()));
+    }
+    
+    /**
+     * Adds a search's counters to the totals (if they are being collected).
+     */
+    void add_search_stats(const mcts::search_stats& run) {
+        if (collect_stats) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            stats += run;
+        }
+    }
+    
+    /**
+     * Wraps a new buffer of the given size as a NumPy array without copying it: the
+     * array takes ownership, and frees the buffer when it is garbage collected.
+     */
+    static py::array_t<float> make_owned_array(const std::vector<py::ssize_t>& shape, size_t size, float*& data) {
+        std::unique_ptr<float[]> buffer(new float[size]);
+        py::capsule owner(buffer.get(), [](void* p) { delete[] static_cast<float*>(p); });
+        data = buffer.release();
+        return py::array_t<float>(shape, data, owner);
+    }
+    
+    /**
+     * Hands a vector over to a NumPy array of the given shape without copying it: the
+     * array takes ownership, and frees the vector when it is garbage collected.
+     */
+    template <typename T>
+    static py::array_t<T> make_array_from(std::vector<T>&& values, const std::vector<py::ssize_t>& shape) {
+        std::unique_ptr<std::vector<T>> buffer(new std::vector<T>(std::move(values)));
+        py::capsule owner(buffer.get(), [](void* p) { delete static_cast<std::vector<T>*>(p); });
+        T * data = buffer.release()->data();
+        return py::array_t<T>(shape, data, owner);
+    }
+    
+    /**
+     * Maps the rollout policy names accepted from Python onto the board's heuristics.
+     */
+    static typename B::rollout_policy parse_rollout_policy(const std::string& name, double path_probability) {
+        typedef typename B::rollout_policy policy;
+        if (path_probability < 0.0 || path_probability > 1.0) {
+            throw std::runtime_error("rollout_path_probability must be between 0 and 1");
+        }
+        if (name == "random") {
+            return policy(policy::RANDOM, path_probability);
+        } else if (name == "shortest_path") {
+            return policy(policy::SHORTEST_PATH, path_probability);
+        } else if (name == "smart_walls") {
+            return policy(policy::SMART_WALLS, path_probability);
+        }
+        throw std::runtime_error("Unknown rollout policy: " + name);
+    }
+    
+    /**
+     * The early stopping rule for a search, with later simulations still to come after it
+     * (none, unless the engine was created with early_stop).
+     */
+    mcts::early_stop stopping_rule(size_t later = 0) const {
+        mcts::early_stop stopping;
+        stopping.factor = early_stop;
+        stopping.later_simulations = later;
+        return stopping;
+    }
+    
+    /**
+     * Checks the early stopping factor accepted from Python: 0 for none, or at least 1.
+     * Searches stop once the most visited move is settled, so only engines that choose
+     * their moves by visits can stop early.
+     */
+    static double check_early_stop(double factor, bool decide_using_visits) {
+        if (factor != 0.0 && !(factor >= 1.0)) {
+            throw std::runtime_error("early_stop must be 0 (off) or at least 1");
+        }
+        if (factor != 0.0 && !decide_using_visits) {
+            throw std::runtime_error("early_stop needs decide_using_visits");
+        }
+        return factor;
+    }
+    
+    /**
+     * Maps the parallelism names accepted from Python onto the search's modes.
+     */
+    static mcts::parallelism parse_parallelism(const std::string& name, bool use_rollout) {
+        if (name == "tree") {
+            return mcts::TREE_PARALLEL;
+        } else if (name == "root") {
+            return mcts::ROOT_PARALLEL;
+        } else if (name == "leaf") {
+            if (!use_rollout) {
+                throw std::runtime_error("leaf parallelism needs use_rollout");
+            }
+            return mcts::LEAF_PARALLEL;
+        }
+        throw std::runtime_error("Unknown parallelism: " + name);
+    }
+    
+    /**
+     * Stops the background search (pondering or a pool's), and waits for it. Errors pondering
+     * raised are kept for stop_pondering (anywhere else, the search that follows would run
+     * into them anyway); a pool's search reports its own.
+     * May be called with or without the GIL; the GIL is released while waiting, since the
+     * background search needs it to call a Python evaluator.
+     */
+    void halt_background_search() {
+        if (!pool.expired()) {
+            cancel_pool_search();
+            wait_for_pool_search();
+            pool.reset();
+        }
+        if (!ponder_thread.joinable()) {
+            return;
+        }
+        ponder_stop.store(true);
+        if (PyGILState_Check()) {
+            py::gil_scoped_release release;
+            ponder_thread.join();
+        } else {
+            ponder_thread.join();
+        }
+    }
+    
+    /**
+     * Makes the tree in image the engine's tree, under this engine's memory budget.
+     */
+    void install_tree(const mcts::tree_image<B>& image) {
+        auto loaded = mcts::uct_node<B>::load(image);
+        loaded->set_memory_budget(memory_budget);
+        replace_root(std::move(loaded));
+        age_transposition_table();
+    }
+    
+    /**
+     * Makes new_node the root, freeing the rest of the old tree (in the background, if enabled).
+     */
+    void replace_root(std::shared_ptr<mcts::uct_node<B>> new_node) {
+        const size_t old_visits = root_node ? root_node->get_visit_count() : 0;
+        reused_visits = new_node->get_visit_count();
+        discarded_visits = old_visits > reused_visits ? old_visits - reused_visits : 0;
+        
+        std::shared_ptr<mcts::uct_node<B>> old_root(std::move(root_node));
+        root_node = std::move(new_node);
+        if (book) {
+            root_node->seed(*book);
+        }
+        if (reclaimer) {
+            reclaimer->reclaim(std::move(old_root));
+        }
+    }
+    
+    /**
+     * Marks the transposition table's entries as older than the new root's search,
+     * so that they are the first to be replaced.
+     */
+    void age_transposition_table() {
+        if (table) {
+            table->new_search();
+        }
+    }
 };
 
+typedef basic_corridors_mcts<corridors::board> _corridors_mcts;
+typedef basic_corridors_mcts<corridors::board7> _corridors_mcts_7x7;
+typedef basic_corridors_mcts<corridors::board5> _corridors_mcts_5x5;
+
 /**
- * Pybind11 module definition.
- * The module name must match the filename and Python import name.
+ * A fixed set of threads shared by the searches of many engines (one per game, say), for
+ * servers that would otherwise need a thread per game. Each engine keeps its own tree; the
+ * pool runs a quantum of simulations at a time of whichever waiting search has the highest
+ * priority, then the earliest deadline (see mcts::search_pool).
  */
-PYBIND11_MODULE(_corridors_mcts, m) {
-    m.doc() = "Corridors MCTS C++ implementation with Python bindings";
+class engine_pool {
+private:
+    std::shared_ptr<mcts::search_pool> pool;
+
+public:
+    /**
+     * @param threads Number of threads, 0 for one per hardware thread
+     * @param quantum Simulations a search runs before the next one gets a turn
+     * @param pin_threads Keep each thread on a core of its own (Linux only)
+     */
+    engine_pool(int threads, int quantum, bool pin_threads) {
+        if (threads < 0 || quantum < 1) {
+            throw std::runtime_error("threads must be >= 0 and quantum >= 1");
+        }
+        pool = std::make_shared<mcts::search_pool>(static_cast<size_t>(threads), static_cast<size_t>(quantum), pin_threads);
+    }
     
-    // Export the main MCTS class
-    py::class_<_corridors_mcts>(m, "_corridors_mcts")
-        .def(py::init<double, int, bool, bool, bool, bool, bool>(),
+    ~engine_pool() {
+        // (the searches still running may be waiting for the GIL, to call their callbacks)
+        if (PyGILState_Check()) {
+            py::gil_scoped_release release;
+            pool.reset();
+        } else {
+            pool.reset();
+        }
+    }
+    
+    /**
+     * Queue a search of the engine's current position, replacing any background search the
+     * engine already has. Returns at once; the engine must not be changed until the search is
+     * done (anything that changes it stops the search first, as with pondering).
+     * @param engine The engine to search
+     * @param n Maximum number of simulations
+     * @param priority Searches with a higher priority run first
+     * @param milliseconds Optional time budget, from now
+     * @param callback Optional callable, called as callback(completed, error) once the
+     *        search is done (on one of the pool's threads, with the GIL held): completed
+     *        is the number of simulations run, and error None or the message of the error
+     *        that ended the search
+     */
+    template <typename Engine>
+    void search(Engine& engine, int n, int priority, std::optional<double> milliseconds,
+                std::optional<py::function> callback) {
+        if (n <= 0) {
+            throw std::runtime_error("n must be >= 1");
+        }
+        const mcts::Deadline deadline = milliseconds
+            ? std::chrono::steady_clock::now()
+                + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::milli>(*milliseconds))
+            : mcts::NO_DEADLINE;
+        
+        // (released wherever the search ends, so the GIL is taken to drop the reference)
+        std::shared_ptr<py::function> held;
+        if (callback) {
+            held.reset(new py::function(std::move(*callback)), [](py::function* f) {
+                py::gil_scoped_acquire gil;
+                delete f;
+            });
+        }
+        engine.submit_to(pool, static_cast<size_t>(n), priority, deadline,
+            [held](size_t completed, std::exception_ptr error) {
+                if (!held) {
+                    return;
+                }
+                std::optional<std::string> message;
+                if (error) {
+                    try {
+                        std::rethrow_exception(error);
+                    } catch (const std::exception& e) {
+                        message = e.what();
+                    } catch (const std::string& e) {
+                        message = e;
+                    } catch (...) {
+                        message = "unknown error";
+                    }
+                }
+                py::gil_scoped_acquire gil;
+                try {
+                    (*held)(static_cast<int>(std::min<size_t>(completed, std::numeric_limits<int>::max())), message);
+                } catch (py::error_already_set& e) {
+                    e.discard_as_unraisable("EnginePool callback");
+                }
+            });
+    }
+    
+    /**
+     * Stop the engine's search without waiting for it (its callback is still called).
+     */
+    template <typename Engine>
+    void cancel(Engine& engine) {
+        engine.cancel_pool_search();
+    }
+    
+    /**
+     * Block until the engine's search is done.
+     */
+    template <typename Engine>
+    void wait(Engine& engine) {
+        engine.wait_for_pool_search();
+    }
+    
+    int get_threads() const {
+        return static_cast<int>(pool->get_threads());
+    }
+    
+    int get_quantum() const {
+        return static_cast<int>(pool->get_quantum_size());
+    }
+    
+    /**
+     * Get the number of searches waiting or running.
+     */
+    int get_searches() const {
+        return static_cast<int>(pool->get_searches());
+    }
+};
+
+/**
+ * Export an engine class, for games on the board of its template argument.
+ */
+template <typename Engine>
+void bind_engine(py::module_& m, const char* name) {
+    py::class_<Engine>(m, name)
+        .def(py::init<double, int, bool, bool, bool, bool, bool, int, int, const std::string&, double, bool, int, bool, const std::string&, double>(),
              "Initialize MCTS",
              py::arg("c"), py::arg("seed"), py::arg("use_rollout"),
              py::arg("eval_children"), py::arg("use_puct"), 
-             py::arg("use_probs"), py::arg("decide_using_visits"))
-        .def("make_move", &_corridors_mcts::make_move,
+             py::arg("use_probs"), py::arg("decide_using_visits"),
+             py::arg("threads") = 1, py::arg("transposition_table_mb") = 0,
+             py::arg("rollout_policy") = "random", py::arg("rollout_path_probability") = 0.5,
+             py::arg("background_reclaim") = false, py::arg("memory_budget_mb") = 0,
+             py::arg("collect_stats") = false, py::arg("parallelism") = "tree",
+             py::arg("early_stop") = 0.0)
+        .def("make_move", &Engine::make_move,
              "Make a move in the game",
              py::arg("action"), py::arg("flip") = false)
-        .def("get_legal_moves", &_corridors_mcts::get_legal_moves,
+        .def("get_legal_moves", &Engine::get_legal_moves,
              "Get list of legal moves",
              py::arg("flip") = false)
-        .def("get_sorted_actions", &_corridors_mcts::get_sorted_actions,
+        .def("make_move_id", &Engine::make_move_id,
+             "Make a move in the game by action id",
+             py::arg("action_id"), py::arg("flip") = false)
+        .def("get_legal_action_ids", &Engine::get_legal_action_ids,
+             "Get the action ids of the legal moves",
+             py::arg("flip") = false)
+        .def("get_sorted_actions", &Engine::get_sorted_actions,
              "Get sorted actions with statistics",
              py::arg("flip") = false)
-        .def("choose_best_action", &_corridors_mcts::choose_best_action,
+        .def("get_sorted_action_ids", &Engine::get_sorted_action_ids,
+             "Get sorted actions with statistics, by action id",
+             py::arg("flip") = false)
+        .def_static("action_id_to_text", &Engine::action_id_to_text,
+             "Convert an action id to its move string",
+             py::arg("action_id"))
+        .def_static("action_text_to_id", &Engine::action_text_to_id,
+             "Convert a move string to its action id",
+             py::arg("action"))
+        .def("choose_best_action", &Engine::choose_best_action,
              "Choose best action with epsilon-greedy",
              py::arg("epsilon") = 0.0)
-        .def("run_simulations", &_corridors_mcts::run_simulations,
+        .def("run_simulations", &Engine::run_simulations,
              "Run MCTS simulations",
-             py::arg("n"))
-        .def("get_visit_count", &_corridors_mcts::get_visit_count,
+             py::arg("n"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("run_for", &Engine::run_for,
+             "Run MCTS simulations for a time budget, returning the number completed",
+             py::arg("milliseconds"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("run_until", &Engine::run_until,
+             "Run MCTS simulations until the budget, deadline or cancel token stops them",
+             py::arg("n"), py::arg("milliseconds") = py::none(), py::arg("cancel") = py::none(),
+             py::call_guard<py::gil_scoped_release>())
+        .def("to_planes", &Engine::to_planes,
+             "Encode the current position as feature planes (zero-copy)")
+        .def("get_visit_policy", &Engine::get_visit_policy,
+             "Get the root's visit counts indexed by action id (zero-copy)")
+        .def("set_evaluator", &Engine::set_evaluator,
+             "Evaluate leaves in batches with a Python model instead of rollouts",
+             py::arg("evaluate"), py::arg("batch_size") = 16)
+        .def("clear_evaluator", &Engine::clear_evaluator,
+             "Go back to evaluating leaves with rollouts")
+        .def("get_visit_count", &Engine::get_visit_count,
              "Get total visit count")
-        .def("get_evaluation", &_corridors_mcts::get_evaluation,
+        .def("get_evaluation", &Engine::get_evaluation,
              "Get position evaluation")
-        .def("display", &_corridors_mcts::display,
+        .def("get_proven_result", &Engine::get_proven_result,
+             "Get the position's proven result (1 won, -1 lost for the player to move), if solved")
+        .def("display", &Engine::display,
              "Display board state",
              py::arg("flip") = false)
-        .def("reset_to_initial_state", &_corridors_mcts::reset_to_initial_state,
+        .def("self_play", &Engine::self_play,
+             "Play games of the search against itself natively, returning their records in bulk",
+             py::arg("num_games"), py::arg("sims_per_move"), py::arg("threads") = 1,
+             py::arg("epsilon") = 0.0, py::arg("max_moves") = 200, py::arg("stop_on_eval") = false,
+             py::arg("cancel") = py::none())
+        .def("start_pondering", &Engine::start_pondering,
+             "Keep searching the current position in the background",
+             py::arg("max_simulations") = 1000000)
+        .def("stop_pondering", &Engine::stop_pondering,
+             "Stop the background search, returning its simulation count")
+        .def("is_pondering", &Engine::is_pondering,
+             "Check whether a background search is running")
+        .def("get_memory_usage", &Engine::get_memory_usage,
+             "Get (bytes in use, bytes reserved) by the search tree")
+        .def("get_search_stats", &Engine::get_search_stats,
+             "Get the search counters collected since the last reset (needs collect_stats)")
+        .def("reset_search_stats", &Engine::reset_search_stats,
+             "Zero the search counters")
+        .def("save_tree", &Engine::save_tree,
+             "Write the search tree to a file",
+             py::arg("path"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("load_tree", &Engine::load_tree,
+             "Replace the search tree with one from save_tree (memory-mapped)",
+             py::arg("path"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("save_tree_bytes", &Engine::save_tree_bytes,
+             "Get the search tree in the format of save_tree")
+        .def("load_tree_bytes", &Engine::load_tree_bytes,
+             "Replace the search tree with one from save_tree_bytes",
+             py::arg("data"))
+        .def_static("build_opening_book", &Engine::build_opening_book,
+             "Build an opening book from saved search trees, returning its number of positions",
+             py::arg("tree_paths"), py::arg("path"), py::arg("min_visits") = 1000,
+             py::arg("max_depth") = 8,
+             py::call_guard<py::gil_scoped_release>())
+        .def("set_opening_book", &Engine::set_opening_book,
+             "Seed each position found in an opening book with the book's statistics",
+             py::arg("path"))
+        .def("clear_opening_book", &Engine::clear_opening_book,
+             "Stop seeding positions from the opening book")
+        .def("get_book_moves", &Engine::get_book_moves,
+             "Get the opening book's moves for the current position",
+             py::arg("flip") = false)
+        .def("get_tree_reuse", &Engine::get_tree_reuse,
+             "Get (visits kept, visits discarded) by the last move")
+        .def("wait_for_reclaim", &Engine::wait_for_reclaim,
+             "Wait until discarded trees have been freed in the background",
+             py::call_guard<py::gil_scoped_release>())
+        .def("reset_to_initial_state", &Engine::reset_to_initial_state,
              "Reset to initial game state")
-        .def("is_terminal", &_corridors_mcts::is_terminal,
+        .def("is_terminal", &Engine::is_terminal,
              "Check if position is terminal")
-        .def("get_winner", &_corridors_mcts::get_winner,
+        .def("get_winner", &Engine::get_winner,
              "Get winner if game is over");
+}
+
+/**
+ * Add the EnginePool methods that take an engine, as overloads for engines of type Engine.
+ */
+template <typename Engine>
+void bind_pool_methods(py::class_<engine_pool>& pool) {
+    pool
+        .def("search", &engine_pool::search<Engine>,
+             "Queue a search of the engine's position, calling callback(completed, error) when done",
+             py::arg("engine"), py::arg("n"), py::arg("priority") = 0,
+             py::arg("milliseconds") = py::none(), py::arg("callback") = py::none())
+        .def("cancel", &engine_pool::cancel<Engine>,
+             "Stop the engine's search without waiting for it",
+             py::arg("engine"))
+        .def("wait", &engine_pool::wait<Engine>,
+             "Wait until the engine's search is done",
+             py::arg("engine"));
+}
+
+/**
+ * Pybind11 module definition.
+ * The module name must match the filename and Python import name.
+ */
+PYBIND11_MODULE(_corridors_mcts, m) {
+    m.doc() = "Corridors MCTS C++ implementation with Python bindings";
+    
+    // Cancellation flag for time-budgeted / cancellable searches
+    py::class_<cancel_token>(m, "cancel_token")
+        .def(py::init<>())
+        .def("set", &cancel_token::set, "Request that any search using this token stops")
+        .def("clear", &cancel_token::clear, "Reset the token so it can be reused")
+        .def("is_set", &cancel_token::is_set, "Check whether the token has been set");
+    
+    // Export the MCTS classes, one per board size
+    bind_engine<_corridors_mcts>(m, "_corridors_mcts");
+    bind_engine<_corridors_mcts_7x7>(m, "_corridors_mcts_7x7");
+    bind_engine<_corridors_mcts_5x5>(m, "_corridors_mcts_5x5");
+    
+    py::class_<engine_pool> pool(m, "EnginePool");
+    pool
+        .def(py::init<int, int, bool>(),
+             "Create a pool of threads shared by many engines' searches",
+             py::arg("threads") = 0, py::arg("quantum") = 64, py::arg("pin_threads") = false)
+        .def("get_threads", &engine_pool::get_threads,
+             "Get the number of threads")
+        .def("get_quantum", &engine_pool::get_quantum,
+             "Get the simulations per turn of a search")
+        .def("get_searches", &engine_pool::get_searches,
+             "Get the number of searches waiting or running");
+    bind_pool_methods<_corridors_mcts>(pool);
+    bind_pool_methods<_corridors_mcts_7x7>(pool);
+    bind_pool_methods<_corridors_mcts_5x5>(pool);
 }
\ No newline at end of file
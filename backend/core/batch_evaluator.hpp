@@ -0,0 +1,76 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace mcts {
+
+// Evaluates positions for the search through an inference backend (typically a neural
+// network on a CPU or GPU), which is far more efficient on a batch of positions than on one
+// at a time.
+//
+// When simulate is given an evaluator, each pass of the search selects up to batch_size
+// leaves (with virtual loss spreading them over the tree), evaluate encodes them all with
+// G::encode and runs the backend once, and the results are scattered back to the waiting
+// leaves before they backprop (see uct_node::simulate_batch).
+//
+// The backend reads count*G::ENCODING_SIZE inputs, and writes count values (each from the
+// perspective of the player to move) and count*G::POLICY_SIZE move probabilities, indexed by
+// the child positions' G::get_action_id(true). Calls to it are serialized, so it needn't be
+// thread safe.
+template <typename G>
+class batch_evaluator
+{
+public:
+    typedef std::function<void(const float * inputs, const size_t count, float * values, float * policies)> backend;
+
+    batch_evaluator(backend infer, const size_t batch_size) :
+        infer(std::move(infer)),
+        batch_size(std::max<size_t>(batch_size, 1)),
+        batches(0),
+        positions(0)
+    {
+    }
+
+    size_t get_batch_size() const noexcept
+    {
+        return batch_size;
+    }
+
+    // values and policies must have room for count and count*G::POLICY_SIZE entries
+    void evaluate(const G * const * states, const size_t count, float * values, float * policies)
+    {
+        static thread_local std::vector<float> inputs;
+        inputs.resize(count*G::ENCODING_SIZE);
+        for (size_t i=0;i<count;++i)
+            states[i]->encode(inputs.data() + i*G::ENCODING_SIZE);
+
+        std::lock_guard<std::mutex> lock(backend_mutex);
+        infer(inputs.data(), count, values, policies);
+        batches.fetch_add(1, std::memory_order_relaxed);
+        positions.fetch_add(count, std::memory_order_relaxed);
+    }
+
+    // totals over the evaluator's lifetime (positions/batches is the mean batch size)
+    size_t get_batches() const noexcept
+    {
+        return batches.load(std::memory_order_relaxed);
+    }
+
+    size_t get_positions() const noexcept
+    {
+        return positions.load(std::memory_order_relaxed);
+    }
+
+private:
+    backend infer;
+    size_t batch_size;
+    std::mutex backend_mutex;
+    std::atomic<size_t> batches;
+    std::atomic<size_t> positions;
+};
+
+} // namespace mcts
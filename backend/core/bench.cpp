@@ -0,0 +1,289 @@
+// Microbenchmarks of the board and the search, using Google Benchmark.
+//
+// Built by `scons bench=1` (into _corridors_bench). To keep a run for later comparison:
+//
+//     ./_corridors_bench --benchmark_out=bench.json --benchmark_out_format=json
+//
+// and compare two such runs with Google Benchmark's tools/compare.py. Each benchmark runs
+// on a set of fixed reference positions (see reference_positions), so results stay
+// comparable across commits.
+#include "mcts.hpp"
+#include "board.h"
+
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <new>
+
+namespace {
+
+using corridors::board;
+typedef mcts::uct_node<board> node;
+
+// (the search's protected select, for BM_select)
+struct bench_node : node
+{
+    using node::node;
+    using node::select;
+};
+
+struct reference_position
+{
+    const char * name;
+    std::vector<std::string> moves; // action texts, each from the perspective of the player making it
+};
+
+// the opening (131 children), a midgame with walls on both sides (109), and an endgame in
+// which both players have used all their walls (4)
+const std::vector<reference_position> & reference_positions()
+{
+    static const std::vector<reference_position> positions = []
+    {
+        std::vector<reference_position> result;
+        result.push_back({"opening", {}});
+        result.push_back({"midgame", {
+            "*(4,1)", "*(4,1)", "*(4,2)", "*(4,2)", "H(3,4)", "H(3,4)",
+            "*(3,2)", "V(5,1)", "H(0,3)", "*(5,2)", "V(1,4)", "H(1,5)"
+        }});
+        reference_position endgame{"endgame", {}};
+        for (const char * wall : {"V(0,0)", "V(0,2)", "V(0,4)", "V(0,6)", "V(2,0)", "V(2,2)", "V(2,4)", "V(2,6)", "V(6,0)", "V(6,2)"})
+        {
+            endgame.moves.push_back(wall); // hero's wall
+            endgame.moves.push_back(wall); // villain's, mirrored
+        }
+        for (const char * step : {"*(4,1)", "*(4,1)", "*(4,2)", "*(4,2)"})
+            endgame.moves.push_back(step);
+        result.push_back(endgame);
+        return result;
+    }();
+    return positions;
+}
+
+board get_position(benchmark::State & state)
+{
+    const reference_position & position = reference_positions().at(state.range(0));
+    state.SetLabel(position.name);
+    board result;
+    for (const std::string & move : position.moves)
+        result.play_action_id(board::action_text_to_id(move));
+    return result;
+}
+
+void for_each_position(benchmark::internal::Benchmark * b)
+{
+    for (size_t i=0;i<reference_positions().size();++i)
+        b->Arg((int64_t)i);
+}
+
+void BM_get_legal_moves(benchmark::State & state)
+{
+    const board position = get_position(state);
+    std::vector<board> moves;
+    for (auto _ : state)
+    {
+        moves.clear();
+        position.get_legal_moves(moves);
+        benchmark::DoNotOptimize(moves.data());
+    }
+    state.counters["moves"] = (double)moves.size();
+}
+BENCHMARK(BM_get_legal_moves)->Apply(for_each_position);
+
+void BM_get_legal_action_ids(benchmark::State & state)
+{
+    const board position = get_position(state);
+    std::vector<size_t> action_ids;
+    for (auto _ : state)
+    {
+        action_ids.clear();
+        position.get_legal_action_ids(action_ids, true);
+        benchmark::DoNotOptimize(action_ids.data());
+    }
+}
+BENCHMARK(BM_get_legal_action_ids)->Apply(for_each_position);
+
+void BM_villain_is_escapable(benchmark::State & state)
+{
+    const board position = get_position(state);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(position.villain_is_escapable());
+}
+BENCHMARK(BM_villain_is_escapable)->Apply(for_each_position);
+
+void BM_get_villains_shortest_distance(benchmark::State & state)
+{
+    const board position = get_position(state);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(position.get_villains_shortest_distance());
+}
+BENCHMARK(BM_get_villains_shortest_distance)->Apply(for_each_position);
+
+void BM_get_shortest_distances(benchmark::State & state)
+{
+    const board position = get_position(state);
+    for (auto _ : state)
+    {
+        unsigned short heros, villains;
+        position.get_shortest_distances(heros, villains);
+        benchmark::DoNotOptimize(heros);
+        benchmark::DoNotOptimize(villains);
+    }
+}
+BENCHMARK(BM_get_shortest_distances)->Apply(for_each_position);
+
+void BM_get_non_terminal_rank(benchmark::State & state)
+{
+    const board position = get_position(state);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(position.get_non_terminal_rank());
+}
+BENCHMARK(BM_get_non_terminal_rank)->Apply(for_each_position);
+
+// one item per position, over the wall-less positions random play reaches from the
+// reference position. There check_non_terminal_eval solves the race, which the tree search
+// pays at each node it selects and rollouts pay when they end (BM_rollout measures those).
+// From the endgame every position shares its walls and the per-thread cache of race
+// results mostly answers; from the others each position has walls of its own, so nearly
+// every call is a fresh search
+void BM_check_non_terminal_eval(benchmark::State & state)
+{
+    const board start = get_position(state);
+    const board::rollout_policy policy(board::rollout_policy::RANDOM, 0.0);
+    mcts::Rand rand(42);
+    std::vector<board> positions;
+    std::unordered_set<size_t> seen;
+    std::vector<size_t> action_ids;
+    for (size_t attempt=0;attempt<100000 && positions.size()<16384;++attempt)
+    {
+        board position = start;
+        for (unsigned plies=rand()%128;plies>0 && !position.is_terminal();--plies)
+            position.make_rollout_move(policy, rand);
+        if (position.is_terminal()) continue;
+        action_ids.clear();
+        position.get_legal_action_ids(action_ids, true);
+        if (*std::max_element(action_ids.begin(), action_ids.end())>=board::NUM_SQUARES) continue; // walls left
+        if (seen.insert(position.get_hash()).second) positions.push_back(position);
+    }
+    size_t i = 0;
+    for (auto _ : state)
+    {
+        double eval;
+        benchmark::DoNotOptimize(positions[i].check_non_terminal_eval(eval));
+        benchmark::DoNotOptimize(eval);
+        if (++i==positions.size()) i = 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_check_non_terminal_eval)->Apply(for_each_position);
+
+// hashes all the position's children (one item per child)
+void BM_get_hash(benchmark::State & state)
+{
+    const board position = get_position(state);
+    std::vector<board> children;
+    position.get_legal_moves(children);
+    for (auto _ : state)
+    {
+        uint64_t combined = 0;
+        for (const board & child : children)
+            combined ^= child.get_hash();
+        benchmark::DoNotOptimize(combined);
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)children.size());
+}
+BENCHMARK(BM_get_hash)->Apply(for_each_position);
+
+// one item per rollout, for each of the rollout policies
+void BM_rollout(benchmark::State & state)
+{
+    const board position = get_position(state);
+    const board::rollout_policy policy((board::rollout_policy::heuristic)state.range(1), state.range(1)==board::rollout_policy::RANDOM ? 0.0 : 0.5);
+    mcts::Rand rand(42);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mcts::rollout<board>()(position, policy, rand));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_rollout)->ArgsProduct({{0, 1, 2}, {board::rollout_policy::RANDOM, board::rollout_policy::SHORTEST_PATH, board::rollout_policy::SMART_WALLS}});
+
+const double C = std::sqrt(0.025);
+
+// one select from the root of a tree grown by simulations (the second argument), so that
+// the work per select grows with both the width (the position) and the depth of the tree
+void BM_select(benchmark::State & state)
+{
+    bench_node root(get_position(state));
+    mcts::Rand rand(42);
+    root.simulate((size_t)state.range(1), rand, C, true, false, false, false);
+    node * leaf;
+    for (auto _ : state)
+    {
+        root.select(leaf, C, rand, false, false);
+        benchmark::DoNotOptimize(leaf);
+    }
+}
+BENCHMARK(BM_select)->ArgsProduct({{0, 1, 2}, {1000, 10000}});
+
+// the select kernel on its own, on a single node of the given width
+void BM_score_children(benchmark::State & state)
+{
+    const size_t width = (size_t)state.range(0);
+    void * memory = ::operator new(mcts::child_stats::bytes(width), std::align_val_t(mcts::child_stats::ALIGNMENT));
+    mcts::child_stats * stats = mcts::child_stats::create(memory, width);
+    for (size_t i=0;i<width;++i)
+    {
+        stats->visit_count[i] = 1 + i%7;
+        stats->Q_sum[i] = 0.1*(double)(i%5) - 0.2;
+        stats->eval_Q[i] = 0.0;
+    }
+    std::vector<double> scores(mcts::child_stats::padded(width));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(mcts::score_children(*stats, C, 100.0*(double)width, false, false, false, scores.data()));
+    state.SetItemsProcessed(state.iterations() * (int64_t)width);
+    ::operator delete(memory, std::align_val_t(mcts::child_stats::ALIGNMENT));
+}
+BENCHMARK(BM_score_children)->RangeMultiplier(4)->Range(4, 256);
+
+// end to end: a fresh search of the given number of simulations per iteration (one item
+// per simulation, so items_per_second is sims/sec)
+void BM_simulate(benchmark::State & state)
+{
+    const board position = get_position(state);
+    const size_t simulations = (size_t)state.range(1);
+    mcts::Rand rand(42);
+    for (auto _ : state)
+    {
+        node root(position);
+        benchmark::DoNotOptimize(root.simulate(simulations, rand, C, true, false, false, false));
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)simulations);
+}
+BENCHMARK(BM_simulate)->ArgsProduct({{0, 1, 2}, {2000}})->Unit(benchmark::kMillisecond);
+
+// as BM_simulate from the opening, for each way of sharing the search between threads (the
+// second argument): tree, root and leaf parallel (see mcts::parallelism)
+void BM_simulate_parallel(benchmark::State & state)
+{
+    const size_t threads = (size_t)state.range(0);
+    const mcts::parallelism mode = (mcts::parallelism)state.range(1);
+    const size_t simulations = 2000;
+    mcts::Rand rand(42);
+    for (auto _ : state)
+    {
+        node root;
+        benchmark::DoNotOptimize(root.simulate(simulations, rand, C, true, false, false, false, threads, mcts::NO_DEADLINE, NULL, NULL, board::rollout_policy(), NULL, NULL, mode));
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)simulations);
+}
+BENCHMARK(BM_simulate_parallel)
+    ->ArgsProduct({{2, 4, 8}, {mcts::TREE_PARALLEL, mcts::ROOT_PARALLEL, mcts::LEAF_PARALLEL}})
+    ->ArgNames({"threads", "mode"})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
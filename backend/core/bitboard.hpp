@@ -0,0 +1,246 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// 128-bit bitboards over an N x N grid of squares. Square (x,y) lives at bit y*N + x,
+// so "up" is a shift by N and "right" is a shift by 1.
+//
+// Walls are stored as blocked-edge masks that include the board edges:
+//  - in a horizontal mask, bit s set means the step from s up to s+N is blocked
+//  - in a vertical mask, bit s set means the step from s right to s+1 is blocked
+// With the edges folded in, every step (and so every flood fill) is one shift and one AND,
+// with no bounds checks or wraparound fixups.
+namespace bitboard {
+    typedef unsigned __int128 mask;
+
+    constexpr mask bit(const size_t pos) noexcept
+    {
+        return mask(1) << pos;
+    }
+
+    inline bool test(const mask m, const size_t pos) noexcept
+    {
+        return (m >> pos) & 1;
+    }
+
+    inline unsigned int popcount(const mask m) noexcept
+    {
+        return __builtin_popcountll((uint64_t)m) + __builtin_popcountll((uint64_t)(m >> 64));
+    }
+
+    // index of the lowest set bit (m must be non-zero)
+    inline unsigned int lowest_bit(const mask m) noexcept
+    {
+        uint64_t low = (uint64_t)m;
+        return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll((uint64_t)(m >> 64));
+    }
+
+    template <size_t N>
+    struct grid
+    {
+        static_assert(N*N <= 128, "grid does not fit in a 128-bit bitboard");
+
+        static constexpr mask row(const size_t y) noexcept
+        {
+            mask m = 0;
+            for (size_t x=0;x<N;++x)
+                m |= bit(y*N + x);
+            return m;
+        }
+
+        static constexpr mask column(const size_t x) noexcept
+        {
+            mask m = 0;
+            for (size_t y=0;y<N;++y)
+                m |= bit(y*N + x);
+            return m;
+        }
+
+        static constexpr mask ALL = (mask(1) << (N*N)) - 1;
+
+        // an empty board's blocked-edge masks (just the board edges)
+        static constexpr mask EDGE_TOP = row(N-1);
+        static constexpr mask EDGE_RIGHT = column(N-1);
+
+        // single steps for every square in a set at once, dropping steps that cross a wall
+        static mask step_up(const mask squares, const mask horizontal_walls) noexcept
+        {
+            return (squares & ~horizontal_walls) << N;
+        }
+
+        static mask step_down(const mask squares, const mask horizontal_walls) noexcept
+        {
+            return (squares >> N) & ~horizontal_walls;
+        }
+
+        static mask step_right(const mask squares, const mask vertical_walls) noexcept
+        {
+            return (squares & ~vertical_walls) << 1;
+        }
+
+        static mask step_left(const mask squares, const mask vertical_walls) noexcept
+        {
+            return (squares >> 1) & ~vertical_walls;
+        }
+
+        static mask neighbours(const mask squares, const mask horizontal_walls, const mask vertical_walls) noexcept
+        {
+            return step_up(squares, horizontal_walls)
+                | step_down(squares, horizontal_walls)
+                | step_right(squares, vertical_walls)
+                | step_left(squares, vertical_walls);
+        }
+
+        // number of steps needed to get from start to any square in goal
+        // (returns max_distance if goal is unreachable)
+        static unsigned short distance(
+            const mask start,
+            const mask goal,
+            const mask horizontal_walls,
+            const mask vertical_walls,
+            const unsigned short max_distance) noexcept
+        {
+            mask reached = start;
+            mask frontier = start;
+            for (unsigned short steps=0;frontier;++steps)
+            {
+                if (frontier & goal)
+                    return steps;
+                frontier = neighbours(frontier, horizontal_walls, vertical_walls) & ~reached;
+                reached |= frontier;
+            }
+            return max_distance;
+        }
+
+        // distance for two starts and goals at once (both players' distances, say). The two
+        // flood fills run in the same loop until one of them arrives, so one's steps overlap
+        // the other's, and the other then carries on alone
+        static void distances(
+            const mask start_a,
+            const mask goal_a,
+            const mask start_b,
+            const mask goal_b,
+            const mask horizontal_walls,
+            const mask vertical_walls,
+            unsigned short & distance_a,
+            unsigned short & distance_b,
+            const unsigned short max_distance) noexcept
+        {
+            mask reached_a = start_a, frontier_a = start_a;
+            mask reached_b = start_b, frontier_b = start_b;
+            unsigned short steps=0;
+            while (frontier_a && frontier_b && !(frontier_a & goal_a) && !(frontier_b & goal_b))
+            {
+                frontier_a = neighbours(frontier_a, horizontal_walls, vertical_walls) & ~reached_a;
+                frontier_b = neighbours(frontier_b, horizontal_walls, vertical_walls) & ~reached_b;
+                reached_a |= frontier_a;
+                reached_b |= frontier_b;
+                ++steps;
+            }
+            distance_a = finish(frontier_a, reached_a, goal_a, horizontal_walls, vertical_walls, steps, max_distance);
+            distance_b = finish(frontier_b, reached_b, goal_b, horizontal_walls, vertical_walls, steps, max_distance);
+        }
+
+        // the number of steps from every square to the nearest square in goal, written to
+        // distances (N*N entries; squares that can't reach goal get max_distance)
+        static void distance_map(
+            const mask goal,
+            const mask horizontal_walls,
+            const mask vertical_walls,
+            unsigned char * distances,
+            const unsigned char max_distance) noexcept
+        {
+            for (size_t square=0;square<N*N;++square)
+                distances[square] = max_distance;
+            mask reached = goal;
+            mask frontier = goal;
+            for (unsigned char steps=0;frontier;++steps)
+            {
+                for (mask squares=frontier;squares;squares&=squares-1)
+                    distances[lowest_bit(squares)] = steps;
+                frontier = neighbours(frontier, horizontal_walls, vertical_walls) & ~reached;
+                reached |= frontier;
+            }
+        }
+
+        // finds one shortest path from start to goal, recording the edges it uses in
+        // path_horizontal (bit s: the step between s and s+N) and path_vertical (bit s: the
+        // step between s and s+1). Returns false if goal is unreachable.
+        static bool shortest_path(
+            const unsigned int start,
+            const mask goal,
+            const mask horizontal_walls,
+            const mask vertical_walls,
+            mask & path_horizontal,
+            mask & path_vertical) noexcept
+        {
+            // breadth-first search, keeping each layer so we can walk back down it
+            mask layers[N*N];
+            mask reached = bit(start);
+            layers[0] = reached;
+            size_t steps = 0;
+            while (!(layers[steps] & goal))
+            {
+                mask frontier = neighbours(layers[steps], horizontal_walls, vertical_walls) & ~reached;
+                if (!frontier)
+                    return false;
+                reached |= frontier;
+                layers[++steps] = frontier;
+            }
+
+            // walk back from the goal, one layer at a time
+            unsigned int square = lowest_bit(layers[steps] & goal);
+            while (steps>0)
+            {
+                unsigned int previous = lowest_bit(
+                    neighbours(bit(square), horizontal_walls, vertical_walls) & layers[--steps]);
+                if (previous+N==square) path_horizontal |= bit(previous);
+                else if (square+N==previous) path_horizontal |= bit(square);
+                else if (previous+1==square) path_vertical |= bit(previous);
+                else path_vertical |= bit(square);
+                square = previous;
+            }
+            return true;
+        }
+
+        // flood fill from start, stopping as soon as goal is touched
+        static bool reachable(
+            const mask start,
+            const mask goal,
+            const mask horizontal_walls,
+            const mask vertical_walls) noexcept
+        {
+            mask reached = start;
+            mask frontier = start;
+            while (frontier)
+            {
+                if (reached & goal)
+                    return true;
+                frontier = neighbours(frontier, horizontal_walls, vertical_walls) & ~reached;
+                reached |= frontier;
+            }
+            return false;
+        }
+
+    private:
+        // carries on a flood fill (as distance) that has already taken steps steps
+        static unsigned short finish(
+            mask frontier,
+            mask reached,
+            const mask goal,
+            const mask horizontal_walls,
+            const mask vertical_walls,
+            unsigned short steps,
+            const unsigned short max_distance) noexcept
+        {
+            for (;frontier;++steps)
+            {
+                if (frontier & goal)
+                    return steps;
+                frontier = neighbours(frontier, horizontal_walls, vertical_walls) & ~reached;
+                reached |= frontier;
+            }
+            return max_distance;
+        }
+    };
+}
@@ -4,25 +4,96 @@
 #include <string>
 #include <algorithm>
 #include <limits>
+#include <type_traits>
+#include <cstring>
 
 using namespace corridors;
 
-// Hash combine function to replace hash_combine
-template <typename T>
-inline void hash_combine(std::size_t& seed, const T& v) {
-    std::hash<T> hasher;
-    seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-}
+// Zobrist hashing. A position's key is the XOR of one random key per feature of the
+// position, so a move updates it with a couple of XORs. Keys are indexed by absolute
+// player (0 is the player who starts on the bottom row, i.e. hero when the board isn't
+// flipped), so a flip (which only changes whose perspective we're looking from) just
+// toggles the side-to-move key.
+namespace {
+    constexpr uint64_t splitmix64(uint64_t & state)
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
 
-// don't use this approach-- it's super slow!!
-/*template<std::size_t N>
-void reverse_bitset(const std::bitset<N> & input, std::bitset<N> & output)
-{
-    for (size_t i=0;i<N;++i)
-        output[N-1-i] = input[i];
-}*/
+    template <size_t N, size_t W>
+    struct zobrist_keys
+    {
+        uint64_t pawn[2][N*N];
+        uint64_t wall[2][(N-1)*(N-1)]; // indexed by [vertical][middle]
+        uint64_t walls_remaining[2][W+1];
+        uint64_t flipped;
+
+        constexpr zobrist_keys() : pawn(), wall(), walls_remaining(), flipped(0)
+        {
+            uint64_t state = 0;
+            for (size_t player=0;player<2;++player)
+                for (size_t square=0;square<N*N;++square)
+                    pawn[player][square] = splitmix64(state);
+            for (size_t vertical=0;vertical<2;++vertical)
+                for (size_t middle=0;middle<(N-1)*(N-1);++middle)
+                    wall[vertical][middle] = splitmix64(state);
+            for (size_t player=0;player<2;++player)
+                for (size_t count=0;count<=W;++count)
+                    walls_remaining[player][count] = splitmix64(state);
+            flipped = splitmix64(state);
+        }
+    };
 
-board::action::action() noexcept
+    template <size_t N, size_t W>
+    constexpr zobrist_keys<N, W> ZOBRIST;
+
+    // Board geometry, worked out at compile time for each board size, so that moves and walls
+    // are looked up rather than computed with divisions. Directions are absolute, in the
+    // order of board::direction.
+    template <size_t N>
+    struct geometry
+    {
+        constexpr static unsigned char OFF_BOARD = 0xff;
+        constexpr static unsigned char NO_MIDDLE = 0xff;
+
+        unsigned char step[N*N][4]; // the square one step away in each direction (OFF_BOARD past the edge)
+        unsigned char wall_square[(N-1)*(N-1)]; // the square below and left of each wall middle
+        // the middles of the walls that block each square's step up (horizontal walls) and
+        // step right (vertical walls): those centred at either end of the edge, if any
+        unsigned char blocking_up[N*N][2];
+        unsigned char blocking_right[N*N][2];
+
+        constexpr geometry() : step(), wall_square(), blocking_up(), blocking_right()
+        {
+            for (size_t y=0;y<N;++y)
+            {
+                for (size_t x=0;x<N;++x)
+                {
+                    const size_t square = y*N + x;
+                    step[square][0] = y+1<N ? square+N : OFF_BOARD;
+                    step[square][1] = x+1<N ? square+1 : OFF_BOARD;
+                    step[square][2] = x>0 ? square-1 : OFF_BOARD;
+                    step[square][3] = y>0 ? square-N : OFF_BOARD;
+                    blocking_up[square][0] = y+1<N && x+1<N ? y*(N-1) + x : NO_MIDDLE;
+                    blocking_up[square][1] = y+1<N && x>0 ? y*(N-1) + x-1 : NO_MIDDLE;
+                    blocking_right[square][0] = x+1<N && y+1<N ? y*(N-1) + x : NO_MIDDLE;
+                    blocking_right[square][1] = x+1<N && y>0 ? (y-1)*(N-1) + x : NO_MIDDLE;
+                }
+            }
+            for (size_t middle=0;middle<(N-1)*(N-1);++middle)
+                wall_square[middle] = (middle / (N-1)) * N + middle % (N-1);
+        }
+    };
+
+    template <size_t N>
+    constexpr geometry<N> GEOMETRY;
+}
+
+template <size_t N, size_t W>
+basic_board<N, W>::action::action() noexcept
 {
     is_positional = false;
     token_position = 0;
@@ -30,226 +101,347 @@ board::action::action() noexcept
     wall_middle = 0;
 }
 
-void board::action::flip()
+template <size_t N, size_t W>
+void basic_board<N, W>::action::flip()
+{
+    token_position = NUM_SQUARES-1-token_position;
+    wall_middle = NUM_WALL_MIDDLES-1-wall_middle;
+}
+
+template <size_t N, size_t W>
+size_t basic_board<N, W>::action::get_id() const
+{
+    if (is_positional)
+        return token_position;
+    return NUM_SQUARES + (wall_is_vertical ? NUM_WALL_MIDDLES : 0) + wall_middle;
+}
+
+template <size_t N, size_t W>
+typename basic_board<N, W>::action basic_board<N, W>::action::from_id(const size_t id)
+{
+    if (id >= POLICY_SIZE)
+        throw std::string("Error: invalid action id ") + lexical_cast<std::string>(id);
+    action result;
+    if (id < NUM_SQUARES)
+    {
+        result.is_positional = true;
+        result.token_position = id;
+    }
+    else
+    {
+        result.wall_is_vertical = id >= NUM_SQUARES + NUM_WALL_MIDDLES;
+        result.wall_middle = (id - NUM_SQUARES) % NUM_WALL_MIDDLES;
+    }
+    return result;
+}
+
+template <size_t N, size_t W>
+std::string basic_board<N, W>::action::get_text() const
 {
-    token_position = BOARD_SIZE*BOARD_SIZE-1-token_position;
-    wall_middle = (BOARD_SIZE-1)*(BOARD_SIZE-1)-1-wall_middle;
+    // "*(x,y)" for a move to square (x,y), "H(x,y)" / "V(x,y)" for a wall centred on (x,y).
+    // Every coordinate is a single digit, so this is built directly rather than through lexical_cast.
+    const size_t width = is_positional ? BOARD_SIZE : BOARD_SIZE-1;
+    const size_t index = is_positional ? token_position : wall_middle;
+    char text[] = "*(x,y)";
+    if (!is_positional)
+        text[0] = wall_is_vertical ? 'V' : 'H';
+    text[2] = (char)('0' + index % width);
+    text[4] = (char)('0' + index / width);
+    return std::string(text, sizeof(text)-1);
 }
 
-board::board() noexcept
+template <size_t N, size_t W>
+basic_board<N, W>::rollout_policy::rollout_policy() noexcept : kind(RANDOM), path_probability(0.0)
+{}
+
+template <size_t N, size_t W>
+basic_board<N, W>::rollout_policy::rollout_policy(const heuristic kind, const double path_probability) noexcept :
+    kind(kind), path_probability(path_probability)
+{}
+
+template <size_t N, size_t W>
+basic_board<N, W>::basic_board() noexcept
 {
     // set game to starting position
-    hero_x = BOARD_SIZE / 2;
-    hero_y = 0;
-    villain_x = BOARD_SIZE / 2;
-    villain_y = BOARD_SIZE - 1;
+    hero_square = BOARD_SIZE / 2;
+    villain_square = (BOARD_SIZE - 1) * BOARD_SIZE + BOARD_SIZE / 2;
     hero_walls_remaining = STARTING_WALLS;
     villain_walls_remaining = STARTING_WALLS;
-    // to ensure the hash gets calculated when called
-    _stored_hash = 0;
+    flipped = false;
+    last_action_id = action().get_id();
+    horizontal_walls = grid::EDGE_TOP;
+    vertical_walls = grid::EDGE_RIGHT;
+    wall_middles = 0;
+    vertical_wall_middles = 0;
+    zobrist_key = ZOBRIST<N, W>.pawn[0][hero_square] ^ ZOBRIST<N, W>.pawn[1][villain_square]
+        ^ ZOBRIST<N, W>.walls_remaining[0][hero_walls_remaining] ^ ZOBRIST<N, W>.walls_remaining[1][villain_walls_remaining];
 }
 
-board::board(
-    const unsigned short _hero_x,
-    const unsigned short _hero_y,
-    const unsigned short _villain_x, 
-    const unsigned short _villain_y,
-    const unsigned short _hero_walls_remaining,
-    const unsigned short _villain_walls_remaining,
-    const flags::flags<(BOARD_SIZE-1)*(BOARD_SIZE-1)> & _wall_middles,
-    const flags::flags<(BOARD_SIZE-1)*BOARD_SIZE> & _horizontal_walls,
-    const flags::flags<(BOARD_SIZE-1)*BOARD_SIZE> & _vertical_walls
-) noexcept
+template <size_t N, size_t W>
+bool basic_board<N, W>::operator==(const basic_board & source) const noexcept
 {
-    hero_x=_hero_x;
-    hero_y=_hero_y;
-    villain_x=_villain_x;
-    villain_y=_villain_y;
-    hero_walls_remaining=_hero_walls_remaining;
-    villain_walls_remaining=_villain_walls_remaining;
-    wall_middles=_wall_middles;
-    horizontal_walls=_horizontal_walls;
-    vertical_walls=_vertical_walls;
-    // to ensure the hash gets calculated when called
+    return get_hash() == source.get_hash();
 }
 
-board& board::operator=(const board & source) noexcept
+template <size_t N, size_t W>
+bool basic_board<N, W>::is_valid() const noexcept
 {
-    if (&source==this)
-        return *this;
-    Deep_Copy(source, false);
-    return *this;
+    if (hero_square>=NUM_SQUARES || villain_square>=NUM_SQUARES || hero_square==villain_square)
+        return false;
+    if (hero_walls_remaining>STARTING_WALLS || villain_walls_remaining>STARTING_WALLS || last_action_id>=POLICY_SIZE)
+        return false;
+    const uint64_t all_middles = NUM_WALL_MIDDLES==64 ? ~uint64_t(0) : (uint64_t(1) << NUM_WALL_MIDDLES) - 1;
+    if ((wall_middles & ~all_middles) || (vertical_wall_middles & ~wall_middles))
+        return false;
+    const size_t walls = (size_t)__builtin_popcountll(wall_middles);
+    if (walls + hero_walls_remaining + villain_walls_remaining != 2*STARTING_WALLS)
+        return false;
+
+    // rebuild the masks and the key from the rest, as play_action would have
+    const size_t hero = flipped ? 1 : 0;
+    bitboard::mask horizontal = grid::EDGE_TOP, vertical = grid::EDGE_RIGHT;
+    uint64_t key = ZOBRIST<N, W>.pawn[hero][hero_square] ^ ZOBRIST<N, W>.pawn[1-hero][villain_square]
+        ^ ZOBRIST<N, W>.walls_remaining[hero][hero_walls_remaining] ^ ZOBRIST<N, W>.walls_remaining[1-hero][villain_walls_remaining]
+        ^ (flipped ? ZOBRIST<N, W>.flipped : 0);
+    for (size_t middle=0;middle<NUM_WALL_MIDDLES;++middle)
+    {
+        if (!((wall_middles >> middle) & 1))
+            continue;
+        const bool is_vertical = (vertical_wall_middles >> middle) & 1;
+        const bitboard::mask edges = get_wall_edges(middle, is_vertical);
+        bitboard::mask & walls_mask = is_vertical ? vertical : horizontal;
+        if (walls_mask & edges)
+            return false;
+        walls_mask |= edges;
+        key ^= ZOBRIST<N, W>.wall[is_vertical ? 1 : 0][middle];
+    }
+    return horizontal==horizontal_walls && vertical==vertical_walls && key==zobrist_key
+        && grid::reachable(bitboard::bit(hero_square), heros_goal(), horizontal_walls, vertical_walls)
+        && grid::reachable(bitboard::bit(villain_square), villains_goal(), horizontal_walls, vertical_walls);
 }
 
-bool board::operator==(const board & source) const noexcept
+// flip-copying represents the same board position from villain's perspective
+template <size_t N, size_t W>
+basic_board<N, W>::basic_board(const basic_board & source, bool flip) noexcept : basic_board(source)
 {
-    return get_hash() == source.get_hash();
+    if (flip)
+        this->flip();
 }
 
-board::~board() noexcept
-{}
-
-board::board(const board & source) noexcept
+template <size_t N, size_t W>
+bitboard::mask basic_board<N, W>::heros_goal() const
 {
-    if (&source==this)
-        return;
-    Deep_Copy(source, false);    
+    return flipped ? grid::row(0) : grid::row(BOARD_SIZE-1);
 }
 
-board::board(const board & source, bool flip) noexcept
+template <size_t N, size_t W>
+bitboard::mask basic_board<N, W>::villains_goal() const
 {
-    if (&source==this)
-        return;
-    Deep_Copy(source, flip);    
+    return flipped ? grid::row(BOARD_SIZE-1) : grid::row(0);
 }
 
 // check that there exists an unobstructed path between
 // villain's marker and their destination
-bool board::villain_is_escapable() const
-{
-    flags::flags<BOARD_SIZE*BOARD_SIZE> contact_flags;
-    // set villain's present location to true
-    contact_flags.set(size_t(villain_y*BOARD_SIZE + villain_x));
-    // search outwards recursively, starting from villain's current location
-    return check_local_escapable(villain_x, villain_y, contact_flags);
-}
-
-bool board::check_local_escapable (
-    const unsigned short x,
-    const unsigned short y,
-    flags::flags<BOARD_SIZE*BOARD_SIZE> & contact_flags) const
-{
-    // if the first row is reachable, villain is escapable and we're done
-    if (y==0) return true;
-
-    // Try down first and up last, as villain will generally be escaping downwards, so we're more likely to find
-    // a faster route this way.
-    // First term verifies that 1) we can move in that direction legally, and 2) we haven't already marked that square as
-    // reachable by villain.
-    // Second term then calls this function recursively so we can continue the expansion.
-    if (try_positional_move(x, y, 0, -1, &contact_flags) && check_local_escapable(x, y-1, contact_flags)) return true;
-    if (try_positional_move(x, y, 1, 0, &contact_flags) && check_local_escapable(x+1, y, contact_flags)) return true;
-    if (try_positional_move(x, y, -1, 0, &contact_flags) && check_local_escapable(x-1, y, contact_flags)) return true;
-    if (try_positional_move(x, y, 0, 1, &contact_flags) && check_local_escapable(x, y+1, contact_flags)) return true;
-    return false;
+template <size_t N, size_t W>
+bool basic_board<N, W>::villain_is_escapable() const
+{
+    return grid::reachable(bitboard::bit(villain_square), villains_goal(), horizontal_walls, vertical_walls);
 }
 
-unsigned short board::get_villains_shortest_distance() const
-{
-    // get a BOARD_SIZE x BOARD_SIZE array where, for each square,
-    // we will populate the minimum possible number of moves required
-    // to get from villain to the given square.
-    // The algorithm starts at villains current square (which we will give a value of zero)
-    // and iterates outwards.
-    // Values are all initialized to the maximum unsigned short value, which represents infinity.
-    // (This ensures that the check shortest_distance[sd_index]>curr_num_moves
-    // below is always true so that unexplored squares are always set) 
-    unsigned short shortest_distance[BOARD_SIZE*BOARD_SIZE];
-    for (size_t i=0;i<BOARD_SIZE*BOARD_SIZE;++i)
-        shortest_distance[i] = std::numeric_limits<unsigned short>::max();
-
-    // set villain's location to 0
-    // (if only finding yourself was that easy in real life)
-    shortest_distance[villain_y * BOARD_SIZE + villain_x] = 0;
-
-    // filled_points stores coordinates of squares filled on the last loop
-    // iteration. We initialize this to villain's current location 
-    std::vector<std::pair<unsigned short, unsigned short>> filled_points;
-    filled_points.emplace_back(std::make_pair(villain_x, villain_y));
-
-    // pairs of directional movement (down, left, right, up respectively)
-    // for looping convenience
-    const static short directions[8]={0,-1,-1,0,1,0,0,1};
-
-    // main while-like loop that keeps going until there are no remaining squares to visit
-    // (occurs when filled_points is empty). We put it in a for loop
-    // for convenience just to get the counter for the cumulative number
-    // of moves villain has made
-    for (unsigned short cumulative_moves=1;filled_points.size()>0;++cumulative_moves)
+template <size_t N, size_t W>
+bool basic_board<N, W>::hero_is_escapable() const
+{
+    return grid::reachable(bitboard::bit(hero_square), heros_goal(), horizontal_walls, vertical_walls);
+}
+
+template <size_t N, size_t W>
+unsigned short basic_board<N, W>::get_villains_shortest_distance() const
+{
+    // breadth-first search, expanding the whole frontier one step at a time.
+    // An unreachable goal gives the maximum unsigned short value, which represents infinity.
+    return grid::distance(
+        bitboard::bit(villain_square),
+        villains_goal(),
+        horizontal_walls,
+        vertical_walls,
+        std::numeric_limits<unsigned short>::max()
+    );
+}
+
+template <size_t N, size_t W>
+unsigned short basic_board<N, W>::get_heros_shortest_distance() const
+{
+    return grid::distance(
+        bitboard::bit(hero_square),
+        heros_goal(),
+        horizontal_walls,
+        vertical_walls,
+        std::numeric_limits<unsigned short>::max()
+    );
+}
+
+template <size_t N, size_t W>
+void basic_board<N, W>::get_shortest_distances(unsigned short & heros, unsigned short & villains) const
+{
+    grid::distances(
+        bitboard::bit(hero_square),
+        heros_goal(),
+        bitboard::bit(villain_square),
+        villains_goal(),
+        horizontal_walls,
+        vertical_walls,
+        heros,
+        villains,
+        std::numeric_limits<unsigned short>::max()
+    );
+}
+
+template <size_t N, size_t W>
+void basic_board<N, W>::get_path_edges(bitboard::mask & path_horizontal, bitboard::mask & path_vertical) const
+{
+    // both players always have a path in a legal position, but if not, fall
+    // back to treating every edge as critical (i.e. flood fill for every wall)
+    if (!grid::shortest_path(hero_square, heros_goal(), horizontal_walls, vertical_walls, path_horizontal, path_vertical)
+        || !grid::shortest_path(villain_square, villains_goal(), horizontal_walls, vertical_walls, path_horizontal, path_vertical))
     {
-        std::vector<std::pair<unsigned short, unsigned short>> next_filled_points;
-        std::for_each(
-            filled_points.cbegin(),
-            filled_points.cend(),
-            [&](const std::pair<unsigned short, unsigned short> & pr)
-        {
-            // iterate once for each direction (down, left, right, up)
-            for (size_t i=0;i<4;++i)
-            {
-                short x_diff = directions[2*i];
-                short y_diff = directions[2*i+1];
-                // check if a given directional move would be legal (i.e. no walls)
-                if (try_positional_move(pr.first, pr.second, x_diff, y_diff))
-                {
-                    // get the position, and compute its index in the array
-                    unsigned short x = (unsigned short)((short)pr.first + x_diff);
-                    unsigned short y = (unsigned short)((short)pr.second + y_diff);
-                    unsigned short sd_index = y * BOARD_SIZE + x;
-
-                    // check if there's a shorter route than what's currently stored
-                    // (always true for a yet-unvisited square)
-                    if (shortest_distance[sd_index]>cumulative_moves)
-                    {
-                        // store the move count in this square, and
-                        // add put it in the vector of squares to be
-                        // expanded next iteration. We keep doing this till
-                        // there are no new squares!
-                        shortest_distance[sd_index] = cumulative_moves;
-                        next_filled_points.emplace_back(std::make_pair(x,y));
-                    }
-                }
-            }
-        });
-        filled_points = std::move(next_filled_points);
+        path_horizontal = ~bitboard::mask(0);
+        path_vertical = ~bitboard::mask(0);
     }
+}
 
-    // find minimum value on first row (i.e. villain's terminal row)
-    // to get villains shortest overall distance 
-    unsigned short villains_shortest_distance = std::numeric_limits<unsigned short>::max();
-    for (size_t i=0;i<BOARD_SIZE;++i)
-        if (shortest_distance[i]<villains_shortest_distance)
-            villains_shortest_distance = shortest_distance[i];
+// edges blocked by a wall centred on middle (in absolute orientation)
+template <size_t N, size_t W>
+bitboard::mask basic_board<N, W>::get_wall_edges(const size_t middle, const bool vertical) const
+{
+    const size_t square = GEOMETRY<N>.wall_square[middle];
 
-    return villains_shortest_distance;
+    // a horizontal wall blocks the steps up from square and its right-hand neighbour;
+    // a vertical wall blocks the steps right from square and the square above it
+    return vertical
+        ? bitboard::bit(square) | bitboard::bit(square+BOARD_SIZE)
+        : bitboard::bit(square) | bitboard::bit(square+1);
 }
 
-unsigned short board::get_heros_shortest_distance() const
+// checks a wall placement on an unoccupied middle, given the edges
+// on both players' shortest paths (see get_path_edges)
+template <size_t N, size_t W>
+bool basic_board<N, W>::wall_is_legal(
+    const size_t middle,
+    const bool vertical,
+    const bitboard::mask path_horizontal,
+    const bitboard::mask path_vertical) const
 {
-    return board(*this,true).get_villains_shortest_distance();
+    bitboard::mask wall = get_wall_edges(middle, vertical);
+
+    // can't overlap an existing wall
+    if ((vertical ? vertical_walls : horizontal_walls) & wall)
+        return false;
+
+    // if the wall leaves both shortest paths intact, both players are still escapable
+    if (!((vertical ? path_vertical : path_horizontal) & wall))
+        return true;
+
+    // otherwise ensure both players are escapable
+    bitboard::mask proposed_horizontal = vertical ? horizontal_walls : horizontal_walls | wall;
+    bitboard::mask proposed_vertical = vertical ? vertical_walls | wall : vertical_walls;
+    return grid::reachable(bitboard::bit(villain_square), villains_goal(), proposed_horizontal, proposed_vertical)
+        && grid::reachable(bitboard::bit(hero_square), heros_goal(), proposed_horizontal, proposed_vertical);
 }
 
 // function signature for eval includes the most general case where we have an eval function that returns
 // both a Q value and a policy consisting of a vector of probs corresponding with probs of children 
-void board::eval(const std::vector<board_node_ptr> & children, double & eval_Q, std::vector<double> & eval_probs) const
+template <size_t N, size_t W>
+void basic_board<N, W>::eval(const board_node_block & children, double & eval_Q, std::vector<double> & eval_probs) const
 {
     throw std::string("eval not implemented");
 }
 
-// hash caching with lazy evaluation
-size_t board::get_hash() const
-{   
-    if(!_stored_hash)
-    {
-        hash_combine(_stored_hash,hero_x);
-        hash_combine(_stored_hash,hero_y);
-        hash_combine(_stored_hash,villain_x);
-        hash_combine(_stored_hash,villain_y);
-        hash_combine(_stored_hash,hero_walls_remaining);
-        hash_combine(_stored_hash,villain_walls_remaining);
-        hash_combine(_stored_hash,wall_middles.get_hash());
-        hash_combine(_stored_hash,horizontal_walls.get_hash());
-        hash_combine(_stored_hash,vertical_walls.get_hash());
-    }
-    return _stored_hash;
+template <size_t N, size_t W>
+size_t basic_board<N, W>::get_hash() const
+{
+    return zobrist_key;
     // NB: we intentionally leave _action out of the hash as the hash is only for the position
 }
 
-bool board::is_terminal() const
+// square is in absolute orientation
+template <size_t N, size_t W>
+void basic_board<N, W>::move_hero(const unsigned char square)
+{
+    const size_t hero = flipped ? 1 : 0;
+    zobrist_key ^= ZOBRIST<N, W>.pawn[hero][hero_square] ^ ZOBRIST<N, W>.pawn[hero][square];
+    hero_square = square;
+}
+
+// middle is in absolute orientation. Takes one of hero's walls.
+template <size_t N, size_t W>
+void basic_board<N, W>::place_wall(const size_t middle, const bool vertical)
+{
+    const size_t hero = flipped ? 1 : 0;
+    wall_middles |= uint64_t(1) << middle;
+    if (vertical)
+        vertical_wall_middles |= uint64_t(1) << middle;
+    (vertical ? vertical_walls : horizontal_walls) |= get_wall_edges(middle, vertical);
+    zobrist_key ^= ZOBRIST<N, W>.wall[vertical ? 1 : 0][middle]
+        ^ ZOBRIST<N, W>.walls_remaining[hero][hero_walls_remaining]
+        ^ ZOBRIST<N, W>.walls_remaining[hero][hero_walls_remaining-1];
+    --hero_walls_remaining;
+}
+
+// move is in absolute orientation, and must be legal. Leaves the board flipped to villain's turn.
+template <size_t N, size_t W>
+void basic_board<N, W>::play_action(const action & move)
+{
+    if (move.is_positional)
+        play_positional_move(move.token_position);
+    else
+        play_wall_move(move.wall_middle, move.wall_is_vertical);
+}
+
+// square is in absolute orientation, and must be one of get_positional_destinations. Leaves
+// the board flipped to villain's turn.
+template <size_t N, size_t W>
+void basic_board<N, W>::play_positional_move(const unsigned char square)
+{
+    move_hero(square);
+    last_action_id = square;
+    flip();
+}
+
+// middle is in absolute orientation. The wall must already be known to be legal. Leaves the
+// board flipped to villain's turn.
+template <size_t N, size_t W>
+void basic_board<N, W>::play_wall_move(const size_t middle, const bool vertical)
+{
+    place_wall(middle, vertical);
+    action move;
+    move.wall_is_vertical=vertical;
+    move.wall_middle=middle;
+    last_action_id = move.get_id();
+    flip();
+}
+
+// in place version of the flip-copy
+template <size_t N, size_t W>
+void basic_board<N, W>::flip()
+{
+    // (bit-fields can't be std::swapped)
+    const unsigned square = hero_square, walls_remaining = hero_walls_remaining;
+    hero_square = villain_square;
+    villain_square = square;
+    hero_walls_remaining = villain_walls_remaining;
+    villain_walls_remaining = walls_remaining;
+    flipped = !flipped;
+    zobrist_key^=ZOBRIST<N, W>.flipped;
+}
+
+template <size_t N, size_t W>
+bool basic_board<N, W>::is_terminal() const
 {
     return hero_wins() || villain_wins();
 }
 
-double board::get_terminal_eval() const
+template <size_t N, size_t W>
+double basic_board<N, W>::get_terminal_eval() const
 {
     if (hero_wins())
         return 1.0;
@@ -259,36 +451,100 @@ double board::get_terminal_eval() const
         throw std::string("Error: can only get eval for board states that are terminal.");
 }
 
-std::string board::get_action_text(const bool flip) const
+template <size_t N, size_t W>
+std::string basic_board<N, W>::get_action_text(const bool flip) const
 {
-    action use_action(_action);
-    if (flip) use_action.flip();
+    // the action is stored in absolute orientation, so we rotate it into the requested perspective
+    action use_action(action::from_id(last_action_id));
+    if (flip != flipped) use_action.flip();
     // we flip because we're usually interested in seeing this from the previous hero's perspective
     // (e.g. when we're evaluating hero's move)
-    if(use_action.is_positional)
+    return use_action.get_text();
+}
+
+template <size_t N, size_t W>
+size_t basic_board<N, W>::get_action_id(const bool flip) const
+{
+    action use_action(action::from_id(last_action_id));
+    if (flip != flipped) use_action.flip();
+    return use_action.get_id();
+}
+
+template <size_t N, size_t W>
+std::string basic_board<N, W>::action_id_to_text(const size_t action_id)
+{
+    return action::from_id(action_id).get_text();
+}
+
+template <size_t N, size_t W>
+size_t basic_board<N, W>::flip_action_id(const size_t action_id)
+{
+    action use_action(action::from_id(action_id));
+    use_action.flip();
+    return use_action.get_id();
+}
+
+template <size_t N, size_t W>
+size_t basic_board<N, W>::action_text_to_id(const std::string & action_text)
+{
+    // the inverse of action::get_text
+    if (action_text.size()==6 && action_text[1]=='(' && action_text[3]==',' && action_text[5]==')'
+        && action_text[2]>='0' && action_text[2]<='9' && action_text[4]>='0' && action_text[4]<='9')
     {
-        unsigned short _hero_x = use_action.token_position % BOARD_SIZE;
-        unsigned short _hero_y = use_action.token_position / BOARD_SIZE;
-        return std::string("*(")
-            + lexical_cast<std::string>(_hero_x)
-            + std::string(",")
-            + lexical_cast<std::string>(_hero_y)
-            + std::string(")");
+        const size_t x = action_text[2]-'0', y = action_text[4]-'0';
+        if (action_text[0]=='*' && x<BOARD_SIZE && y<BOARD_SIZE)
+            return y*BOARD_SIZE + x;
+        if ((action_text[0]=='H' || action_text[0]=='V') && x<BOARD_SIZE-1 && y<BOARD_SIZE-1)
+            return NUM_SQUARES + (action_text[0]=='V' ? NUM_WALL_MIDDLES : 0) + y*(BOARD_SIZE-1) + x;
     }
-    else
+    throw std::string("Error: invalid action text ") + action_text;
+}
+
+template <size_t N, size_t W>
+void basic_board<N, W>::encode(float * planes) const
+{
+    std::fill(planes, planes + ENCODING_SIZE, 0.0f);
+
+    // map from absolute orientation into hero's perspective
+    const size_t _hero_square = flipped ? NUM_SQUARES-1-hero_square : hero_square;
+    const size_t _villain_square = flipped ? NUM_SQUARES-1-villain_square : villain_square;
+    planes[0*NUM_SQUARES + _hero_square] = 1.0f;
+    planes[1*NUM_SQUARES + _villain_square] = 1.0f;
+    for (size_t middle=0;middle<NUM_WALL_MIDDLES;++middle)
     {
-        unsigned short _wall_x = use_action.wall_middle % (BOARD_SIZE-1);
-        unsigned short _wall_y = use_action.wall_middle / (BOARD_SIZE-1);
-        std::string orientation((use_action.wall_is_vertical?"V":"H"));
-        return orientation + std::string("(")
-            + lexical_cast<std::string>(_wall_x)
-            + std::string(",")                          
-            + lexical_cast<std::string>(_wall_y)
-            + std::string(")");
+        if ((wall_middles >> middle) & 1)
+        {
+            const size_t i = flipped ? NUM_WALL_MIDDLES-1-middle : middle;
+            const size_t square = GEOMETRY<N>.wall_square[i];
+            const size_t plane = ((vertical_wall_middles >> middle) & 1) ? 3 : 2;
+            planes[plane*NUM_SQUARES + square] = 1.0f;
+        }
     }
+    std::fill(planes + 4*NUM_SQUARES, planes + 5*NUM_SQUARES, (float)hero_walls_remaining / STARTING_WALLS);
+    std::fill(planes + 5*NUM_SQUARES, planes + 6*NUM_SQUARES, (float)villain_walls_remaining / STARTING_WALLS);
 }
 
-std::string board::display() const
+template <size_t N, size_t W>
+void basic_board<N, W>::get_legal_action_ids(std::vector<size_t> & output, const bool flip) const
+{
+    // (the moves are flipped relative to this board, see get_action_id)
+    for_each_legal_action([&](action move)
+    {
+        if (flip == flipped) move.flip();
+        output.push_back(move.get_id());
+    });
+}
+
+template <size_t N, size_t W>
+void basic_board<N, W>::play_action_id(const size_t action_id)
+{
+    action move(action::from_id(action_id));
+    if (flipped) move.flip();
+    play_action(move);
+}
+
+template <size_t N, size_t W>
+std::string basic_board<N, W>::display() const
 {
     std::vector<std::string> rows;
 
@@ -311,18 +567,23 @@ std::string board::display() const
 
     std::string em("—");
 
+    // everything is displayed from hero's perspective, so map from absolute
+    // orientation where necessary
+    unsigned short _hero_square = flipped ? NUM_SQUARES-1-hero_square : hero_square;
+    unsigned short _villain_square = flipped ? NUM_SQUARES-1-villain_square : villain_square;
+
     // compute locations of hero markers
-    unsigned short output_hero_x = 2 + hero_x * 4;
-    unsigned short output_hero_y = 1 + (BOARD_SIZE - 1 - hero_y) * 2;
-    unsigned short output_villain_x = 2 + villain_x * 4;
-    unsigned short output_villain_y = 1 + (BOARD_SIZE - 1 - villain_y) * 2;
+    unsigned short output_hero_x = 2 + (_hero_square % BOARD_SIZE) * 4;
+    unsigned short output_hero_y = 1 + (BOARD_SIZE - 1 - _hero_square / BOARD_SIZE) * 2;
+    unsigned short output_villain_x = 2 + (_villain_square % BOARD_SIZE) * 4;
+    unsigned short output_villain_y = 1 + (BOARD_SIZE - 1 - _villain_square / BOARD_SIZE) * 2;
     rows[output_hero_y].replace(output_hero_x,1,"h");
     rows[output_villain_y].replace(output_villain_x,1,"v");
 
     // add wall intersections
-    for (size_t i=0;i<(BOARD_SIZE-1)*(BOARD_SIZE-1);++i)
+    for (size_t i=0;i<NUM_WALL_MIDDLES;++i)
     {
-        if(wall_middles.test(i))
+        if((wall_middles >> (flipped ? NUM_WALL_MIDDLES-1-i : i)) & 1)
         {
             size_t wall_x = 4 + (i % (BOARD_SIZE-1)) * 4;
             size_t wall_y = 2 + (BOARD_SIZE - 2 - i / (BOARD_SIZE-1)) * 2;
@@ -330,28 +591,30 @@ std::string board::display() const
         }
     }
 
-    // add horizontal and vertical walls
-    for (size_t i=0;i<(BOARD_SIZE-1)*BOARD_SIZE;++i)
+    // add horizontal and vertical walls (i is the square below / to the left of the wall)
+    for (size_t i=0;i<NUM_SQUARES;++i)
     {
-        if(horizontal_walls.test(i))
+        size_t x = i % BOARD_SIZE;
+        size_t y = i / BOARD_SIZE;
+        if(y<BOARD_SIZE-1 && bitboard::test(horizontal_walls, flipped ? NUM_SQUARES-1-BOARD_SIZE-i : i))
         {
-            size_t wall_x = 1 + (i % BOARD_SIZE) * 4;
-            size_t wall_y = 2 + (BOARD_SIZE - 2 - i / BOARD_SIZE) * 2;
+            size_t wall_x = 1 + x * 4;
+            size_t wall_y = 2 + (BOARD_SIZE - 2 - y) * 2;
             rows[wall_y].replace(wall_x,1,"-");
             rows[wall_y].replace(wall_x+1,1,"-");
             rows[wall_y].replace(wall_x+2,1,"-");
         }
-        if(vertical_walls.test(i))
+        if(x<BOARD_SIZE-1 && bitboard::test(vertical_walls, flipped ? NUM_SQUARES-2-i : i))
         {
 
-            size_t wall_x = 4 + (i / BOARD_SIZE) * 4;
-            size_t wall_y = 1 + (BOARD_SIZE - 1 - i % BOARD_SIZE) * 2;
+            size_t wall_x = 4 + x * 4;
+            size_t wall_y = 1 + (BOARD_SIZE - 1 - y) * 2;
             rows[wall_y].replace(wall_x,1,"|");
         }
     }
 
-    unsigned short _villains_shortest_distance = get_villains_shortest_distance();
-    unsigned short _heros_shortest_distance = get_heros_shortest_distance();
+    unsigned short _heros_shortest_distance, _villains_shortest_distance;
+    get_shortest_distances(_heros_shortest_distance, _villains_shortest_distance);
 
     std::string output;
     output += std::string("Hero distance from end: ") + lexical_cast<std::string>(_heros_shortest_distance) + std::string("\n");
@@ -367,14 +630,17 @@ std::string board::display() const
     return std::move(output);
 }
 
-// if no walls are left, we can easily determine who will win 
-// as it's just a straight race. We conservatively require a margin
-// of 2 moves to declare a victor just to be sure piece hopping,
-// who's first to act, etc won't change the outcome of the race.
-bool board::check_non_terminal_eval(double & eval) const
+// if no walls are left, it's just a race, which solve_race plays out
+// exactly (the pawns can get in each other's way, so a lead in distance
+// alone doesn't settle it). For the rare races it can't settle, we
+// conservatively require a margin of 2 moves to declare a victor just to
+// be sure piece hopping, who's first to act, etc won't change the outcome.
+template <size_t N, size_t W>
+bool basic_board<N, W>::check_non_terminal_eval(double & eval) const
 {
     if (is_terminal()) return false;
     if (hero_walls_remaining>0 || villain_walls_remaining>0) return false;
+    if (solve_race(eval)) return true;
 
     int _non_terminal_rank = get_non_terminal_rank();
     if (_non_terminal_rank<=-2)
@@ -392,106 +658,406 @@ bool board::check_non_terminal_eval(double & eval) const
     return false;
 }
 
-int board::get_non_terminal_rank() const
+// What a race search needs besides the board: each player's distance to goal from every
+// square (the walls can't change any more), and the outcomes found so far, by side to move
+// and pawn squares (in absolute orientation). Only proven outcomes are remembered, so they
+// hold however deep the search was when it found them.
+//
+// Each thread keeps one (see solve_race), so a search only clears its outcomes, and the
+// distances are only worked out again when the walls differ from the last search's.
+template <size_t N, size_t W>
+struct basic_board<N, W>::race_search
 {
-    // high rank is better for hero
-    unsigned short villains_shortest_distance = get_villains_shortest_distance();
-    unsigned short heros_shortest_distance = get_heros_shortest_distance();
-    return (int)villains_shortest_distance - (int)heros_shortest_distance;
-}
+    // positions searched before giving up. Races are checked at every node the tree search
+    // selects and at the end of rollouts, so this is kept small: the races it can't settle
+    // are left to the tree's proofs
+    constexpr static size_t MAX_NODES = 256;
+
+    unsigned char distance[2][NUM_SQUARES]; // indexed by absolute player, like the Zobrist keys
+    signed char outcome[2][NUM_SQUARES][NUM_SQUARES]; // 1 hero wins, -1 villain wins, 0 not known
+    size_t nodes_left;
+    bitboard::mask horizontal_walls, vertical_walls; // the walls distance is for
+    bool has_distances;
+};
 
-void board::Deep_Copy(const board & source, bool flip)
+// Solves a race (neither player has walls left) exactly, by alpha-beta search over the pawn
+// moves. Returns false (leaving eval alone) if the search runs out of nodes, or the players
+// can keep each other from ever finishing. Rollouts ask about every position they pass
+// through, so the last few answers are cached per thread.
+template <size_t N, size_t W>
+bool basic_board<N, W>::solve_race(double & eval) const
 {
-    // flip-copying represents the same board position from villain's perspective
-    if (flip)
+    struct cache_entry
     {
-        hero_x=BOARD_SIZE-1-source.villain_x;
-        hero_y=BOARD_SIZE-1-source.villain_y;
-        villain_x=BOARD_SIZE-1-source.hero_x;
-        villain_y=BOARD_SIZE-1-source.hero_y;
-        hero_walls_remaining=source.villain_walls_remaining;
-        villain_walls_remaining=source.hero_walls_remaining;
-        wall_middles=source.wall_middles; wall_middles.flip();
-        horizontal_walls=source.horizontal_walls; horizontal_walls.flip();
-        vertical_walls=source.vertical_walls; vertical_walls.flip();
-        _action = source._action; _action.flip();
+        uint64_t key;
+        signed char outcome; // as race_outcome, with 2 for an empty entry
+    };
+    constexpr size_t CACHE_SIZE = 4096;
+    static thread_local cache_entry cache[CACHE_SIZE] = {};
+    static thread_local bool cache_ready = false;
+    if (!cache_ready)
+    {
+        for (cache_entry & entry : cache)
+            entry.outcome = 2;
+        cache_ready = true;
     }
-    else
+
+    cache_entry & entry = cache[zobrist_key % CACHE_SIZE];
+    if (entry.outcome==2 || entry.key!=zobrist_key)
+    {
+        static thread_local race_search search = {};
+        if (!search.has_distances || search.horizontal_walls!=horizontal_walls || search.vertical_walls!=vertical_walls)
+        {
+            for (size_t player=0;player<2;++player)
+            {
+                const bitboard::mask goal = grid::row(player==0 ? BOARD_SIZE-1 : 0);
+                grid::distance_map(goal, horizontal_walls, vertical_walls, search.distance[player], std::numeric_limits<unsigned char>::max());
+            }
+            search.horizontal_walls = horizontal_walls;
+            search.vertical_walls = vertical_walls;
+            search.has_distances = true;
+        }
+        std::memset(search.outcome, 0, sizeof(search.outcome));
+        search.nodes_left = race_search::MAX_NODES;
+        const unsigned depth = 2 * ((unsigned)search.distance[flipped][hero_square] + search.distance[!flipped][villain_square]) + 4;
+        entry.key = zobrist_key;
+        entry.outcome = (signed char)race_outcome(search, depth);
+    }
+    if (entry.outcome==0)
+        return false;
+    eval = entry.outcome;
+    return true;
+}
+
+// the outcome of the race with hero to move, as far as depth more plies can tell: 1 if hero
+// wins, -1 if villain wins, 0 if it isn't settled within depth (or search's node budget).
+//
+// The pawns only affect each other's moves once they're a step apart, so until then it's a
+// straight race, which hero (moving first) wins on equal distances. Before the pawns can
+// close to a step apart they have to cover the distance between them, one step a ply, so if
+// the race is over sooner than that, its outcome is settled.
+template <size_t N, size_t W>
+int basic_board<N, W>::race_outcome(race_search & search, const unsigned depth) const
+{
+    if (villain_wins()) return -1;
+    if (hero_wins()) return 1;
+    const unsigned heros_distance = search.distance[flipped][hero_square];
+    const unsigned villains_distance = search.distance[!flipped][villain_square];
+    // (hero's last move is ply 2*heros_distance-1, villain's 2*villains_distance)
+    const bool hero_first = heros_distance<=villains_distance;
+    const unsigned needed = hero_first ? 2*heros_distance : 2*villains_distance+1;
+    // walls only lengthen the way between the pawns, so the flood fill is only needed when
+    // the straight line between them is too short
+    const unsigned dx = std::max(hero_square%BOARD_SIZE, villain_square%BOARD_SIZE) - std::min(hero_square%BOARD_SIZE, villain_square%BOARD_SIZE);
+    const unsigned dy = std::max(hero_square/BOARD_SIZE, villain_square/BOARD_SIZE) - std::min(hero_square/BOARD_SIZE, villain_square/BOARD_SIZE);
+    const unsigned apart = dx+dy>=needed ? dx+dy
+        : grid::distance(bitboard::bit(hero_square), bitboard::bit(villain_square), horizontal_walls, vertical_walls, std::numeric_limits<unsigned short>::max());
+    if (apart>=needed) return hero_first ? 1 : -1;
+
+    signed char & outcome = search.outcome[flipped][hero_square][villain_square];
+    if (outcome!=0) return outcome;
+    if (depth==0 || search.nodes_left==0) return 0;
+    --search.nodes_left;
+
+    // the moves towards goal first, as they're the likeliest to win
+    unsigned char destinations[MAX_POSITIONAL_MOVES];
+    const size_t num_destinations = get_positional_destinations(destinations);
+    const unsigned char * heros_distances = search.distance[flipped];
+    for (size_t i=1;i<num_destinations;++i)
+        for (size_t j=i;j>0 && heros_distances[destinations[j]]<heros_distances[destinations[j-1]];--j)
+            std::swap(destinations[j], destinations[j-1]);
+
+    bool settled = num_destinations>0;
+    for (size_t i=0;i<num_destinations;++i)
     {
-        hero_x=source.hero_x;
-        hero_y=source.hero_y;
-        villain_x=source.villain_x;
-        villain_y=source.villain_y;
-        hero_walls_remaining=source.hero_walls_remaining;
-        villain_walls_remaining=source.villain_walls_remaining;
-        wall_middles=source.wall_middles;
-        horizontal_walls=source.horizontal_walls;
-        vertical_walls=source.vertical_walls;
-        _action = source._action;
-    } 
-    _stored_hash = 0; // to ensure we recompute the hash
+        basic_board next(*this);
+        next.play_positional_move(destinations[i]);
+        const int result = -next.race_outcome(search, depth-1);
+        if (result==1)
+            return outcome = 1;
+        settled = settled && result==-1;
+    }
+    if (settled)
+        outcome = -1;
+    return outcome;
 }
 
-bool board::hero_wins() const
+template <size_t N, size_t W>
+int basic_board<N, W>::get_non_terminal_rank() const
 {
-    return hero_y == BOARD_SIZE-1;
+    // high rank is better for hero
+    unsigned short heros_shortest_distance, villains_shortest_distance;
+    get_shortest_distances(heros_shortest_distance, villains_shortest_distance);
+    return (int)villains_shortest_distance - (int)heros_shortest_distance;
 }
 
-bool board::villain_wins() const
+template <size_t N, size_t W>
+bool basic_board<N, W>::hero_wins() const
 {
-    return villain_y == 0;
+    return bitboard::test(heros_goal(), hero_square);
 }
 
-// last argument is optional, for case where we're using contact flags
-bool board::try_positional_move(const unsigned short x, const unsigned short y, const short x_diff, const short y_diff, flags::flags<BOARD_SIZE*BOARD_SIZE> * const contact_flags) const
+template <size_t N, size_t W>
+bool basic_board<N, W>::villain_wins() const
 {
-    // check that the proposed move is only a single step in a single direction
-    // (don't really need to incur the cost of this check anymore since this exception was never getting thrown)
-    // if (abs((int)x_diff) + abs((int)y_diff) != 1) throw std::string("Error: board::try_positional_move dimensions must agree.");
+    return bitboard::test(villains_goal(), villain_square);
+}
 
-    // keep these signed to ensure we catch negative values
-    short proposed_hero_x = (short)x + x_diff;
-    short proposed_hero_y = (short)y + y_diff;
+// checks whether a single step in direction dir (from hero's perspective)
+// is possible from square, i.e. it stays on the board and doesn't cross a wall
+template <size_t N, size_t W>
+bool basic_board<N, W>::try_positional_move(const unsigned char square, const direction dir) const
+{
+    // map to the absolute direction
+    direction absolute_dir = flipped ? direction(DOWN - dir) : dir;
 
-    // check that we're remaining within game boundaries
-    if (proposed_hero_x<0 ||
-        proposed_hero_y<0 ||
-        proposed_hero_x>=BOARD_SIZE ||
-        proposed_hero_y>=BOARD_SIZE)
+    // the top and right board edges are part of the wall masks; a step down or left crosses
+    // the edge between the square it lands on and the one above or right of it
+    const unsigned char next_square = GEOMETRY<N>.step[square][absolute_dir];
+    switch (absolute_dir)
+    {
+        case UP:
+            return !bitboard::test(horizontal_walls, square);
+        case DOWN:
+            return next_square!=geometry<N>::OFF_BOARD && !bitboard::test(horizontal_walls, next_square);
+        case RIGHT:
+            return !bitboard::test(vertical_walls, square);
+        case LEFT:
+            return next_square!=geometry<N>::OFF_BOARD && !bitboard::test(vertical_walls, next_square);
+    }
+    return false;
+}
+
+// the square one step from square in direction dir (which must be possible)
+template <size_t N, size_t W>
+unsigned char basic_board<N, W>::get_step(const unsigned char square, const direction dir) const
+{
+    return GEOMETRY<N>.step[square][flipped ? direction(DOWN - dir) : dir];
+}
+
+// the squares hero can move to (in absolute orientation, in the order get_legal_moves
+// generates them), returning how many there are
+template <size_t N, size_t W>
+size_t basic_board<N, W>::get_positional_destinations(unsigned char destinations[MAX_POSITIONAL_MOVES]) const
+{
+    size_t count=0;
+    add_positional_destinations(hero_square, UP, destinations, count);
+    add_positional_destinations(hero_square, RIGHT, destinations, count);
+    add_positional_destinations(hero_square, LEFT, destinations, count);
+    add_positional_destinations(hero_square, DOWN, destinations, count);
+    return count;
+}
+
+// dir is from hero's perspective. Returns true if at least one destination was added.
+template <size_t N, size_t W>
+bool basic_board<N, W>::add_positional_destinations(const unsigned char square, const direction dir, unsigned char destinations[MAX_POSITIONAL_MOVES], size_t & count) const
+{
+    if (!try_positional_move(square, dir))
         return false;
 
-    // check that we don't already have a contact flag set to true.
-    // (only checked when the pointer is not null)
-    size_t contact_flag_index = (size_t)(proposed_hero_y*BOARD_SIZE + proposed_hero_x);
-    if (contact_flags && contact_flags->test(contact_flag_index))
-            return false;
+    const unsigned char next_square = get_step(square, dir);
+    if (next_square!=villain_square)
+    {
+        // it's a legal move!!
+        destinations[count++]=next_square;
+        return true;
+    }
+
+    // villain is in this square: see if it's a legal move to keep going in the same direction
+    if (add_positional_destinations(next_square, dir, destinations, count))
+        return true;
 
-    // check that we didn't cross any walls
-    if (x_diff!=0)
+    // if we reached this point, continuing in the same direction wasn't
+    // legal-- so we check orthogonal moves
+    bool move1, move2;
+    if (dir==RIGHT || dir==LEFT)
     {
-        // horizontal move -- check for vertical walls
+        // horizontal move-- check vertical moves
+        move1 = add_positional_destinations(next_square, UP, destinations, count);
+        move2 = add_positional_destinations(next_square, DOWN, destinations, count);
+    }
+    else
+    {
+        // vertical move-- check horizontal moves
+        move1 = add_positional_destinations(next_square, RIGHT, destinations, count);
+        move2 = add_positional_destinations(next_square, LEFT, destinations, count);
+    }
+    return move1 || move2;
+}
 
-        // compute index of horizontal wall that was immediately to hero's right
-        // before they made thier (proposed) move. This is the right wall to
-        // check if the proposed move is rightward.
-        unsigned short wall_index = BOARD_SIZE*x + y;
+// Draws uniformly from the positional moves plus every (middle, orientation) wall slot, and
+// redraws until the draw is legal (rejection sampling). Under the RANDOM policy every legal
+// move is equally likely, and only the walls actually drawn get checked (most of them
+// without a flood fill, see wall_is_legal).
+template <size_t N, size_t W>
+void basic_board<N, W>::make_rollout_move(const rollout_policy & policy, mcts::Rand & rand)
+{
+    unsigned char destinations[MAX_POSITIONAL_MOVES];
+    const size_t num_destinations = get_positional_destinations(destinations);
 
-        // If the proposed move is leftward, we need to reduce this index by 1 row.
-        if (x_diff<0) wall_index -=BOARD_SIZE;
+    if (policy.kind!=rollout_policy::RANDOM && num_destinations>0
+        && policy.path_probability>0 && mcts::unif(rand)<policy.path_probability)
+    {
+        play_positional_move(get_closest_to_goal(destinations, num_destinations, rand));
+        return;
+    }
+
+    const size_t num_wall_slots = hero_walls_remaining>0 ? 2*NUM_WALL_MIDDLES : 0;
+    const size_t num_slots = num_destinations + num_wall_slots;
 
-        if (vertical_walls.test((size_t)wall_index)) return false;
+    // smart walls: walls are as likely as under RANDOM, but drawn only from those that
+    // lengthen villain's path (falling back to a positional move if there aren't any)
+    if (policy.kind==rollout_policy::SMART_WALLS)
+    {
+        const size_t slot = mcts::random_index(num_slots, rand);
+        if (slot>=num_destinations && play_smart_wall(rand))
+            return;
+        if (num_destinations>0)
+        {
+            play_positional_move(destinations[slot<num_destinations ? slot : mcts::random_index(num_destinations, rand)]);
+            return;
+        }
     }
     else
     {
-        // vertical move -- check for horizontal walls.
-        // use similar logic as in horizontal case.
-        unsigned short wall_index = BOARD_SIZE*y + x;
-        if (y_diff<0) wall_index-=BOARD_SIZE;
-        if (horizontal_walls.test((size_t)wall_index)) return false;
-    }    
+        bool have_path_edges = false;
+        bitboard::mask path_horizontal=0, path_vertical=0;
 
-    // set contact flag to true (if applicible)
-    if (contact_flags) contact_flags->set(contact_flag_index);
+        // far more attempts than any real position needs (there are always positional
+        // moves or plenty of legal walls), but guarantees termination
+        for (size_t attempt=0;attempt<4*num_slots;++attempt)
+        {
+            const size_t slot = mcts::random_index(num_slots, rand);
+            if (slot<num_destinations)
+            {
+                play_positional_move(destinations[slot]);
+                return;
+            }
 
-    return true;
-}
\ No newline at end of file
+            // wall slots are in hero's orientation, like in get_legal_moves
+            const size_t i = (slot-num_destinations) / 2;
+            const size_t middle = flipped ? NUM_WALL_MIDDLES-1-i : i;
+            const bool vertical = (slot-num_destinations) % 2;
+            if ((wall_middles >> middle) & 1)
+                continue;
+            if (!have_path_edges)
+            {
+                get_path_edges(path_horizontal, path_vertical);
+                have_path_edges = true;
+            }
+            if (wall_is_legal(middle, vertical, path_horizontal, path_vertical))
+            {
+                play_wall_move(middle, vertical);
+                return;
+            }
+        }
+    }
+
+    // (never reached in practice)
+    std::vector<basic_board> moves;
+    get_legal_moves(moves);
+    if (moves.empty())
+        throw std::string("Error: board::make_rollout_move called with no legal moves");
+    *this = mcts::select_random_value(moves, rand);
+}
+
+// Places a random legal wall that lengthens villain's shortest path, if there is one. Only
+// walls that cut villain's current shortest path can, so those are the only candidates.
+template <size_t N, size_t W>
+bool basic_board<N, W>::play_smart_wall(mcts::Rand & rand)
+{
+    if (hero_walls_remaining==0)
+        return false;
+
+    bitboard::mask villains_horizontal=0, villains_vertical=0;
+    if (!grid::shortest_path(villain_square, villains_goal(), horizontal_walls, vertical_walls, villains_horizontal, villains_vertical))
+        return false;
+
+    // every wall blocking an edge of the path: an edge is blocked by the wall centred at
+    // either end of it (when that middle exists)
+    unsigned short candidates[4*NUM_SQUARES];
+    size_t count=0;
+    for (size_t square=0;square<NUM_SQUARES;++square)
+    {
+        if (bitboard::test(villains_horizontal, square))
+            for (const unsigned char middle : GEOMETRY<N>.blocking_up[square])
+                if (middle!=geometry<N>::NO_MIDDLE)
+                    candidates[count++] = 2*middle;
+        if (bitboard::test(villains_vertical, square))
+            for (const unsigned char middle : GEOMETRY<N>.blocking_right[square])
+                if (middle!=geometry<N>::NO_MIDDLE)
+                    candidates[count++] = 2*middle + 1;
+    }
+
+    bitboard::mask path_horizontal=0, path_vertical=0;
+    get_path_edges(path_horizontal, path_vertical);
+    const unsigned short villains_distance = get_villains_shortest_distance();
+
+    // draw without replacement until one works
+    while (count>0)
+    {
+        const size_t i = mcts::random_index(count, rand);
+        const size_t middle = candidates[i] / 2;
+        const bool vertical = candidates[i] % 2;
+        candidates[i] = candidates[--count];
+        if (!((wall_middles >> middle) & 1)
+            && wall_is_legal(middle, vertical, path_horizontal, path_vertical)
+            && lengthens_villains_path(middle, vertical, villains_distance))
+        {
+            play_wall_move(middle, vertical);
+            return true;
+        }
+    }
+    return false;
+}
+
+// the destination with the shortest remaining distance to hero's goal (ties broken at random)
+template <size_t N, size_t W>
+unsigned char basic_board<N, W>::get_closest_to_goal(const unsigned char destinations[MAX_POSITIONAL_MOVES], const size_t count, mcts::Rand & rand) const
+{
+    unsigned char closest = destinations[0];
+    unsigned short closest_distance = std::numeric_limits<unsigned short>::max();
+    size_t ties = 0;
+    for (size_t i=0;i<count;++i)
+    {
+        const unsigned short distance = grid::distance(
+            bitboard::bit(destinations[i]),
+            heros_goal(),
+            horizontal_walls,
+            vertical_walls,
+            std::numeric_limits<unsigned short>::max()
+        );
+        if (distance<closest_distance)
+        {
+            closest = destinations[i];
+            closest_distance = distance;
+            ties = 1;
+        }
+        else if (distance==closest_distance && mcts::random_index(++ties, rand)==0)
+            closest = destinations[i];
+    }
+    return closest;
+}
+
+// middle is in absolute orientation. The wall must already be known to be legal.
+template <size_t N, size_t W>
+bool basic_board<N, W>::lengthens_villains_path(const size_t middle, const bool vertical, const unsigned short villains_distance) const
+{
+    const bitboard::mask edges = get_wall_edges(middle, vertical);
+    return grid::distance(
+        bitboard::bit(villain_square),
+        villains_goal(),
+        vertical ? horizontal_walls : horizontal_walls | edges,
+        vertical ? vertical_walls | edges : vertical_walls,
+        std::numeric_limits<unsigned short>::max()
+    ) > villains_distance;
+}
+
+// the board sizes built (see board.h)
+template class corridors::basic_board<9, 10>;
+template class corridors::basic_board<7, 6>;
+template class corridors::basic_board<5, 3>;
+
+static_assert(std::is_trivially_copyable<board>::value && std::is_trivially_copyable<board5>::value, "boards are copied with memcpy");
+static_assert(sizeof(board) <= 64 && sizeof(board5) <= 64, "a board should fit in a cache line");
+static_assert(board::POLICY_SIZE <= 256, "action ids must fit in last_action_id");
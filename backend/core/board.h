@@ -1,229 +1,296 @@
 #pragma once
 #include <vector>
 #include <string>
-#include "flags.hpp"
+#include "bitboard.hpp"
 #include "mcts.hpp"
 
-#define BOARD_SIZE 9
-#define STARTING_WALLS 10
-
 namespace corridors {
-    class board
+    // The game on an N x N board, with each player starting with W walls. The size is a
+    // template parameter so that every loop over the board, and every table (see board.cpp),
+    // is sized for it at compile time. The members are defined in board.cpp, for the sizes
+    // instantiated there (see the typedefs below).
+    template <size_t N, size_t W>
+    class basic_board
     {
-        typedef std::shared_ptr<mcts::uct_node<board>> board_node_ptr;
+        typedef mcts::node_block<mcts::uct_node<basic_board>> board_node_block;
+        typedef bitboard::grid<N> grid;
+
+        static_assert(N>=3 && N<=9, "action texts have single digit coordinates, and wall middles must fit in a uint64_t");
+        static_assert(W<16, "walls remaining must fit in 4 bits");
 
         public:
+            // Board geometry. Squares are indexed y*N + x and wall middles (the
+            // intersections a wall is centred on) y*(N-1) + x.
+            constexpr static size_t BOARD_SIZE = N;
+            constexpr static size_t STARTING_WALLS = W;
+            constexpr static size_t NUM_SQUARES = N*N;
+            constexpr static size_t NUM_WALL_MIDDLES = (N-1)*(N-1);
+
+            // Neural network interface (see mcts::batch_evaluator). encode writes NUM_PLANES
+            // planes of NUM_SQUARES floats, all from hero's perspective: hero's pawn, villain's
+            // pawn, horizontal and vertical walls (at the square below and left of the wall's
+            // middle), then hero's and villain's walls remaining (as a fraction of STARTING_WALLS).
+            // Policies have one entry per action id (see get_action_id).
+            constexpr static size_t NUM_PLANES = 6;
+            constexpr static size_t ENCODING_SIZE = NUM_PLANES*NUM_SQUARES;
+            constexpr static size_t POLICY_SIZE = NUM_SQUARES + 2*NUM_WALL_MIDDLES;
+
+            // identifies the board size in saved trees and opening books (see mcts::tree_image),
+            // as every size is the same number of bytes
+            constexpr static uint32_t STATE_FORMAT = (uint32_t)(N<<8 | W);
+
             struct action
             {
                 action() noexcept;
                 void flip();
+                size_t get_id() const; // see get_action_id
+                static action from_id(const size_t id);
+                std::string get_text() const; // see get_action_text
                 bool is_positional; // false means it was a wall placement
                 unsigned short token_position;
                 bool wall_is_vertical;
                 unsigned short wall_middle;
             };
 
-            board() noexcept;
-            board(
-                const unsigned short _hero_x,
-                const unsigned short _hero_y,
-                const unsigned short _villain_x, 
-                const unsigned short _villain_y,
-                const unsigned short _hero_walls_remaining,
-                const unsigned short _villain_walls_remaining,
-                const flags::flags<(BOARD_SIZE-1)*(BOARD_SIZE-1)> & _wall_middles,
-                const flags::flags<(BOARD_SIZE-1)*BOARD_SIZE> & _horizontal_walls,
-                const flags::flags<(BOARD_SIZE-1)*BOARD_SIZE> & _vertical_walls
-            ) noexcept;
-            board(const board & source) noexcept;
-            board(const board & source, bool flip) noexcept;
-            virtual ~board() noexcept;
-            board& operator=(const board & source) noexcept;
-            bool operator==(const board & source) const noexcept;
+            // how random rollouts pick their moves (see make_rollout_move)
+            struct rollout_policy
+            {
+                enum heuristic : unsigned char
+                {
+                    RANDOM, // every legal move equally likely
+                    SHORTEST_PATH, // with probability path_probability, step along a shortest path to goal (otherwise as RANDOM)
+                    SMART_WALLS // as SHORTEST_PATH, but only placing walls that lengthen villain's shortest path
+                };
+                rollout_policy() noexcept;
+                rollout_policy(const heuristic kind, const double path_probability) noexcept;
+                heuristic kind;
+                double path_probability;
+            };
+
+            // A board is a 64 byte, trivially copyable value (since every node stores one
+            // and every rollout ply copies one), so copies and moves are just memcpys
+            basic_board() noexcept;
+            basic_board(const basic_board & source) noexcept = default;
+            basic_board(const basic_board & source, bool flip) noexcept;
+            ~basic_board() noexcept = default;
+            basic_board& operator=(const basic_board & source) noexcept = default;
+            bool operator==(const basic_board & source) const noexcept;
+            // whether these bytes are a position the game can reach: pawns on distinct squares,
+            // each player's walls remaining at most STARTING_WALLS, one wall placed for every wall
+            // used, no overlapping walls, both goals reachable, and the blocked-edge masks and
+            // Zobrist key agreeing with the rest. For positions read back from files (see
+            // mcts::tree_image), which every other member assumes
+            bool is_valid() const noexcept;
 
             // moving enabled (must use noexcept to get stl:: containers to use them!)
-            board(board&& source) noexcept = default;
-            board& operator=(board&& source) noexcept = default;
+            basic_board(basic_board&& source) noexcept = default;
+            basic_board& operator=(basic_board&& source) noexcept = default;
 
             template <typename SOMETHING_EMPLACABLE>
             void get_legal_moves(SOMETHING_EMPLACABLE & output) const;
-            void eval(const std::vector<board_node_ptr> & children, double & eval_Q, std::vector<double> & eval_probs) const;
+            // the action ids of the moves get_legal_moves would generate (in the same order and
+            // perspective as their get_action_id(flip)), without generating the moves themselves
+            void get_legal_action_ids(std::vector<size_t> & output, const bool flip) const;
+            // plays the legal move with the given id (from hero's perspective, as given by
+            // get_legal_action_ids(output, true)), leaving the board as get_legal_moves would
+            void play_action_id(const size_t action_id);
+            void eval(const board_node_block & children, double & eval_Q, std::vector<double> & eval_probs) const;
             size_t get_hash() const;
+
+            // Plays a legal move chosen according to policy in place (leaving the board flipped
+            // to the new side to move, like the children from get_legal_moves), without
+            // generating the full list of moves. Used by the random rollout.
+            void make_rollout_move(const rollout_policy & policy, mcts::Rand & rand);
             bool is_terminal() const;
             double get_terminal_eval() const; // eval from hero's perspective
             std::string display() const;
             std::string get_action_text(const bool flip) const;
+            // dense id of the move that led to this position, in the same perspective as
+            // get_action_text: the destination square (below NUM_SQUARES), else NUM_SQUARES plus the wall's
+            // middle (horizontal walls) or NUM_SQUARES+NUM_WALL_MIDDLES plus it (vertical walls)
+            size_t get_action_id(const bool flip) const;
+            static std::string action_id_to_text(const size_t action_id);
+            static size_t flip_action_id(const size_t action_id); // the same move, seen from the other side
+            static size_t action_text_to_id(const std::string & action_text); // throws if it isn't a valid action
+            void encode(float * planes) const;
             bool check_non_terminal_eval(double & eval) const;
             int get_non_terminal_rank() const; // net racing difference (positive means villain's advantage)
             bool hero_wins() const;
             bool villain_wins() const;
             bool villain_is_escapable() const;
+            bool hero_is_escapable() const;
             unsigned short get_villains_shortest_distance() const;
             unsigned short get_heros_shortest_distance() const;
+            void get_shortest_distances(unsigned short & heros, unsigned short & villains) const; // both of the above, in one pass
 
         protected:
-            unsigned short hero_x, hero_y, villain_x, villain_y, hero_walls_remaining, villain_walls_remaining;
+            // step directions, as seen from hero's perspective
+            enum direction : unsigned char { UP, RIGHT, LEFT, DOWN };
 
-            // memoized values
-            mutable size_t _stored_hash;
+            // three steps, plus two diagonal jumps when villain blocks the fourth
+            constexpr static size_t MAX_POSITIONAL_MOVES = 5;
 
-            // For all wall positions, indices start in the lower-left corner (from hero's perspective)
-            // and move right, then up one row then right again, etc, ending in the upper right corner.
-            // Therefore in order to flip these indices from 
-            flags::flags<(BOARD_SIZE-1)*(BOARD_SIZE-1)> wall_middles;
-            flags::flags<(BOARD_SIZE-1)*BOARD_SIZE> horizontal_walls;
-            flags::flags<(BOARD_SIZE-1)*BOARD_SIZE> vertical_walls;
-            action _action;
+            // blocked-edge masks (see bitboard.hpp), including the board edges
+            bitboard::mask horizontal_walls;
+            bitboard::mask vertical_walls;
+            uint64_t wall_middles;
+            uint64_t vertical_wall_middles; // the wall_middles holding vertical walls
 
-            void Deep_Copy(const board & source, bool flip);
-            bool try_positional_move(const unsigned short x, const unsigned short y, const short x_diff, const short y_diff, flags::flags<BOARD_SIZE*BOARD_SIZE> * const contact_flags = NULL) const;
-            template <typename SOMETHING_EMPLACABLE>
-            bool get_positional_move(const short x_diff, const short y_diff, SOMETHING_EMPLACABLE & output) const;
-            bool check_local_escapable(const unsigned short x, const unsigned short y, flags::flags<BOARD_SIZE*BOARD_SIZE> & contact_flags) const;
+            // Zobrist key of the position (see board.cpp), kept up to date by every change
+            // to it rather than recomputed
+            uint64_t zobrist_key;
+
+            // Everything is stored in a fixed (absolute) orientation: the starting position has
+            // hero on the bottom row. When flipped is set, hero's perspective is the absolute
+            // board rotated 180 degrees (square s <-> NUM_SQUARES-1-s, middle m <-> NUM_WALL_MIDDLES-1-m).
+            // This makes a flip O(1): swap the two players and toggle the flag.
+            // (packed into a single 32 bit word, with the id of the move that led here)
+            unsigned hero_square : 7;
+            unsigned villain_square : 7;
+            unsigned hero_walls_remaining : 4;
+            unsigned villain_walls_remaining : 4;
+            unsigned flipped : 1;
+            unsigned last_action_id : 8; // see action::get_id (in absolute orientation, like everything else)
+
+            void move_hero(const unsigned char square);
+            void place_wall(const size_t middle, const bool vertical);
+            void flip();
+            template <typename VISITOR>
+            void for_each_legal_action(VISITOR && visit) const;
+            void play_action(const action & move);
+            void play_positional_move(const unsigned char square);
+            void play_wall_move(const size_t middle, const bool vertical);
+            unsigned char get_closest_to_goal(const unsigned char destinations[MAX_POSITIONAL_MOVES], const size_t count, mcts::Rand & rand) const;
+            bool play_smart_wall(mcts::Rand & rand);
+            bool lengthens_villains_path(const size_t middle, const bool vertical, const unsigned short villains_distance) const;
+            bool try_positional_move(const unsigned char square, const direction dir) const;
+            unsigned char get_step(const unsigned char square, const direction dir) const;
+            size_t get_positional_destinations(unsigned char destinations[MAX_POSITIONAL_MOVES]) const;
+            bool add_positional_destinations(const unsigned char square, const direction dir, unsigned char destinations[MAX_POSITIONAL_MOVES], size_t & count) const;
+
+            // Wall legality. A wall can only trap a player if it cuts their current shortest path,
+            // so get_path_edges finds one shortest path per player (once per position) and
+            // wall_is_legal only flood fills for the walls that cut one of them.
+            void get_path_edges(bitboard::mask & path_horizontal, bitboard::mask & path_vertical) const;
+            bitboard::mask get_wall_edges(const size_t middle, const bool vertical) const;
+            bool wall_is_legal(const size_t middle, const bool vertical, const bitboard::mask path_horizontal, const bitboard::mask path_vertical) const;
+
+            // Race solving. Once neither player has a wall left, only the pawns move, and a small
+            // alpha-beta search over their moves settles who wins the race, pawns getting in
+            // each other's way included (see check_non_terminal_eval).
+            struct race_search;
+            bool solve_race(double & eval) const;
+            int race_outcome(race_search & search, const unsigned depth) const;
 
-            // pairs of direction movement (down, left, right, up) for looping
-            //constexpr const static short directions[8]={0,-1,-1,0,1,0,0,1};
-            // not sure why the compiler hates this as a const member -- look this up later
+            // goal rows (in absolute orientation)
+            bitboard::mask heros_goal() const;
+            bitboard::mask villains_goal() const;
     };
+
+    // the sizes built (instantiated in board.cpp)
+    typedef basic_board<9, 10> board; // the standard game
+    typedef basic_board<7, 6> board7; // smaller boards, for quick games and tutorials
+    typedef basic_board<5, 3> board5;
+
+    extern template class basic_board<9, 10>;
+    extern template class basic_board<7, 6>;
+    extern template class basic_board<5, 3>;
+}
+
+// corridors samples rollout moves without generating them all (see make_rollout_move)
+namespace mcts {
+    template <>
+    inline void rollout<corridors::board>::play_random_move(corridors::board & position, const policy & how, Rand & rand) const
+    {
+        position.make_rollout_move(how, rand);
+    }
+
+    template <>
+    inline void rollout<corridors::board7>::play_random_move(corridors::board7 & position, const policy & how, Rand & rand) const
+    {
+        position.make_rollout_move(how, rand);
+    }
+
+    template <>
+    inline void rollout<corridors::board5>::play_random_move(corridors::board5 & position, const policy & how, Rand & rand) const
+    {
+        position.make_rollout_move(how, rand);
+    }
 }
 
 // make custom hash function for board available to std::hash (so we don't have to pass
 // anything extra into std::unordered_map)
 namespace std {
-    template <>
-    struct hash<corridors::board>
+    template <size_t N, size_t W>
+    struct hash<corridors::basic_board<N, W>>
     {
-        size_t operator()(const corridors::board& input) const
+        size_t operator()(const corridors::basic_board<N, W>& input) const
         {
             return input.get_hash();
         }
     };
 }
 
+template <size_t N, size_t W>
 template <typename SOMETHING_EMPLACABLE>
-void corridors::board::get_legal_moves(SOMETHING_EMPLACABLE & output) const
+void corridors::basic_board<N, W>::get_legal_moves(SOMETHING_EMPLACABLE & output) const
+{
+    for_each_legal_action([&](const action & move)
+    {
+        basic_board proposed_position(*this);
+        proposed_position.play_action(move);
+        output.emplace_back(std::move(proposed_position));
+    });
+}
+
+// calls visit with every legal action (in absolute orientation): the positional moves,
+// then the walls in hero's orientation
+template <size_t N, size_t W>
+template <typename VISITOR>
+void corridors::basic_board<N, W>::for_each_legal_action(VISITOR && visit) const
 {
     if (is_terminal()) return;
 
     // get legal positional moves
-    get_positional_move(0, 1, output);
-    get_positional_move(1, 0, output);
-    get_positional_move(-1, 0, output);
-    get_positional_move(0, -1, output);
+    action move;
+    move.is_positional=true;
+    unsigned char destinations[MAX_POSITIONAL_MOVES];
+    const size_t num_destinations = get_positional_destinations(destinations);
+    for (size_t i=0;i<num_destinations;++i)
+    {
+        move.token_position=destinations[i];
+        visit(move);
+    }
 
     if (hero_walls_remaining==0) return;
 
-    // get legal wall placement moves
-    for (size_t i=0;i<(BOARD_SIZE-1)*(BOARD_SIZE-1);++i)
+    bitboard::mask path_horizontal=0, path_vertical=0;
+    get_path_edges(path_horizontal, path_vertical);
+
+    // get legal wall placement moves (iterating in hero's orientation)
+    move=action();
+    for (size_t i=0;i<NUM_WALL_MIDDLES;++i)
     {
+        size_t middle = flipped ? NUM_WALL_MIDDLES-1-i : i;
+
         // check each intersection that doesn't already have a wall  
-        if (!wall_middles.test(i))
+        if (!((wall_middles >> middle) & 1))
         {
-            size_t y = i / (BOARD_SIZE-1);
-            size_t x = i % (BOARD_SIZE-1);
-
-            // check for a legal horizontal wall placement
-            size_t horizontal_wall_index = y * BOARD_SIZE + x;
-            if (!horizontal_walls.test(horizontal_wall_index) && !horizontal_walls.test(horizontal_wall_index+1))
+            move.wall_middle=middle;
+            if (wall_is_legal(middle, false, path_horizontal, path_vertical))
             {
-                board proposed_position(*this);
-                proposed_position.wall_middles.set(i);
-                proposed_position.horizontal_walls.set(horizontal_wall_index);
-                proposed_position.horizontal_walls.set(horizontal_wall_index+1);
-                --proposed_position.hero_walls_remaining;
-                proposed_position._action=action();
-                proposed_position._action.wall_is_vertical=false;
-                proposed_position._action.wall_middle=i;
-
-                // ensure both players are escapable
-                if (proposed_position.villain_is_escapable())
-                {
-                    board proposed_position_flipped(proposed_position,true);
-                    if(proposed_position_flipped.villain_is_escapable())
-                        output.emplace_back(std::move(proposed_position_flipped));
-                }
+                move.wall_is_vertical=false;
+                visit(move);
             }
-
-            // check for a legal vertical wall placement
-            size_t vertical_wall_index = x * BOARD_SIZE + y;
-            if (!vertical_walls.test(vertical_wall_index) && !vertical_walls.test(vertical_wall_index+1))
+            if (wall_is_legal(middle, true, path_horizontal, path_vertical))
             {
-                board proposed_position(*this);
-                proposed_position.wall_middles.set(i);
-                proposed_position.vertical_walls.set(vertical_wall_index);
-                proposed_position.vertical_walls.set(vertical_wall_index+1);
-                --proposed_position.hero_walls_remaining;
-                proposed_position._action=action();
-                proposed_position._action.wall_is_vertical=true;
-                proposed_position._action.wall_middle=i;
-
-                // ensure both players are escapable
-                if (proposed_position.villain_is_escapable())
-                {
-                    board proposed_position_flipped(proposed_position,true);
-                    if(proposed_position_flipped.villain_is_escapable())
-                        output.emplace_back(std::move(proposed_position_flipped));
-                }
+                move.wall_is_vertical=true;
+                visit(move);
             }
         }
     }
 }
 
-// exactly one of x_diff or y_diff must equal -1 or 1; the other should remain zero
-template <typename SOMETHING_EMPLACABLE>
-bool corridors::board::get_positional_move(const short x_diff, const short y_diff, SOMETHING_EMPLACABLE & output) const
-{
-    if (!try_positional_move(hero_x, hero_y, x_diff, y_diff))
-        return false;
-
-    // construct the proposed position
-    board proposed_position(*this);
-    proposed_position.hero_x = (unsigned short)((short)hero_x + x_diff);
-    proposed_position.hero_y = (unsigned short)((short)hero_y + y_diff);
-    proposed_position._action=action();
-    proposed_position._action.is_positional=true;
-    proposed_position._action.token_position=proposed_position.hero_y*BOARD_SIZE + proposed_position.hero_x;
-
-    // check whether villain is in this square
-    if (proposed_position.hero_x==proposed_position.villain_x
-        && proposed_position.hero_y==proposed_position.villain_y)
-    {
-        // see if it's a legal move to keep going in the same direction
-        if (proposed_position.get_positional_move(x_diff, y_diff, output))
-            return true;
-
-        // if we reached this point, continuing in the same direction wasn't
-        // legal-- so we check orthogonal moves. Note: what we return in this 
-        // case doesn't really matter, as we'll never handle it-- but we
-        // still compute it for consistentcy (return true as long as at least
-        // one legal move was found).
-        bool move1, move2;
-        if (x_diff!=0)
-        {
-            // horizontal move-- check vertical moves
-            move1 = proposed_position.get_positional_move(0, 1, output);
-            move2 = proposed_position.get_positional_move(0, -1, output);
-        }
-        else
-        {
-            // vertical move-- check horizontal moves
-            move1 = proposed_position.get_positional_move(1, 0, output);
-            move2 = proposed_position.get_positional_move(-1, 0, output);
-        }
-        return move1 || move2;
-    }
-    else
-    {
-        // it's a legal move!!
-        // flip-construct in-place
-        output.emplace_back(std::move(board(proposed_position, true)));
-        return true;
-    }
-}
-
-
-
-
 // uncomment to test that hashing is working correctly for containers
 //#include <unordered_map>
 //std::unordered_map<corridors::board, int> test_hash;
\ No newline at end of file
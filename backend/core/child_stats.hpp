@@ -0,0 +1,227 @@
+#pragma once
+#include <atomic>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace mcts {
+
+// Search statistics for a block of sibling nodes, kept as parallel arrays (rather than
+// inside the nodes themselves) so that select can score all of a node's children in one
+// linear pass over contiguous memory -- see score_children.
+//
+// The header and its arrays live in a single allocation (see create). Each array is padded
+// to a multiple of LANES entries, with the padding set up to look like unevaluated
+// children, so that the vectorized kernel never needs a remainder loop.
+struct child_stats
+{
+    constexpr static size_t LANES = 4; // doubles per AVX2 register
+    constexpr static size_t ALIGNMENT = 64;
+
+    // proven values
+    enum : signed char
+    {
+        UNPROVEN = 0,
+        PROVEN_WIN = 1, // the child's position is won for the player to move there
+        PROVEN_LOSS = -1
+    };
+
+    size_t count;
+    std::atomic<double> * Q_sum; // sum of all backprop'd equity values
+    std::atomic<double> * eval_Q; // stored evaluation from rollout / handmade eval function / NN (lowest() until evaluated)
+    std::atomic<size_t> * visit_count; // number of backprops which have contributed to Q_sum
+    std::atomic<size_t> * virtual_loss; // simulations currently in flight through the child (parallel search only)
+    std::atomic<bool> * eval_claimed; // set by the one thread allowed to evaluate the child
+    double * prior; // the child's probability under the parent's policy (see use_probs)
+    std::atomic<signed char> * proven; // set once the child's value is known for certain (see uct_node::prove)
+
+    static size_t padded(const size_t count) noexcept
+    {
+        return (count + LANES-1) / LANES * LANES;
+    }
+
+    // bytes needed by create
+    static size_t bytes(const size_t count) noexcept
+    {
+        const size_t n = padded(count);
+        return header_bytes() + 4*n*sizeof(double) + n*sizeof(double) + n*sizeof(std::atomic<bool>) + n*sizeof(std::atomic<signed char>);
+    }
+
+    // builds the header and arrays in memory (which must be ALIGNMENT aligned and bytes(count) long)
+    static child_stats * create(void * memory, const size_t count) noexcept
+    {
+        const size_t n = padded(count);
+        char * cursor = static_cast<char *>(memory);
+        child_stats * stats = new (cursor) child_stats();
+        cursor += header_bytes();
+        stats->count = count;
+        stats->Q_sum = carve<std::atomic<double>>(cursor, n, 0.0);
+        stats->eval_Q = carve<std::atomic<double>>(cursor, n, std::numeric_limits<double>::lowest());
+        stats->visit_count = carve<std::atomic<size_t>>(cursor, n, size_t(0));
+        stats->virtual_loss = carve<std::atomic<size_t>>(cursor, n, size_t(0));
+        stats->prior = carve<double>(cursor, n, 1.0);
+        stats->eval_claimed = carve<std::atomic<bool>>(cursor, n, false);
+        stats->proven = carve<std::atomic<signed char>>(cursor, n, (signed char)UNPROVEN);
+        return stats;
+    }
+
+    bool is_evaluated(const size_t i) const noexcept
+    {
+        return eval_Q[i].load(std::memory_order_acquire) > std::numeric_limits<double>::lowest();
+    }
+
+    // child i's equity from its own perspective (see uct_node::get_equity): the mean of its
+    // backprops, or its evaluation until the first. Only meaningful once it's evaluated
+    double equity(const size_t i) const noexcept
+    {
+        // (Q_sum first: backprop bumps visit_count before Q_sum)
+        const double sum = Q_sum[i].load(std::memory_order_acquire);
+        const size_t visits = visit_count[i].load(std::memory_order_relaxed);
+        return visits>0 ? sum / (double)visits : eval_Q[i].load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t header_bytes() noexcept
+    {
+        return (sizeof(child_stats) + ALIGNMENT-1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    template <typename T, typename V>
+    static T * carve(char * & cursor, const size_t n, const V value) noexcept
+    {
+        T * array = reinterpret_cast<T *>(cursor);
+        for (size_t i=0;i<n;++i)
+            new (array+i) T(value);
+        cursor += n*sizeof(T);
+        return array;
+    }
+};
+
+// Scores every child of a node for select, writing lowest() for children that can't be
+// scored yet (the unevaluated ones), and returns the best score. scores must have room
+// for child_stats::padded(stats.count) entries.
+//
+// N is the parent's visit count less one. Each child is scored Q + c*U, where Q is the
+// child's equity from the parent's perspective (with each in-flight simulation counted as
+// a loss when use_virtual_loss is set) and U is the PUCT or UCT exploration term.
+inline double score_children(
+    const child_stats & stats,
+    const double c,
+    const double N,
+    const bool use_puct,
+    const bool use_probs,
+    const bool use_virtual_loss,
+    double * scores) noexcept
+{
+    const double lowest = std::numeric_limits<double>::lowest();
+    const bool explore = N>0;
+    const double sqrt_N = std::sqrt(N);
+    const double log_N = std::log(N);
+    const size_t n = child_stats::padded(stats.count);
+
+#ifdef __AVX2__
+    // The atomics are read with plain vector loads. Every search thread only ever does
+    // aligned 8-byte stores to them, so each lane sees some recent value; at worst a
+    // score is computed from statistics a single backprop apart.
+    static_assert(sizeof(std::atomic<double>)==sizeof(double), "vector loads need plain atomic<double> layout");
+    static_assert(sizeof(std::atomic<size_t>)==sizeof(uint64_t), "vector loads need plain atomic<size_t> layout");
+    const double * Q_sum = reinterpret_cast<const double *>(stats.Q_sum);
+    const double * eval_Q = reinterpret_cast<const double *>(stats.eval_Q);
+    const __m256i * visit_count = reinterpret_cast<const __m256i *>(stats.visit_count);
+    const __m256i * virtual_loss = reinterpret_cast<const __m256i *>(stats.virtual_loss);
+
+    // counts are well under 2^52, so OR-ing them into the mantissa of 2^52 and subtracting
+    // 2^52 converts them to doubles exactly (AVX2 has no 64-bit integer conversion)
+    const __m256i magic_bits = _mm256_set1_epi64x(0x4330000000000000);
+    const __m256d magic = _mm256_set1_pd(4503599627370496.0);
+    auto to_double = [&](const __m256i counts)
+    {
+        return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(counts, magic_bits)), magic);
+    };
+
+    const __m256d v_lowest = _mm256_set1_pd(lowest);
+    const __m256d v_zero = _mm256_setzero_pd();
+    const __m256d v_one = _mm256_set1_pd(1.0);
+    const __m256d v_c = _mm256_set1_pd(c);
+    const __m256d v_sqrt_N = _mm256_set1_pd(sqrt_N);
+    const __m256d v_log_N = _mm256_set1_pd(log_N);
+    const __m256d v_sign = _mm256_set1_pd(-0.0);
+    __m256d v_best = v_lowest;
+    for (size_t i=0;i<n;i+=child_stats::LANES)
+    {
+        const __m256d eval = _mm256_load_pd(eval_Q+i);
+        const __m256d evaluated = _mm256_cmp_pd(eval, v_lowest, _CMP_GT_OQ);
+        const __m256d vl = use_virtual_loss
+            ? to_double(_mm256_load_si256(virtual_loss + i/child_stats::LANES))
+            : v_zero;
+        const __m256d visits = _mm256_add_pd(to_double(_mm256_load_si256(visit_count + i/child_stats::LANES)), vl);
+
+        // Q = -(Q_sum + virtual_loss) / n, or -eval_Q for a child with no visits yet
+        const __m256d Q = _mm256_blendv_pd(
+            _mm256_xor_pd(eval, v_sign),
+            _mm256_xor_pd(_mm256_div_pd(_mm256_add_pd(_mm256_load_pd(Q_sum+i), vl), visits), v_sign),
+            _mm256_cmp_pd(visits, v_zero, _CMP_GT_OQ));
+
+        __m256d score = Q;
+        if (explore)
+        {
+            __m256d U = use_puct
+                ? _mm256_div_pd(v_sqrt_N, _mm256_add_pd(v_one, visits))
+                : _mm256_sqrt_pd(_mm256_div_pd(v_log_N, _mm256_max_pd(visits, v_one)));
+            if (use_probs)
+                U = _mm256_mul_pd(U, _mm256_load_pd(stats.prior+i));
+            score = _mm256_add_pd(Q, _mm256_mul_pd(v_c, U));
+        }
+        score = _mm256_blendv_pd(v_lowest, score, evaluated);
+        _mm256_storeu_pd(scores+i, score);
+        v_best = _mm256_max_pd(v_best, score);
+    }
+
+    double lanes[child_stats::LANES];
+    _mm256_storeu_pd(lanes, v_best);
+    double best = lanes[0];
+    for (size_t i=1;i<child_stats::LANES;++i)
+        best = std::max(best, lanes[i]);
+    return best;
+#else
+    double best = lowest;
+    for (size_t i=0;i<n;++i)
+    {
+        const double eval = stats.eval_Q[i].load(std::memory_order_relaxed);
+        if (!(eval > lowest))
+        {
+            scores[i] = lowest;
+            continue;
+        }
+        const double vl = use_virtual_loss ? (double)stats.virtual_loss[i].load(std::memory_order_relaxed) : 0.0;
+        const double visits = (double)stats.visit_count[i].load(std::memory_order_relaxed) + vl;
+
+        // Q = -(Q_sum + virtual_loss) / n, or -eval_Q for a child with no visits yet
+        const double Q = visits > 0
+            ? -((stats.Q_sum[i].load(std::memory_order_relaxed) + vl) / visits)
+            : -eval;
+
+        double score = Q;
+        if (explore)
+        {
+            double U = use_puct
+                ? sqrt_N / (1.0+visits)
+                : std::sqrt(log_N / std::max(visits,1.0));
+            if (use_probs)
+                U *= stats.prior[i];
+            score = Q + c * U;
+        }
+        scores[i] = score;
+        best = std::max(best, score);
+    }
+    return best;
+#endif
+}
+
+} // namespace mcts
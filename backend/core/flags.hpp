@@ -16,7 +16,7 @@ namespace flags {
             // default the big 5
             flags(const flags & source) noexcept = default;
             flags & operator=(const flags & source) noexcept = default;
-            virtual ~flags() noexcept = default;
+            ~flags() noexcept = default;
             flags & operator=(flags && source) noexcept = default;
             flags(flags && source) noexcept = default;
 
@@ -0,0 +1,150 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mcts {
+
+// A read-only buffer of bytes: either a file mapped into memory (where mmap is available --
+// elsewhere it's read in) or a vector handed over by the caller. Copies share the buffer,
+// which goes away with the last of them. The on-disk formats built on it (see tree_image
+// and opening_book) are read straight out of the buffer through read.
+class mapped_file
+{
+public:
+    mapped_file() noexcept = default;
+
+    // takes over bytes held in memory
+    explicit mapped_file(std::vector<char> && bytes) :
+        owned(new std::vector<char>(std::move(bytes)))
+    {
+        data = owned->data();
+        length = owned->size();
+    }
+
+    // what names the kind of file in error messages
+    static mapped_file open(const std::string & path, const std::string & what)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd<0)
+            throw std::string("Error: unable to open ") + what + " " + path;
+        struct stat info;
+        if (::fstat(fd, &info)!=0 || info.st_size<=0)
+        {
+            ::close(fd);
+            throw std::string("Error: unable to read ") + what + " " + path;
+        }
+        const size_t bytes = (size_t)info.st_size;
+        void * memory = ::mmap(NULL, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // (the mapping keeps the file open)
+        if (memory==MAP_FAILED)
+            throw std::string("Error: unable to map ") + what + " " + path;
+        mapped_file file;
+        file.mapping.reset(memory, [bytes](void * p) { ::munmap(p, bytes); });
+        file.data = static_cast<const char *>(memory);
+        file.length = bytes;
+        return file;
+#else
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            throw std::string("Error: unable to open ") + what + " " + path;
+        return mapped_file(std::vector<char>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+#endif
+    }
+
+    // writes bytes to path, replacing the file
+    static void write(const std::string & path, const std::vector<char> & bytes, const std::string & what)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(bytes.data(), (std::streamsize)bytes.size()) || !file.flush())
+            throw std::string("Error: unable to write ") + what + " " + path;
+    }
+
+    size_t size() const noexcept { return length; }
+
+    // the i'th T of an array starting offset bytes in (which the caller has checked is in
+    // bounds). Through memcpy, as nothing guarantees bytes read from a stream are aligned
+    template <typename T>
+    T read(const size_t offset, const size_t i = 0) const noexcept
+    {
+        T value;
+        std::memcpy(&value, data + offset + i*sizeof(T), sizeof(T));
+        return value;
+    }
+
+private:
+    std::shared_ptr<void> mapping; // a mapped file, or
+    std::shared_ptr<std::vector<char>> owned; // bytes in memory
+    const char * data = NULL;
+    size_t length = 0;
+};
+
+// What every file format of positions of type G starts with: which format it is (magic),
+// its version, and which G wrote it, so that a file is only ever read by a build with the
+// same G. Each format's own header starts with one.
+template <typename G>
+struct format_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t state_bytes; // sizeof(G)
+    uint32_t state_format; // G::STATE_FORMAT
+    uint32_t reserved; // 0
+
+    format_header() noexcept = default;
+
+    format_header(const char (&_magic)[8], const uint32_t _version) noexcept :
+        version(_version),
+        state_bytes((uint32_t)sizeof(G)),
+        state_format(G::STATE_FORMAT),
+        reserved(0)
+    {
+        std::memcpy(magic, _magic, sizeof(magic));
+    }
+
+    // throws unless this is the header of the given format, written for G. what names the
+    // format in error messages
+    void check(const char (&_magic)[8], const uint32_t _version, const std::string & what) const
+    {
+        if (std::memcmp(magic, _magic, sizeof(magic))!=0)
+            throw std::string("Error: not a valid ") + what;
+        if (version!=_version || state_bytes!=sizeof(G))
+            throw std::string("Error: ") + what + " is from an incompatible version";
+        if (state_format!=G::STATE_FORMAT)
+            throw std::string("Error: ") + what + " is for a different board";
+    }
+};
+
+// lays out consecutive arrays after a header, each starting on an 8 byte boundary
+class array_layout
+{
+public:
+    explicit array_layout(const size_t header_bytes) noexcept : cursor(header_bytes) {}
+
+    // the offset of the next array, of bytes bytes
+    size_t place(const size_t bytes) noexcept
+    {
+        const size_t offset = (cursor + 7) / 8 * 8;
+        cursor = offset + bytes;
+        return offset;
+    }
+
+    size_t end() const noexcept { return cursor; }
+
+private:
+    size_t cursor;
+};
+
+} // namespace mcts
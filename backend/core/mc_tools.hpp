@@ -2,30 +2,135 @@
 #include <random>
 #include <limits>
 #include <vector>
+#include <cassert>
+#include <cstdint>
+#include <cstddef>
 
 namespace mcts{
 
 typedef uint_fast64_t Seed;
 
+// xoshiro256** (Blackman and Vigna): a generator of 64-bit words with 32 bytes of state,
+// whose sequence can be cut into streams that never overlap (see split). A search hands each
+// of its threads a stream split from its own, so that every draw depends only on the seed
+// and the thread it was made on. Meets UniformRandomBitGenerator, for <random>.
+class xoshiro256
+{
+public:
+    typedef uint64_t result_type;
+
+    static constexpr result_type min() noexcept { return 0; }
+    static constexpr result_type max() noexcept { return std::numeric_limits<uint64_t>::max(); }
+
+    // the state is the seed expanded by splitmix64, so that nearby seeds give unrelated streams
+    explicit xoshiro256(const Seed seed = 0) noexcept
+    {
+        uint64_t x = (uint64_t)seed;
+        for (uint64_t & word : s)
+        {
+            uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            word = z ^ (z >> 31);
+        }
+    }
+
+    result_type operator()() noexcept
+    {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // skips 2^128 draws
+    void jump() noexcept
+    {
+        constexpr uint64_t JUMP[4] = {0x180ec6d33cfd0abaull, 0xd5a61266f0c9392cull, 0xa9582618e03fc9aaull, 0x39abdc4529b1661cull};
+        uint64_t jumped[4] = {0, 0, 0, 0};
+        for (const uint64_t word : JUMP)
+            for (unsigned b=0;b<64;++b)
+            {
+                if (word & (uint64_t(1) << b))
+                    for (size_t i=0;i<4;++i)
+                        jumped[i] ^= s[i];
+                (*this)();
+            }
+        for (size_t i=0;i<4;++i)
+            s[i] = jumped[i];
+    }
+
+    // a new stream: the next 2^128 draws of this one, which skips past them
+    xoshiro256 split() noexcept
+    {
+        xoshiro256 stream(*this);
+        jump();
+        return stream;
+    }
+
+    bool operator==(const xoshiro256 & other) const noexcept
+    {
+        return s[0]==other.s[0] && s[1]==other.s[1] && s[2]==other.s[2] && s[3]==other.s[3];
+    }
+
+    bool operator!=(const xoshiro256 & other) const noexcept { return !(*this==other); }
+
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(const uint64_t x, const int k) noexcept
+    {
+        return (x << k) | (x >> (64 - k));
+    }
+};
+
+// the generators below need every draw to be a uniform 64-bit word
+template <typename RAND>
+constexpr bool draws_64_bits() noexcept
+{
+    return RAND::min()==0 && RAND::max()==std::numeric_limits<uint64_t>::max();
+}
+
+// uniform in [0,1), from the top 53 bits of a draw (every double it can return is equally likely)
 template <typename RAND>
 double unif(RAND & rand) noexcept
 {
-    uint64_t random_integer = rand();
+    static_assert(draws_64_bits<RAND>(), "unif needs a generator of 64-bit words");
+    return (double)(rand() >> 11) * (1.0 / (double)(uint64_t(1) << 53));
+}
 
-    // Convert and scale it to [0,1) range
-    double random_double = static_cast<double>(random_integer) / (static_cast<double>(RAND::max()) + 1.0);
-    return random_double;
+// uniform index into a collection of the given size (max() if it's empty). Draws
+// nothing from rand when there's only one choice. In integers throughout (Lemire's
+// multiply-and-shift, rejecting the few draws that would bias it), so usually one
+// multiplication and no division.
+template <typename RAND>
+size_t random_index(const size_t sze, RAND & rand) noexcept
+{
+    static_assert(draws_64_bits<RAND>(), "random_index needs a generator of 64-bit words");
+    if (sze<=1)
+        return sze==0 ? std::numeric_limits<size_t>::max() : 0;
+    const uint64_t bound = (uint64_t)sze;
+    unsigned __int128 product = (unsigned __int128)rand() * bound;
+    if ((uint64_t)product < bound)
+    {
+        // (2^64 mod bound draws are rejected, so that every index has the same number left)
+        const uint64_t threshold = (0 - bound) % bound;
+        while ((uint64_t)product < threshold)
+            product = (unsigned __int128)rand() * bound;
+    }
+    return (size_t)(product >> 64);
 }
 
-template <typename T, typename RAND>
-size_t select_random_index(const std::vector<T> & vec, RAND & rand) noexcept
+// works with any container that has a size()
+template <typename CONTAINER, typename RAND>
+size_t select_random_index(const CONTAINER & vec, RAND & rand) noexcept
 {
-    size_t sze=vec.size();
-    return sze==0
-        ? std::numeric_limits<size_t>::max()
-        : sze==1
-            ? 0
-            : (size_t)((double)sze * unif(rand));
+    return random_index(vec.size(), rand);
 }
 
 template <typename T, typename RAND>
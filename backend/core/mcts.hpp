@@ -8,8 +8,24 @@
 #include <sstream>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 #include <cassert>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+#include <cstdint>
 #include "mc_tools.hpp"
+#include "node_arena.hpp"
+#include "child_stats.hpp"
+#include "transposition_table.hpp"
+#include "batch_evaluator.hpp"
+#include "reclaimer.hpp"
+#include "search_stats.hpp"
+#include "tree_image.hpp"
+#include "opening_book.hpp"
 
 #define MAX_ROLLOUT_ITERS 10000
 
@@ -48,101 +64,378 @@ Target lexical_cast(const Source& source) {
 
 namespace mcts {
 
-typedef std::mt19937_64 Rand;
+// the generator every search draws from. A multithreaded search splits a stream off the
+// caller's for each thread (see xoshiro256::split), so a search's draws depend only on the
+// generator's state when it starts and its number of threads
+typedef xoshiro256 Rand;
+typedef std::chrono::steady_clock::time_point Deadline;
 
+// a search with no deadline
+constexpr Deadline NO_DEADLINE = Deadline::max();
+
+// how a search with more than one thread shares out the work (see uct_node::search)
+enum parallelism
+{
+    TREE_PARALLEL, // the threads all search this tree
+    ROOT_PARALLEL, // each thread searches a tree of its own, and their root statistics are added up
+    LEAF_PARALLEL  // one thread searches, and each leaf is rolled out once by every thread
+};
+
+// When a search may end before its budget is spent: once the move it would choose by visits
+// (the root's most visited child) can no longer change, or the root is proven (see
+// uct_node::search_decided). The budget left is the simulations still to run, and with a
+// deadline no more than the search would get through at its rate so far.
+struct early_stop
+{
+    // 0 never stops early. 1 stops once the runner-up couldn't overtake the leader even if it
+    // got every simulation left; larger factors assume it gets only 1/factor of them, and stop
+    // sooner, at the risk of the odd late change of mind
+    double factor = 0.0;
+    // simulations beyond this call's, for a search run in parts (such as a search_pool's
+    // quanta), so that each part stops on the whole search's budget
+    size_t later_simulations = 0;
+};
+
+// std::atomic<double> only gets fetch_add in C++20, so we roll our own CAS loop
+inline void atomic_add(std::atomic<double> & target, const double value) noexcept
+{
+    double expected = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(expected, expected + value, std::memory_order_release, std::memory_order_relaxed));
+}
+
+// the children of a node, as handed out by uct_node::get_children. A child's node (and its
+// position) is only built the first time it is looked up here (see uct_node::get_child)
+template <typename N>
+struct node_block
+{
+    N * owner;
+    size_t count;
+
+    size_t size() const noexcept { return count; }
+    N & operator[](const size_t i) const { return owner->get_child(i); }
+};
+
+// Plays a game out from input to the end. How moves are picked is up to the game's
+// G::rollout_policy (a default constructed one should mean uniformly random moves).
 template <typename G>
 struct rollout
 {
-    double operator()(const G & input, Rand & rand) const;
+    typedef typename G::rollout_policy policy;
+
+    double operator()(const G & input, const policy & how, Rand & rand, size_t * plies = NULL) const; // plies (if given) gets the rollout's length
+
+    // replaces position with one of its children, chosen according to how: by default
+    // uniformly at random from the full list of legal moves (ignoring how). Games with
+    // heuristics, or a cheaper way to sample, specialize this.
+    void play_random_move(G & position, const policy & how, Rand & rand) const;
+};
+
+// Plays several rollouts of a position at once, for a leaf-parallel search: the thread that
+// calls run plays one of them, and each of the pool's threads plays another. The threads
+// live as long as the pool, waiting for the next position in between.
+template <typename G>
+class rollout_pool
+{
+public:
+    typedef typename G::rollout_policy policy;
+
+    rollout_pool(const size_t rollouts, Rand & rand); // the threads' generators are split from rand
+    rollout_pool(const rollout_pool & source) = delete;
+    rollout_pool & operator=(const rollout_pool & source) = delete;
+    ~rollout_pool() noexcept;
+
+    size_t size() const noexcept { return worker_rands.size()+1; }
+
+    // the mean value of size() rollouts from input. plies (if given) gets their total length
+    double run(const G & input, const policy & how, Rand & rand, size_t * plies = NULL);
+
+private:
+    std::mutex mutex;
+    std::condition_variable work_ready;
+    std::condition_variable work_done;
+    const G * position;
+    const policy * how;
+    size_t round; // bumped by each run
+    size_t pending; // threads yet to finish this round's rollout
+    bool stopping;
+    std::exception_ptr error; // the first error a thread ran into this round
+    std::vector<Rand> worker_rands;
+    std::vector<double> values;
+    std::vector<size_t> lengths;
+    std::vector<std::thread> workers;
+
+    void work(const size_t k);
+    void stop() noexcept;
 };
 
+// Besides the usual game interface, G provides the children of a position as action ids
+// (G::get_legal_action_ids(ids, true), below G::POLICY_SIZE), plus G::play_action_id to play
+// one of them and G::flip_action_id to see it from the other side. A node keeps just the ids
+// of its children until selection first picks one (see expand and get_child).
 template <typename G>
 class uct_node
 {
     typedef std::shared_ptr<uct_node<G>> uct_node_ptr;
+    typedef node_block<uct_node<G>> child_block;
+    typedef typename G::rollout_policy rollout_policy;
+    friend struct node_block<uct_node<G>>;
+    static_assert(G::POLICY_SIZE <= std::numeric_limits<uint16_t>::max(), "action ids are stored in 16 bits");
 public:
-    uct_node() noexcept;
-    uct_node(G && input, uct_node * _parent = NULL) noexcept;
-    uct_node(const G & input) noexcept;
-
-    // not copyable, but movable
+    // constructs the root of a new tree (with a new arena)
+    uct_node();
+    uct_node(G && input);
+    uct_node(const G & input);
+
+    // not copyable. Moving turns the source's subtree into a new tree of its own
+    // (sharing the source's arena): the source keeps its statistics but loses its children.
+    // This is how make_move detaches the chosen child from the block it lives in.
     uct_node(const uct_node & source) noexcept = delete;
     uct_node& operator=(const uct_node & source) noexcept = delete;
-    uct_node(uct_node && source) noexcept = default;
-    uct_node & operator=(uct_node && source) noexcept = default;
-    virtual ~uct_node() noexcept = default;
-
-    // adds a child (should only be called from G)
-    void emplace_back(G && input);
+    uct_node(uct_node && source);
+    uct_node & operator=(uct_node && source) noexcept = delete;
+    virtual ~uct_node() noexcept;
 
     // gameplay actions (for end user)
     void set_state(const G & input, uct_node_ptr & output);
     const G & get_state() const;
-    void simulate(
+    size_t simulate(
         const size_t simulations,
         Rand & rand,
         const double c,
         const bool use_rollout,
         const bool eval_children,
         const bool use_puct,
-        const bool use_probs
-    );
+        const bool use_probs,
+        const size_t threads = 1, // >1 runs a parallel search, in the given mode
+        const Deadline deadline = NO_DEADLINE, // search stops early once this time has passed
+        const std::atomic<bool> * cancel = NULL, // search stops early once this is set (from any thread)
+        transposition_table * table = NULL, // shares statistics between transpositions (see transposition_table)
+        const rollout_policy & policy = rollout_policy(), // how rollouts pick their moves (see mcts::rollout)
+        batch_evaluator<G> * evaluator = NULL, // evaluates leaves in batches, instead of rollouts or G::eval (see batch_evaluator)
+        search_stats * stats = NULL, // if given, the search's counters are added to it (see search_stats)
+        const parallelism mode = TREE_PARALLEL, // how the threads share out the work (see search)
+        const early_stop & stopping = early_stop(), // ends the search once its choice is settled (not in root-parallel search)
+        rollout_pool<G> * pool = NULL // plays a leaf-parallel search's rollouts, pool->size() per leaf (made for the search if not given)
+    ); // returns the number of simulations actually run
     uct_node_ptr choose_best_action(Rand & rand, const double epsilon, const bool decide_using_visits);
+    size_t select_best_action(Rand & rand, const double epsilon, const bool decide_using_visits); // as choose_best_action, but only returns the child's index
+    const G & get_child_state(const size_t choice);
     std::string display(const bool flip);
     uct_node_ptr make_move(const size_t choice);
     uct_node_ptr make_move(const std::string & action_text, const bool flip);
+    uct_node_ptr make_move_by_id(const size_t action_id, const bool flip); // see G::get_action_id
     std::vector<std::tuple<size_t, double, std::string>> get_sorted_actions(const bool flip); // flip==true means we get the move from hero's perspective
+    std::vector<std::tuple<size_t, double, size_t>> get_sorted_action_ids(const bool flip); // as get_sorted_actions, with action ids
+    void get_visit_policy(float * visits); // the children's visit counts, in a G::POLICY_SIZE array indexed by action id
+
+    // Persistence. save flattens the tree below this node (with this node as its root) into
+    // a tree_image; load turns one back into a tree of its own, with the statistics it was
+    // saved with. Only the nodes that had been expanded are rebuilt: the rest are built
+    // lazily, as ever, if the search gets to them. The search must not be running.
+    std::vector<char> save() const;
+    static uct_node_ptr load(const tree_image<G> & image);
+
+    // Starts a root off with what book knows of its position: each move the book searched
+    // more than this tree has takes on the book's statistics, and the root takes on the sum
+    // of its children's (when that's more than it had). So seeding again, or seeding a tree
+    // grown from a seeded one, adds nothing more. Returns whether the position was in the
+    // book. The search must not be running.
+    bool seed(const opening_book<G> & book);
+
+    // Memory. The budget (in bytes, 0 for none) covers the whole tree, and carries over to
+    // the trees that make_move creates from it. Once the tree has reached its budget, the
+    // search stops expanding nodes: a simulation that selects an evaluated node with no
+    // children evaluates it again (with a new rollout, or its previous evaluation) instead.
+    void set_memory_budget(const size_t bytes) noexcept;
+    size_t get_memory_budget() const noexcept;
+    size_t get_memory_usage() const noexcept; // bytes in use by this tree (and any discarded ones not yet freed)
+    size_t get_memory_reserved() const noexcept; // bytes held by the tree's arena, in use or not
     bool is_evaluated() const;
     size_t get_visit_count() const;
     double get_equity() const;
     bool check_non_terminal_eval() const;
 
+    // Solving (MCTS-Solver). Terminal positions, and those with an exact non-terminal eval,
+    // are proven wins or losses for the player to move; so is any node with a child proven
+    // lost (for the player to move there), or with every child proven won. Proofs spread up
+    // the tree as they're found. The search never selects a child proven won again (unless
+    // every child is), and goes straight for a child proven lost, so no more simulations
+    // are wasted below them. 1 for a proven win, -1 for a proven loss, 0 otherwise.
+    int get_proven_result() const noexcept;
+
+    // Early stopping (see early_stop): whether more simulations can no longer change the
+    // search's choice, as the root is proven, or no child could catch up with the most
+    // visited one given remaining/factor more visits
+    bool search_decided(const size_t remaining, const double factor) const noexcept;
+
 protected:
-    void orphan();
-    void select(uct_node_ptr & leaf, const double c, Rand & rand, const bool use_puct, const bool use_probs);
-    std::vector<uct_node_ptr> & get_children();
-    void eval(Rand & rand, const bool use_rollout, const bool eval_children);
-    double rollout(Rand & rand) const;
-    void backprop();
+    uct_node(G && input, uct_node & _parent, child_stats * _stats, const size_t _stats_index) noexcept; // constructs a child
+    size_t search(const size_t simulations, Rand & rand, const double c, const bool use_rollout, const bool eval_children, const bool use_puct, const bool use_probs, const size_t threads, const Deadline deadline, const std::atomic<bool> * cancel, transposition_table * table, const rollout_policy & policy, batch_evaluator<G> * evaluator, search_stats * stats, const parallelism mode, const early_stop & stopping, rollout_pool<G> * pool);
+    void add_root_statistics(const uct_node & other);
+    bool select(uct_node * & leaf, const double c, Rand & rand, const bool use_puct, const bool use_probs, const bool use_virtual_loss = false, search_stats * stats = NULL);
+    child_block get_children(search_stats * stats = NULL);
+    uct_node & get_child(const size_t i, search_stats * stats = NULL);
+    bool has_child(const size_t i) const noexcept;
+    G make_child_state(const size_t i) const; // child i's position, without building its node
+    size_t get_child_action_id(const size_t i, const bool flip) const noexcept; // as get_child(i).get_state().get_action_id(flip)
+    void expand();
+    void restore_children(const tree_image<G> & image, const size_t entry);
+    static signed char proof(const uint8_t flags) noexcept;
+    void release_children() noexcept;
+    static size_t child_nodes_offset(const size_t count) noexcept;
+    static size_t child_block_bytes(const size_t count) noexcept;
+    size_t eval(Rand & rand, const bool use_rollout, const bool eval_children, transposition_table * table = NULL, const rollout_policy & policy = rollout_policy(), search_stats * stats = NULL, rollout_pool<G> * pool = NULL); // returns the reused visits (see try_quick_eval)
+    bool try_quick_eval(double & _eval_Q, bool & truncate, transposition_table * table, search_stats * stats = NULL, size_t * reused_visits = NULL) const;
+    double rollout(Rand & rand, const rollout_policy & policy, search_stats * stats = NULL, rollout_pool<G> * pool = NULL) const; // with a pool, the mean of pool->size() rollouts
+    size_t simulate_batch(Rand & rand, const double c, const bool use_puct, const bool use_probs, const size_t max_simulations, transposition_table * table, batch_evaluator<G> & evaluator, search_stats * stats);
+    void apply_eval(const double _eval_Q, const float * policy, search_stats * stats = NULL);
+    void backprop(const uct_node * virtual_loss_origin = NULL, transposition_table * table = NULL, const size_t reused_visits = 0);
+    void propagate(const double _eval_Q, const uct_node * virtual_loss_origin, transposition_table * table, const size_t reused_visits = 0);
+    bool can_expand() const noexcept;
+    bool simulate_once(Rand & rand, const double c, const bool use_rollout, const bool eval_children, const bool use_puct, const bool use_probs, const bool use_virtual_loss, transposition_table * table, const rollout_policy & policy, search_stats * stats, rollout_pool<G> * pool = NULL);
+    bool claim_eval();
+    void release_eval();
+    void revert_virtual_loss(const uct_node * virtual_loss_origin);
+    void prove(const signed char result);
+    void child_proven(const signed char result);
+    bool is_proven() const noexcept;
+    template <typename ACTION_OF>
+    auto sort_actions(ACTION_OF action_of) -> std::vector<std::tuple<size_t, double, decltype(action_of(size_t()))>>;
 
 private:
-    double Q_sum; // sum of all backprop'd equity values
-    double eval_Q; // stored evaluation from rollout / handmade eval function / NN
-    size_t visit_count; // number of backprops which have contributed to Q_sum (eval_Q always being the first)
-    bool all_children_evaluated; // flag indicating that all children have an eval_Q populated
+    // expansion_state values (children are built exactly once, by whichever thread gets there first)
+    enum : unsigned char { UNEXPANDED, EXPANDING, EXPANDED };
+
+    // all statistics are atomic so that the tree can be shared by parallel search threads.
+    // (uncontended atomics cost next to nothing on the single-threaded path)
+    //
+    // A node's own search statistics live in its parent's child_stats arrays (at stats_index),
+    // next to those of its siblings, so that select never has to touch the child nodes.
+    // The root has a single-entry child_stats of its own.
+    std::atomic<bool> all_children_evaluated; // flag indicating that all children have an eval_Q populated
+    std::atomic<unsigned char> expansion_state;
+    std::atomic<bool> any_child_proven; // so that select only looks for proven children once there are some
+    uint32_t stats_index; // (kept next to the flags, where it fills what would be padding)
 
     const G state;
-    uct_node * parent;
-    std::vector<uct_node_ptr> children;
-    std::vector<double> eval_probs;
+    uct_node * parent; // NULL for the root, which holds a reference to the arena
+    node_arena * arena; // shared by every node in the tree
+    child_stats * stats;
+    // one block from the arena per expanded node: children_stats, then a pointer to each
+    // child's node (NULL until get_child first builds it), then the children's action ids
+    child_stats * children_stats;
+    std::atomic<uct_node *> * children;
+    uint16_t * child_action_ids;
+
+    std::atomic<double> & Q_sum() const noexcept { return stats->Q_sum[stats_index]; }
+    std::atomic<double> & eval_Q() const noexcept { return stats->eval_Q[stats_index]; }
+    std::atomic<size_t> & visit_count() const noexcept { return stats->visit_count[stats_index]; }
+    std::atomic<size_t> & virtual_loss() const noexcept { return stats->virtual_loss[stats_index]; }
+    std::atomic<bool> & eval_claimed() const noexcept { return stats->eval_claimed[stats_index]; }
+    std::atomic<signed char> & proven() const noexcept { return stats->proven[stats_index]; }
+
+    void create_root_stats();
 
     void Set_Null();        
 };
 
 // Implementation
 template <typename G>
-uct_node<G>::uct_node() noexcept : state()
+uct_node<G>::uct_node() : state()
+{
+    Set_Null();
+    create_root_stats();
+}
+
+template <typename G>
+uct_node<G>::uct_node(G && input) : state(std::move(input))
+{
+    Set_Null();
+    create_root_stats();
+}
+
+template <typename G>
+uct_node<G>::uct_node(const G & input) : state(input)
 {
     Set_Null();
+    create_root_stats();
 }
 
 template <typename G>
-uct_node<G>::uct_node(G && input, uct_node<G> * _parent) noexcept : state(std::move(input))
+uct_node<G>::uct_node(G && input, uct_node<G> & _parent, child_stats * _stats, const size_t _stats_index) noexcept : state(std::move(input))
 {
     Set_Null();
-    parent = _parent;
+    parent = &_parent;
+    arena = _parent.arena;
+    stats = _stats;
+    stats_index = (uint32_t)_stats_index;
 }
 
 template <typename G>
-uct_node<G>::uct_node(const G & input) noexcept : state(input)
+uct_node<G>::uct_node(uct_node && source) : state(source.state)
 {
     Set_Null();
+    arena = source.arena;
+    arena->acquire();
+    try
+    {
+        stats = child_stats::create(arena->allocate(child_stats::bytes(1)), 1);
+    }
+    catch (...)
+    {
+        arena->release();
+        throw;
+    }
+    Q_sum() = source.Q_sum().load();
+    eval_Q() = source.eval_Q().load();
+    visit_count() = source.visit_count().load();
+    eval_claimed() = source.eval_claimed().load();
+    proven() = source.proven().load();
+    stats->prior[0] = source.stats->prior[source.stats_index];
+    all_children_evaluated = source.all_children_evaluated.load();
+    expansion_state = source.expansion_state.load();
+    any_child_proven = source.any_child_proven.load();
+
+    // take over the source's children (their statistics stay where they are, in children_stats)
+    children_stats = source.children_stats;
+    children = source.children;
+    child_action_ids = source.child_action_ids;
+    for (size_t i=0;children_stats && i<children_stats->count;++i)
+        if (has_child(i))
+            children[i].load(std::memory_order_relaxed)->parent = this;
+    source.children_stats = NULL;
+    source.children = NULL;
+    source.child_action_ids = NULL;
+    source.all_children_evaluated = false;
+    source.expansion_state = UNEXPANDED;
+    source.any_child_proven = false;
+}
+
+template <typename G>
+uct_node<G>::~uct_node() noexcept
+{
+    release_children();
+    if (!parent)
+    {
+        arena->deallocate(stats, child_stats::bytes(1));
+        arena->release();
+    }
 }
 
+// gives a new root its arena, and somewhere to keep its own statistics
 template <typename G>
-void uct_node<G>::emplace_back(G && input)
+void uct_node<G>::create_root_stats()
 {
-    children.emplace_back(uct_node_ptr(new uct_node<G>(std::move(input),this)));
+    arena = new node_arena();
+    try
+    {
+        stats = child_stats::create(arena->allocate(child_stats::bytes(1)), 1);
+    }
+    catch (...)
+    {
+        arena->release();
+        throw;
+    }
 }
 
 template <typename G>
@@ -152,10 +445,10 @@ void uct_node<G>::set_state(const G & input, uct_node_ptr & output)
     if (input==state) return;
 
     // if it matches a child, return the child
-    std::vector<uct_node_ptr> & _children = get_children();
+    const child_block _children = get_children();
     for(size_t i=0;i<_children.size();++i)
     {
-        if (input==_children[i]->get_state())
+        if (input==_children[i].get_state())
         {
             output = make_move(i);
             return;
@@ -175,48 +468,582 @@ const G & uct_node<G>::get_state() const
     return state;
 }
 
-// returns false if no simulations possible
+// runs up to the requested number of simulations, stopping early if the deadline passes
+// or the cancel flag is raised. Returns the number of simulations completed.
 template <typename G>
-void uct_node<G>::simulate(
+size_t uct_node<G>::simulate(
     const size_t simulations,
     Rand & rand,
     const double c, 
     const bool use_rollout,
     const bool eval_children,
     const bool use_puct,
-    const bool use_probs)
+    const bool use_probs,
+    const size_t threads,
+    const Deadline deadline,
+    const std::atomic<bool> * cancel,
+    transposition_table * table,
+    const rollout_policy & policy,
+    batch_evaluator<G> * evaluator,
+    search_stats * stats,
+    const parallelism mode,
+    const early_stop & stopping,
+    rollout_pool<G> * pool)
+{
+    if (!stats)
+        return search(simulations, rand, c, use_rollout, eval_children, use_puct, use_probs, threads, deadline, cancel, table, policy, evaluator, NULL, mode, stopping, pool);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto elapsed_ns = [&start]()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    };
+    size_t completed;
+    try
+    {
+        completed = search(simulations, rand, c, use_rollout, eval_children, use_puct, use_probs, threads, deadline, cancel, table, policy, evaluator, stats, mode, stopping, pool);
+    }
+    catch (...)
+    {
+        ++stats->exceptions;
+        stats->elapsed_ns += elapsed_ns();
+        throw;
+    }
+    stats->simulations += completed;
+    stats->elapsed_ns += elapsed_ns();
+    return completed;
+}
+
+template <typename G>
+size_t uct_node<G>::search(
+    const size_t simulations,
+    Rand & rand,
+    const double c,
+    const bool use_rollout,
+    const bool eval_children,
+    const bool use_puct,
+    const bool use_probs,
+    const size_t threads,
+    const Deadline deadline,
+    const std::atomic<bool> * cancel,
+    transposition_table * table,
+    const rollout_policy & policy,
+    batch_evaluator<G> * evaluator,
+    search_stats * stats,
+    const parallelism mode,
+    const early_stop & stopping,
+    rollout_pool<G> * pool)
 {
-    std::vector<uct_node_ptr> & _children = get_children();
+    const child_block _children = get_children();
     if (_children.size()==0 || state.is_terminal())
         throw std::string("Error: cannot simulate from a terminal state");
+    if (evaluator && eval_children)
+        throw std::string("Error: eval_children is not supported with a batch evaluator");
+    if (threads>1 && mode==LEAF_PARALLEL && (!use_rollout || evaluator))
+        throw std::string("Error: a leaf-parallel search needs rollouts");
+
+    // leaf-parallel search: the calling thread searches as usual, but each of its rollouts
+    // (the root's included) is the mean of one rollout per thread, played by the pool (the
+    // caller's, so that its threads outlive the search, or else one of the search's own)
+    const bool leaf_parallel = threads>1 && mode==LEAF_PARALLEL;
+    std::unique_ptr<rollout_pool<G>> own_pool(leaf_parallel && !pool ? new rollout_pool<G>(threads, rand) : NULL);
+    if (!leaf_parallel)
+        pool = NULL;
+    else if (own_pool)
+        pool = own_pool.get();
+
+    // checked once per simulation: both checks are cheap next to a simulation
+    const bool has_deadline = deadline!=NO_DEADLINE;
+    auto stop_requested = [&]()
+    {
+        return (cancel && cancel->load(std::memory_order_relaxed))
+            || (has_deadline && std::chrono::steady_clock::now()>=deadline);
+    };
+
+    // whether the search can stop early (see early_stop) with done simulations run, and if so
+    // the simulations it saves
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    auto decided = [&](const size_t done, size_t & saved)
+    {
+        if (stopping.factor<=0.0)
+            return false;
+        const size_t budget = simulations - std::min(done, simulations);
+        size_t remaining = budget > std::numeric_limits<size_t>::max() - stopping.later_simulations
+            ? std::numeric_limits<size_t>::max()
+            : budget + stopping.later_simulations;
+        // (until the first simulation there's no rate to go on)
+        if (has_deadline && done>0)
+        {
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            const double elapsed = std::chrono::duration<double>(now - start).count();
+            const double left = std::chrono::duration<double>(deadline - now).count();
+            if (elapsed>0.0 && left>=0.0)
+                remaining = (size_t)std::min((double)remaining, std::ceil(done * left / elapsed));
+        }
+        // (with a transposition table, a simulation can bring up to MAX_REUSED_VISITS visits)
+        const size_t visits_left = !table ? remaining
+            : remaining > std::numeric_limits<size_t>::max()/transposition_table::MAX_REUSED_VISITS ? std::numeric_limits<size_t>::max()
+            : remaining*transposition_table::MAX_REUSED_VISITS;
+        if (!search_decided(visits_left, stopping.factor))
+            return false;
+        // (a search with no end in sight, such as a proven root's with only a deadline, saves
+        // an unknown number)
+        saved = remaining==std::numeric_limits<size_t>::max() ? 0 : remaining;
+        return true;
+    };
 
     // evaluate top node if it hasn't been evaluated
-    if (!is_evaluated())
+    if (!is_evaluated() && claim_eval())
     {
-        eval(rand,use_rollout,eval_children);
-        backprop(); // so that parent node has at least one visit
+        stats_timer timer(stats);
+        double _eval_Q;
+        bool truncate;
+        size_t reused_visits=0;
+        if (!evaluator)
+            reused_visits = eval(rand,use_rollout,eval_children,table,policy,stats,pool);
+        else if (try_quick_eval(_eval_Q, truncate, table, stats, &reused_visits))
+        {
+            // (as simulate_batch publishes its leaves' quick evaluations)
+            eval_Q().store(_eval_Q, std::memory_order_release);
+            if (truncate)
+                prove(_eval_Q>0 ? child_stats::PROVEN_WIN : child_stats::PROVEN_LOSS);
+        }
+        else
+        {
+            // (a batch of one)
+            const G * root_state = &state;
+            float value;
+            std::vector<float> root_policy(G::POLICY_SIZE);
+            try
+            {
+                evaluator->evaluate(&root_state, 1, &value, root_policy.data());
+                apply_eval(value, root_policy.data(), stats);
+            }
+            catch (...)
+            {
+                release_eval();
+                throw;
+            }
+        }
+        if (stats) stats->eval_ns += timer.lap();
+        backprop(NULL,table,reused_visits); // so that parent node has at least one visit
+        if (stats) stats->backprop_ns += timer.lap();
     }
 
-    for(size_t i=0;i<simulations;++i)
+    if (threads<=1 || mode==LEAF_PARALLEL)
     {
-        uct_node_ptr leaf;
+        size_t i=0, saved=0;
+        if (evaluator)
+        {
+            while (i<simulations && !stop_requested() && !decided(i, saved))
+                i += simulate_batch(rand, c, use_puct, use_probs, simulations-i, table, *evaluator, stats);
+        }
+        else
+        {
+            for(;i<simulations && !stop_requested() && !decided(i, saved);++i)
+                simulate_once(rand, c, use_rollout, eval_children, use_puct, use_probs, false, table, policy, stats, pool);
+        }
+        if (stats) stats->simulations_saved += saved;
+        return i;
+    }
 
-        // select node
-        select(leaf, c, rand, use_puct, use_probs);
+    std::vector<Rand> worker_rands;
+    for (size_t t=0;t<threads;++t)
+        worker_rands.push_back(rand.split());
+    std::vector<search_stats> worker_stats(stats ? threads : 0); // (merged into stats at the end)
 
-        // evaluate the node (and children if applicable)
-        if (!leaf->is_evaluated())
-            leaf->eval(rand, use_rollout, eval_children);
-        else
-            // test code
-            if (!leaf->get_state().is_terminal() && !leaf->check_non_terminal_eval())
+    if (mode==ROOT_PARALLEL)
+    {
+        // root-parallel search: the calling thread searches this tree, and every other
+        // worker a new tree of its own (with no transposition table, so that nothing is
+        // shared), each with an equal share of the simulations. Once they have all finished
+        // the other trees' root statistics are added to this one's, and the trees discarded.
+        // (None of the trees sees every visit, so none can tell when to stop early.)
+        //
+        // The trees share the memory budget: each may grow by an equal share of what this
+        // tree hasn't used of it. (A budget of 0 is no budget, so a share is at least a byte.)
+        const size_t budget = get_memory_budget();
+        const size_t used = get_memory_usage();
+        const size_t tree_budget = budget==0 ? 0 : std::max<size_t>((budget - std::min(budget, used))/threads, 1);
+        set_memory_budget(budget==0 ? 0 : used + tree_budget);
+        std::vector<std::unique_ptr<uct_node>> trees(threads);
+        std::vector<size_t> worker_completed(threads, 0);
+        std::vector<std::exception_ptr> worker_errors(threads);
+
+        auto worker = [&](const size_t t)
+        {
+            const size_t share = simulations/threads + (t < simulations%threads ? 1 : 0);
+            search_stats * local_stats = stats ? &worker_stats[t] : NULL;
+            try
+            {
+                if (t==0)
+                    worker_completed[t] = search(share, worker_rands[t], c, use_rollout, eval_children, use_puct, use_probs, 1, deadline, cancel, table, policy, evaluator, local_stats, mode, early_stop(), NULL);
+                else
+                {
+                    trees[t].reset(new uct_node(state));
+                    trees[t]->set_memory_budget(tree_budget);
+                    worker_completed[t] = trees[t]->search(share, worker_rands[t], c, use_rollout, eval_children, use_puct, use_probs, 1, deadline, cancel, NULL, policy, evaluator, local_stats, mode, early_stop(), NULL);
+                }
+            }
+            catch (...)
             {
-                throw std::string("Error: we have selected a node that is already evaluated, and is not terminal or nte");
+                worker_errors[t] = std::current_exception();
             }
-        
-        // backprop
-        leaf->backprop();
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t t=1;t<threads;++t)
+            workers.emplace_back(worker, t);
+        worker(0);
+        for (auto & w : workers)
+            w.join();
+        set_memory_budget(budget);
+        for (const search_stats & s : worker_stats)
+            *stats += s;
+        for (const std::exception_ptr & error : worker_errors)
+            if (error)
+                std::rethrow_exception(error);
+
+        size_t completed=0;
+        for (size_t t=0;t<threads;++t)
+        {
+            if (trees[t])
+                add_root_statistics(*trees[t]);
+            completed += worker_completed[t];
+        }
+        return completed;
+    }
+
+    // tree-parallel search: every worker runs the usual select/eval/backprop loop
+    // against this (shared) tree, drawing simulations from a common budget.
+    // Virtual loss keeps workers from piling onto the same path.
+
+    std::atomic<size_t> simulations_claimed(0);
+    std::atomic<size_t> simulations_completed(0);
+    std::atomic<bool> worker_failed(false);
+    std::exception_ptr worker_error;
+    std::mutex worker_error_mutex;
+
+    // (simulations in flight may still go to the runner-up, so the budget left is counted
+    // from the completed ones -- and the ones in flight when the search is settled aren't
+    // saved)
+    std::atomic<bool> decided_early(false);
+    std::atomic<size_t> simulations_saved(0);
+    auto settled = [&]()
+    {
+        if (decided_early.load(std::memory_order_relaxed))
+            return true;
+        size_t saved;
+        const size_t completed = simulations_completed.load(std::memory_order_relaxed);
+        if (!decided(completed, saved))
+            return false;
+        if (!decided_early.exchange(true))
+            simulations_saved.store(saved - std::min(saved, simulations_claimed.load() - completed), std::memory_order_relaxed);
+        return true;
+    };
+
+    auto worker = [&](const size_t t)
+    {
+        Rand & worker_rand = worker_rands[t];
+        search_stats * local_stats = stats ? &worker_stats[t] : NULL;
+        try
+        {
+            // with an evaluator, each worker claims (and batches) simulations a batch at a time
+            while (evaluator
+                && !worker_failed.load(std::memory_order_relaxed)
+                && !stop_requested()
+                && !settled())
+            {
+                const size_t claimed = simulations_claimed.fetch_add(evaluator->get_batch_size(), std::memory_order_relaxed);
+                if (claimed >= simulations)
+                    break;
+                size_t remaining = std::min(evaluator->get_batch_size(), simulations-claimed);
+                while (remaining>0 && !worker_failed.load(std::memory_order_relaxed))
+                {
+                    const size_t completed = simulate_batch(worker_rand, c, use_puct, use_probs, remaining, table, *evaluator, local_stats);
+                    if (completed==0)
+                        std::this_thread::yield();
+                    remaining -= completed;
+                    simulations_completed.fetch_add(completed, std::memory_order_relaxed);
+                }
+            }
+            while (!evaluator
+                && !worker_failed.load(std::memory_order_relaxed)
+                && !stop_requested()
+                && !settled()
+                && simulations_claimed.fetch_add(1, std::memory_order_relaxed) < simulations)
+            {
+                // a collision (another worker is already evaluating the selected leaf)
+                // doesn't count against the budget -- back off and select again
+                while (!simulate_once(worker_rand, c, use_rollout, eval_children, use_puct, use_probs, true, table, policy, local_stats))
+                    std::this_thread::yield();
+                simulations_completed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(worker_error_mutex);
+            if (!worker_error)
+                worker_error = std::current_exception();
+            worker_failed.store(true, std::memory_order_relaxed); // stop the other workers
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t=1;t<threads;++t)
+        workers.emplace_back(worker, t);
+    worker(0); // calling thread does its share of the work
+    for (auto & w : workers)
+        w.join();
+    for (const search_stats & s : worker_stats)
+        *stats += s;
+    if (stats) stats->simulations_saved += simulations_saved.load();
+
+    if (worker_error)
+        std::rethrow_exception(worker_error);
+
+    return simulations_completed.load();
+}
+
+// adds the visits that other (a separate tree for the same position) made to each of its
+// children to this node's children, and so to this node. Children that only other has
+// evaluated take its evaluation, and children it has proven its proof.
+template <typename G>
+void uct_node<G>::add_root_statistics(const uct_node & other)
+{
+    if (!other.children_stats)
+        return;
+    const child_block _children = get_children();
+    if (_children.size()!=other.children_stats->count)
+        throw std::string("Error: cannot add the statistics of a different position");
+
+    const child_stats & from = *other.children_stats;
+    child_stats & to = *children_stats;
+    size_t added_visits=0;
+    double added_Q_sum=0.0;
+    for (size_t i=0;i<from.count;++i)
+    {
+        if (!from.is_evaluated(i))
+            continue;
+        bool expected=false;
+        if (!to.is_evaluated(i) && to.eval_claimed[i].compare_exchange_strong(expected, true, std::memory_order_acq_rel))
+            to.eval_Q[i].store(from.eval_Q[i].load(std::memory_order_relaxed), std::memory_order_release);
+        const signed char result = from.proven[i].load(std::memory_order_relaxed);
+        signed char unproven = child_stats::UNPROVEN;
+        if (result!=child_stats::UNPROVEN && to.proven[i].compare_exchange_strong(unproven, result))
+            child_proven(result);
+
+        // (each visit to a child backprops the negation of its value to the parent)
+        const size_t visits = from.visit_count[i].load(std::memory_order_relaxed);
+        const double Q_sum = from.Q_sum[i].load(std::memory_order_relaxed);
+        to.visit_count[i].fetch_add(visits, std::memory_order_relaxed);
+        atomic_add(to.Q_sum[i], Q_sum);
+        added_visits += visits;
+        added_Q_sum -= Q_sum;
     }
+    visit_count().fetch_add(added_visits, std::memory_order_relaxed);
+    atomic_add(Q_sum(), added_Q_sum);
+}
+
+// runs a single select/eval/backprop cycle. Returns false if the cycle was abandoned
+// because another thread was already evaluating the selected leaf (parallel search only).
+template <typename G>
+bool uct_node<G>::simulate_once(
+    Rand & rand,
+    const double c,
+    const bool use_rollout,
+    const bool eval_children,
+    const bool use_puct,
+    const bool use_probs,
+    const bool use_virtual_loss,
+    transposition_table * table,
+    const rollout_policy & policy,
+    search_stats * stats,
+    rollout_pool<G> * pool)
+{
+    uct_node * leaf;
+
+    // select node
+    const bool at_budget = select(leaf, c, rand, use_puct, use_probs, use_virtual_loss, stats);
+    stats_timer timer(stats);
+
+    const uct_node * virtual_loss_origin = use_virtual_loss ? this : NULL;
+
+    if (at_budget)
+    {
+        // the tree can't grow, so evaluate the leaf again (it keeps its children-less state)
+        double _eval_Q;
+        try
+        {
+            _eval_Q = use_rollout
+                ? leaf->rollout(rand, policy, stats, pool)
+                : leaf->eval_Q().load(std::memory_order_acquire);
+        }
+        catch (...)
+        {
+            leaf->revert_virtual_loss(virtual_loss_origin);
+            throw;
+        }
+        if (stats) stats->eval_ns += timer.lap();
+        leaf->propagate(_eval_Q, virtual_loss_origin, table);
+        if (stats) stats->backprop_ns += timer.lap();
+        return true;
+    }
+
+    // evaluate the node (and children if applicable)
+    size_t reused_visits=0;
+    if (!leaf->is_evaluated())
+    {
+        if (!leaf->claim_eval())
+        {
+            leaf->revert_virtual_loss(virtual_loss_origin);
+            if (stats) ++stats->collisions;
+            return false;
+        }
+        try
+        {
+            reused_visits = leaf->eval(rand, use_rollout, eval_children, table, policy, stats, pool);
+        }
+        catch (...)
+        {
+            // hand the leaf back so a later simulation can retry it
+            leaf->release_eval();
+            leaf->revert_virtual_loss(virtual_loss_origin);
+            throw;
+        }
+    }
+    else if (!leaf->is_proven() && !leaf->get_state().is_terminal() && !leaf->check_non_terminal_eval())
+    {
+        // in a parallel search this just means another thread finished evaluating
+        // the leaf in between our select and this check
+        if (use_virtual_loss)
+        {
+            leaf->revert_virtual_loss(virtual_loss_origin);
+            if (stats) ++stats->collisions;
+            return false;
+        }
+        // test code
+        throw std::string("Error: we have selected a node that is already evaluated, and is not terminal or nte");
+    }
+    if (stats) stats->eval_ns += timer.lap();
+
+    // backprop
+    leaf->backprop(virtual_loss_origin, table, reused_visits);
+    if (stats) stats->backprop_ns += timer.lap();
+    return true;
+}
+
+// Runs up to max_simulations (and at most one batch's worth of) select/eval/backprop cycles,
+// evaluating all their unevaluated leaves with a single call to the evaluator. Selection
+// uses virtual loss, so that the leaves spread out over the tree. Leaves that need no model
+// (terminal or exact positions, transpositions) backprop straight away. The batch is cut
+// short at the first collision with a leaf that's already being evaluated (possibly by this
+// batch). Returns the number of simulations completed, which is 0 only if the very first
+// select collided with another thread's evaluation.
+template <typename G>
+size_t uct_node<G>::simulate_batch(
+    Rand & rand,
+    const double c,
+    const bool use_puct,
+    const bool use_probs,
+    const size_t max_simulations,
+    transposition_table * table,
+    batch_evaluator<G> & evaluator,
+    search_stats * stats)
+{
+    static thread_local std::vector<uct_node *> pending;
+    static thread_local std::vector<const G *> pending_states;
+    static thread_local std::vector<float> values;
+    static thread_local std::vector<float> policies;
+    pending.clear();
+
+    const size_t max_leaves = std::min(max_simulations, evaluator.get_batch_size());
+    size_t completed=0;
+    size_t applied=0; // pending leaves that have their evaluation
+    try
+    {
+        while (completed + pending.size() < max_leaves)
+        {
+            uct_node * leaf;
+            const bool at_budget = select(leaf, c, rand, use_puct, use_probs, true, stats);
+            stats_timer timer(stats);
+            if (at_budget)
+            {
+                // at the memory budget: back up the leaf's evaluation again
+                leaf->propagate(leaf->eval_Q().load(std::memory_order_acquire), this, table);
+                if (stats) stats->backprop_ns += timer.lap();
+                ++completed;
+                continue;
+            }
+
+            if (leaf->is_evaluated())
+            {
+                // another thread finished evaluating the leaf in between our select and this check
+                if (!leaf->is_proven() && !leaf->get_state().is_terminal() && !leaf->check_non_terminal_eval())
+                {
+                    leaf->revert_virtual_loss(this);
+                    if (stats) ++stats->collisions;
+                    break;
+                }
+                leaf->backprop(this, table);
+                if (stats) stats->backprop_ns += timer.lap();
+                ++completed;
+                continue;
+            }
+            if (!leaf->claim_eval())
+            {
+                leaf->revert_virtual_loss(this);
+                if (stats) ++stats->collisions;
+                break;
+            }
+
+            double _eval_Q;
+            bool truncate;
+            size_t reused_visits;
+            pending.push_back(leaf);
+            if (leaf->try_quick_eval(_eval_Q, truncate, table, stats, &reused_visits))
+            {
+                pending.pop_back();
+                leaf->eval_Q().store(_eval_Q, std::memory_order_release);
+                if (truncate)
+                    leaf->prove(_eval_Q>0 ? child_stats::PROVEN_WIN : child_stats::PROVEN_LOSS);
+                if (stats) stats->eval_ns += timer.lap();
+                leaf->backprop(this, table, reused_visits);
+                if (stats) stats->backprop_ns += timer.lap();
+                ++completed;
+            }
+        }
+
+        if (!pending.empty())
+        {
+            stats_timer timer(stats);
+            pending_states.clear();
+            for (uct_node * leaf : pending)
+                pending_states.push_back(&leaf->state);
+            values.resize(pending.size());
+            policies.resize(pending.size()*G::POLICY_SIZE);
+            evaluator.evaluate(pending_states.data(), pending.size(), values.data(), policies.data());
+
+            for (;applied<pending.size();++applied)
+                pending[applied]->apply_eval(values[applied], policies.data() + applied*G::POLICY_SIZE, stats);
+            if (stats) stats->eval_ns += timer.lap();
+            for (uct_node * leaf : pending)
+                leaf->backprop(this, table);
+            if (stats) stats->backprop_ns += timer.lap();
+            completed += pending.size();
+        }
+    }
+    catch (...)
+    {
+        // hand back the leaves that never got an evaluation, so later simulations can retry them
+        for (size_t i=applied;i<pending.size();++i)
+        {
+            pending[i]->release_eval();
+            pending[i]->revert_virtual_loss(this);
+        }
+        throw;
+    }
+    return completed;
 }
 
 // chooses an action to take from current board position based on epsilon-greedy policy
@@ -226,11 +1053,28 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
     const double epsilon,
     const bool decide_using_visits // false means we decide using equity
     )
+{
+    // test code
+    uct_node_ptr ret = make_move(select_best_action(rand, epsilon, decide_using_visits));
+    if (ret->get_children().size()==0 && !ret->get_state().is_terminal())
+        throw std::string("Error: position is not marked as terminal, but there are no children");
+    return ret;
+}
+
+// leaves the chosen child in place, so that its subtree is still there for a later make_move.
+// Reads the children's statistics from children_stats, and the positions it needs from
+// make_child_state, so that no child's node is built until a move is made
+template <typename G>
+size_t uct_node<G>::select_best_action(
+    Rand & rand,
+    const double epsilon,
+    const bool decide_using_visits
+    )
 {
     if(epsilon <0 || epsilon>1)
         throw std::string("Error: improper use of choose_best_action. Check arguments.");
 
-    std::vector<uct_node_ptr> _children = get_children();
+    const child_block _children = get_children();
     size_t num_legal_moves = _children.size();
 
     if (num_legal_moves==0)
@@ -238,13 +1082,28 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
 
     size_t choice=std::numeric_limits<size_t>::max();
 
-    // determine if there are any winning moves
+    // determine if there are any winning moves (including those the search has proven)
     std::vector<size_t> winning_moves;
+    bool any_open_move=false; // whether any move isn't proven lost
     for (size_t i=0;i<num_legal_moves;++i)
     {
-        if (_children[i]->get_state().is_terminal() && _children[i]->get_equity()<0) // we use < because child equity is from villain's perspective, signifying a win for hero
+        const signed char result = children_stats->proven[i].load(std::memory_order_acquire);
+        // (an evaluated terminal child is proven, so only the others need their position)
+        if (result==child_stats::PROVEN_LOSS)
             winning_moves.push_back(i);
+        else if (result==child_stats::UNPROVEN && !children_stats->is_evaluated(i))
+        {
+            const G child_state = make_child_state(i);
+            if (child_state.is_terminal() && child_state.get_terminal_eval()<0) // we use < because child eval is from villain's perspective, signifying a win for hero
+                winning_moves.push_back(i);
+        }
+        any_open_move = any_open_move || result!=child_stats::PROVEN_WIN;
     }
+    // moves proven lost are only worth considering when there's nothing else
+    auto proven_lost = [&](const size_t i)
+    {
+        return any_open_move && children_stats->proven[i].load(std::memory_order_acquire)==child_stats::PROVEN_WIN;
+    };
     
     if (winning_moves.size()>0)
         choice=select_random_value(winning_moves,rand);
@@ -254,14 +1113,21 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
         // if it's possible to get a (heuristic), non-terminal
         // according to that criteria rather than uct.
         // this basically signifies that we're now in the territory
-        // of domain-specific knowledge and no longer need the tree
+        // of domain-specific knowledge and no longer need the tree.
+        // Moves to positions with an exact eval that's lost for villain
+        // come first (a lead in the race isn't always enough to win it)
         int min_non_terminal_rank = std::numeric_limits<int>::max();
+        bool choice_wins = false;
         for (size_t i=0;i<num_legal_moves;++i)
         {
-            int curr_rank = _children[i]->state.get_non_terminal_rank(); // minimize this because get_non_terminal_rank returns rank from villain's perspective (ie high is good for villain)
-            if (curr_rank < min_non_terminal_rank)
+            const G child_state = make_child_state(i);
+            double child_eval;
+            const bool curr_wins = child_state.check_non_terminal_eval(child_eval) && child_eval<0;
+            int curr_rank = child_state.get_non_terminal_rank(); // minimize this because get_non_terminal_rank returns rank from villain's perspective (ie high is good for villain)
+            if ((curr_wins && !choice_wins) || (curr_wins==choice_wins && curr_rank < min_non_terminal_rank))
             {
                 min_non_terminal_rank = curr_rank;
+                choice_wins = curr_wins;
                 choice=i;
             }
         }
@@ -279,7 +1145,9 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
                 size_t max_visit_count=0;
                 for (size_t i=0;i<num_legal_moves;++i)
                 {
-                    size_t curr_visit_count = _children[i]->visit_count; // no negation needed (as with equity below) because visit count always looks from parent node's perspective
+                    if (proven_lost(i))
+                        continue;
+                    size_t curr_visit_count = children_stats->visit_count[i].load(std::memory_order_relaxed); // no negation needed (as with equity below) because visit count always looks from parent node's perspective
                     if (curr_visit_count >= max_visit_count)
                     {
                         if (curr_visit_count > max_visit_count)
@@ -297,7 +1165,9 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
                 double max_Q = std::numeric_limits<double>::lowest();
                 for (size_t i=0;i<num_legal_moves;++i)
                 {
-                    double curr_Q = -_children[i]->get_equity(); // negative because equity is from villain's perspective
+                    if (proven_lost(i) || !children_stats->is_evaluated(i))
+                        continue;
+                    double curr_Q = -children_stats->equity(i); // negative because equity is from villain's perspective
                     if (curr_Q >= max_Q)
                     {
                         if (curr_Q > max_Q)
@@ -311,11 +1181,12 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
             }
 
             // randomly select a value from choices_queue
-            choice = select_random_value(choices_queue,rand);
+            if (!choices_queue.empty())
+                choice = select_random_value(choices_queue,rand);
         }
         else
         {
-            choice = select_random_index(_children, rand);
+            choice = random_index(num_legal_moves, rand);
         }
     }
 
@@ -325,11 +1196,16 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::choose_best_action(
     if (!(choice<std::numeric_limits<size_t>::max()))
         throw std::string("Error: choose_best_action experienced limit compare failure");
 
-    // test code
-    uct_node_ptr ret = make_move(choice);
-    if (ret->get_children().size()==0 && !ret->get_state().is_terminal())
-        throw std::string("Error: position is not marked as terminal, but there are no children");
-    return ret;
+    return choice;
+}
+
+template <typename G>
+const G & uct_node<G>::get_child_state(const size_t choice)
+{
+    const child_block _children = get_children();
+    if (choice>=_children.size())
+        throw std::string("Error: invalid move chosen.");
+    return _children[choice].state;
 }
 
 template <typename G>
@@ -341,7 +1217,7 @@ std::string uct_node<G>::display(const bool flip)
     std::string res;
 
     res += "Total Visits: ";
-    res += lexical_cast<std::string>(visit_count);
+    res += lexical_cast<std::string>(get_visit_count());
     res += "\n";
 
     std::for_each(moves.cbegin(), moves.cend(), [&](const auto &mv)
@@ -372,19 +1248,43 @@ std::string uct_node<G>::display(const bool flip)
 template <typename G>
 typename uct_node<G>::uct_node_ptr uct_node<G>::make_move(const size_t choice)
 {
-    std::vector<uct_node_ptr> & _children = get_children();
+    const child_block _children = get_children();
     if (choice>=_children.size())
         throw std::string("Error: invalid move chosen.");
-    _children[choice]->orphan(); // so that backprop stops when it reaches the top (see while loop condition in backprop())
-    return _children[choice];
+
+    // the chosen child moves out of this node's block into a root of its own (so that backprop
+    // stops there), leaving its siblings to be reclaimed along with this node
+    return uct_node_ptr(new uct_node(std::move(_children[choice])));
 }
 
 template <typename G>
 typename uct_node<G>::uct_node_ptr uct_node<G>::make_move(const std::string & action_text, const bool flip)
 {
-    std::vector<uct_node_ptr> & _children = get_children();
+    const child_block _children = get_children();
+    for (size_t i=0;i<_children.size();++i)
+        if(G::action_id_to_text(get_child_action_id(i, flip))==action_text)
+            return make_move(i);
+
+    throw std::string("Illegal move.");
+}
+
+// (with action ids from the perspective of the player to move, like the policies given to
+// a batch_evaluator, so it can serve directly as a training target)
+template <typename G>
+void uct_node<G>::get_visit_policy(float * visits)
+{
+    std::fill(visits, visits + G::POLICY_SIZE, 0.0f);
+    const child_block _children = get_children();
+    for (size_t i=0;i<_children.size();++i)
+        visits[get_child_action_id(i, true)] = (float)children_stats->visit_count[i].load(std::memory_order_relaxed);
+}
+
+template <typename G>
+typename uct_node<G>::uct_node_ptr uct_node<G>::make_move_by_id(const size_t action_id, const bool flip)
+{
+    const child_block _children = get_children();
     for (size_t i=0;i<_children.size();++i)
-        if(_children[i]->state.get_action_text(flip)==action_text)
+        if(get_child_action_id(i, flip)==action_id)
             return make_move(i);
 
     throw std::string("Illegal move.");
@@ -395,10 +1295,27 @@ typename uct_node<G>::uct_node_ptr uct_node<G>::make_move(const std::string & ac
 template <typename G>
 std::vector<std::tuple<size_t, double, std::string>> uct_node<G>::get_sorted_actions(const bool flip)
 {
-    std::vector<uct_node_ptr> & _children = get_children();
+    return sort_actions([this, flip](const size_t i) { return G::action_id_to_text(get_child_action_id(i, flip)); });
+}
 
-    std::vector<std::tuple<double, double, size_t, std::string>> moves;
-    std::for_each(_children.cbegin(),_children.cend(),[&](const uct_node_ptr & _child)
+// as above, but with (visit_count, equity, action_id) tuples. Ties are broken by action id
+// rather than text, so the order of equal moves may differ from get_sorted_actions.
+template <typename G>
+std::vector<std::tuple<size_t, double, size_t>> uct_node<G>::get_sorted_action_ids(const bool flip)
+{
+    return sort_actions([this, flip](const size_t i) { return get_child_action_id(i, flip); });
+}
+
+template <typename G>
+template <typename ACTION_OF>
+auto uct_node<G>::sort_actions(ACTION_OF action_of) -> std::vector<std::tuple<size_t, double, decltype(action_of(size_t()))>>
+{
+    typedef decltype(action_of(size_t())) action_type;
+    const child_block _children = get_children();
+
+    // (read from children_stats and make_child_state, so that no child's node is built)
+    std::vector<std::tuple<double, double, size_t, action_type>> moves;
+    for (size_t i=0;i<_children.size();++i)
     {
         // primary sort criteria is equity.
         // secondary sort criteria is non_terminal_rank, which acts
@@ -407,26 +1324,26 @@ std::vector<std::tuple<size_t, double, std::string>> uct_node<G>::get_sorted_act
 
         // For internal sorting, use extreme negative value for unvisited nodes
         // This ensures proper UCT behavior while allowing display logic to handle it
-        double equity = _child->is_evaluated()
-            ? -_child->get_equity()
+        double equity = children_stats->is_evaluated(i)
+            ? -children_stats->equity(i)
             : std::numeric_limits<double>::lowest();
 
         moves.emplace_back(
             std::make_tuple(
                 equity,
-                (double)_child->state.get_non_terminal_rank(),
-                _child->visit_count,
-                _child->state.get_action_text(flip)
+                (double)make_child_state(i).get_non_terminal_rank(),
+                children_stats->visit_count[i].load(std::memory_order_relaxed),
+                action_of(i)
             )
         );
-    });
+    }
 
     // sort it in descending order
     std::sort(moves.rbegin(), moves.rend());
 
     // assemble output (don't want all the above fields, and the display order can change
     // from the sorting order)
-    std::vector<std::tuple<size_t, double, std::string>> moves_display;
+    std::vector<std::tuple<size_t, double, action_type>> moves_display;
     std::for_each(moves.cbegin(), moves.cend(),[&](const auto & move)
     {
         // Fix display bug: show reasonable equity for unvisited nodes instead of extreme negative value
@@ -439,7 +1356,7 @@ std::vector<std::tuple<size_t, double, std::string>> uct_node<G>::get_sorted_act
             std::make_tuple(
                 std::get<2>(move),  // visit_count
                 display_equity,     // corrected equity
-                std::get<3>(move)   // action_text
+                std::get<3>(move)   // action
             )
         );
     });
@@ -450,13 +1367,13 @@ std::vector<std::tuple<size_t, double, std::string>> uct_node<G>::get_sorted_act
 template <typename G>
 bool uct_node<G>::is_evaluated() const
 {
-    return eval_Q > std::numeric_limits<double>::lowest();
+    return eval_Q().load(std::memory_order_acquire) > std::numeric_limits<double>::lowest();
 }
 
 template <typename G>
 size_t uct_node<G>::get_visit_count() const
 {
-    return visit_count;
+    return visit_count().load(std::memory_order_relaxed);
 }
 
 template <typename G>
@@ -465,19 +1382,24 @@ double uct_node<G>::get_equity() const
     if (!is_evaluated())
         throw std::string("Error: cannot get equity without evaluation");
 
+    // Q_sum is loaded first: backprop bumps visit_count before Q_sum, so a concurrent
+    // reader can never see a Q_sum with more contributions than visits
+    double _Q_sum = Q_sum().load(std::memory_order_acquire);
+    size_t _visit_count = visit_count().load(std::memory_order_relaxed);
+
     // test code
-    double equity = visit_count > 0
-        ? Q_sum / (double)visit_count
-        : eval_Q;
+    double equity = _visit_count > 0
+        ? _Q_sum / (double)_visit_count
+        : eval_Q().load(std::memory_order_relaxed);
 
     if (equity < -1 || equity > 1)
         throw std::string(
             "Q_sum is " 
-            + lexical_cast<std::string>(Q_sum) + "\n"
+            + lexical_cast<std::string>(_Q_sum) + "\n"
             + "and visit count is "
-            + lexical_cast<std::string>(double(visit_count)) + "\n"
+            + lexical_cast<std::string>(double(_visit_count)) + "\n"
             + "and eval_Q is "
-            + lexical_cast<std::string>(eval_Q) + "\n"
+            + lexical_cast<std::string>(eval_Q().load()) + "\n"
         );
     return equity;
 }
@@ -489,102 +1411,146 @@ bool uct_node<G>::check_non_terminal_eval() const
     return state.check_non_terminal_eval(_);
 }
 
-// releases pointer reference to the parent
-// (stopping backprop at this node, allowing parent
-// to be safely deleted)
+// returns true if the search stopped short at an (evaluated) node it isn't allowed
+// to expand, because the tree has reached its memory budget
 template <typename G>
-void uct_node<G>::orphan()
-{
-    parent = NULL;
-}
-
-template <typename G>
-void uct_node<G>::select(
-    uct_node_ptr & leaf, 
+bool uct_node<G>::select(
+    uct_node * & leaf, 
     const double c, 
     Rand & rand, 
     const bool use_puct, // false means use traditional UCT formula
-    const bool use_probs
+    const bool use_probs,
+    const bool use_virtual_loss, // true when other threads may be searching this tree concurrently
+    search_stats * stats
     )
 {
     uct_node * curr_node_ptr = this;
 
     size_t while_loop_iteration=0; // test code
+    stats_timer timer(stats);
+    auto reached = [&](const bool at_budget)
+    {
+        leaf = curr_node_ptr;
+        if (stats)
+        {
+            ++stats->leaves;
+            stats->depth_sum += while_loop_iteration;
+            stats->max_depth = std::max<uint64_t>(stats->max_depth, while_loop_iteration);
+            if (leaf->state.is_terminal())
+                ++stats->terminal_hits;
+            else if (leaf->check_non_terminal_eval())
+                ++stats->non_terminal_eval_hits;
+            else if (leaf->is_proven())
+                ++stats->solved_hits;
+            stats->select_ns += timer.lap();
+        }
+        return at_budget;
+    };
+
     do
     {
+        if (curr_node_ptr!=this && !curr_node_ptr->can_expand())
+            return reached(true);
+
         size_t best_action=std::numeric_limits<size_t>::max();
-        const std::vector<uct_node_ptr> & curr_children = curr_node_ptr->get_children();
+        const child_block curr_children = curr_node_ptr->get_children(stats);
         if (curr_children.size()==0)
             throw std::string("Error: select encountered empty child vector, this shouldn't happen. Check continuation condition");
-        // make a vector of any unexplored children, and select one randomly if there are any
-        if (!curr_node_ptr->all_children_evaluated)
+        const child_stats & curr_stats = *curr_node_ptr->children_stats;
+        const bool any_child_proven = curr_node_ptr->any_child_proven.load(std::memory_order_relaxed);
+
+        // a child proven lost (for the player to move there) is a win here, so there's
+        // nothing to choose. (That proves this node too, so only the search's own root
+        // gets here with one)
+        for (size_t i=0;any_child_proven && i<curr_children.size() && best_action==std::numeric_limits<size_t>::max();++i)
+            if (curr_stats.proven[i].load(std::memory_order_relaxed)==child_stats::PROVEN_LOSS)
+                best_action=i;
+
+        // count any unexplored children, and select one randomly if there are any
+        if (best_action==std::numeric_limits<size_t>::max() && !curr_node_ptr->all_children_evaluated.load(std::memory_order_relaxed))
         {
-            std::vector<size_t> unexplored_children;
+            size_t num_unexplored=0;
+            bool pending_children=false; // children claimed by another thread, but not yet evaluated
             for (size_t i=0;i<curr_children.size();++i)
             {
-                // construct vector of unexplored children -- must choose one randomly
-                if (!curr_children[i]->is_evaluated())
-                    unexplored_children.push_back(i);
+                if (!curr_stats.is_evaluated(i))
+                {
+                    if (curr_stats.eval_claimed[i].load(std::memory_order_relaxed))
+                        pending_children=true;
+                    else
+                        ++num_unexplored;
+                }
             }
-            if (unexplored_children.size()>0)
+            if (num_unexplored>0)
+            {
                 // if not all children are explored, choose an unexplored node randomly
-                best_action=select_random_index(unexplored_children,rand);
-            else
+                // (in a parallel search the set can change under us; any unexplored child will do)
+                size_t choice=random_index(num_unexplored,rand);
+                for (size_t i=0;i<curr_children.size();++i)
+                {
+                    if (!curr_stats.is_evaluated(i) && !curr_stats.eval_claimed[i].load(std::memory_order_relaxed))
+                    {
+                        best_action=i;
+                        if (choice--==0)
+                            break;
+                    }
+                }
+            }
+            else if (!pending_children)
                 curr_node_ptr->all_children_evaluated=true;            
         }
 
-        if (curr_node_ptr->all_children_evaluated)
+        if (best_action==std::numeric_limits<size_t>::max())
         {
-            if (curr_node_ptr->visit_count==0)
+            // in-flight simulations count as visits (and as losses from this node's perspective)
+            size_t parent_visits = curr_node_ptr->get_visit_count()
+                + (use_virtual_loss ? curr_node_ptr->virtual_loss().load(std::memory_order_relaxed) : 0);
+            if (parent_visits==0)
                 throw std::string("Error: cannot select, parent node must have at least one visit");
-            double N = (double)curr_node_ptr->visit_count-1.0; // -1 because we want to count total simulations after parent move (traditional UCT); or total visit count to all actions from base state (PUCT)
-
-            double max_uct = std::numeric_limits<double>::lowest();
-            std::vector<size_t> best_actions;
-            for (size_t i=0;i<curr_children.size();++i)
+            double N = (double)parent_visits-1.0; // -1 because we want to count total simulations after parent move (traditional UCT); or total visit count to all actions from base state (PUCT)
+
+            // score every child in one pass over the statistics arrays. (children that are
+            // still being evaluated by another thread, in a parallel search, score lowest())
+            static thread_local std::vector<double> scores;
+            if (scores.size() < child_stats::padded(curr_children.size()))
+                scores.resize(child_stats::padded(curr_children.size()));
+            double max_uct = score_children(curr_stats, c, N, use_puct, use_probs, use_virtual_loss, scores.data());
+
+            // children proven won (for the player to move there) are lost here, so they're
+            // left alone -- unless every child is, when it makes no difference
+            if (any_child_proven)
             {
-                // standard uct formula, see e.g. https://en.wikipedia.org/wiki/Monte_Carlo_tree_search
-                // for a theoretical explanation. the negative sign on the first term
-                // accounts for the fact that evaluations in the child nodes
-                // are from villain's perspective, ergo a sign flip is needed
-                // to get them from hero's.
-                double Q = -curr_children[i]->get_equity();
-                double n = (double)curr_children[i]->visit_count;
-                double U;
-
-                if (N<0)
-                    throw std::string("Error: no visits to parent node");
-                else if (N==0)
-                    U = 0;
-                else
-                {                
-                    if (use_puct)
-                        // AlphaZero style PUCT formula
-                        U = sqrt(N) / (1.0+n);
-                    else
-                        // standard UCT formula
-                        U = sqrt(std::log(N) / std::max(n,1.0));
-                    if (use_probs)
-                        U *= curr_node_ptr->eval_probs[i];
+                double max_open = std::numeric_limits<double>::lowest();
+                for (size_t i=0;i<curr_children.size();++i)
+                    if (curr_stats.proven[i].load(std::memory_order_relaxed)!=child_stats::PROVEN_WIN)
+                        max_open = std::max(max_open, scores[i]);
+                if (max_open > std::numeric_limits<double>::lowest())
+                {
+                    for (size_t i=0;i<curr_children.size();++i)
+                        if (curr_stats.proven[i].load(std::memory_order_relaxed)==child_stats::PROVEN_WIN)
+                            scores[i] = std::numeric_limits<double>::lowest();
+                    max_uct = max_open;
                 }
+            }
 
-                double curr_uct = Q + c * U;
-
-                if (curr_uct >= max_uct)
-                {
-                    if (curr_uct > max_uct)
+            // randomly choose between ties, without collecting them anywhere
+            if (max_uct > std::numeric_limits<double>::lowest())
+            {
+                size_t num_best_actions=0;
+                for (size_t i=0;i<curr_children.size();++i)
+                    num_best_actions += scores[i]==max_uct;
+                size_t choice=random_index(num_best_actions,rand);
+                for (size_t i=0;i<curr_children.size();++i)
+                    if (scores[i]==max_uct && choice--==0)
                     {
-                        // reset if we have set a new high
-                        best_actions.clear();
-                        max_uct = curr_uct;
+                        best_action=i;
+                        break;
                     }
-                    best_actions.push_back(i);
-                }
             }
-        
-            //size_t num_best_actions=best_actions.size();
-            if (best_actions.size()>0)
-                best_action=select_random_value(best_actions,rand);
+            else if (use_virtual_loss)
+                // every child is still being evaluated by other threads. Pick one anyway;
+                // the caller will see the collision and retry
+                best_action=select_random_index(curr_children,rand);
 
             if (best_action==std::numeric_limits<size_t>::max())
                 throw std::string("Error: failed to select node");
@@ -605,12 +1571,14 @@ void uct_node<G>::select(
                 + lexical_cast<std::string>(while_loop_iteration)
             );
 
-        if (!curr_children[best_action].get())
-            throw std::string("error: null pointer!");
+        // at the memory budget, the search doesn't build new children below the root either
+        if (curr_node_ptr!=this && !curr_node_ptr->has_child(best_action) && curr_node_ptr->arena->over_budget())
+            return reached(true);
 
         // get the node we're choosing
-        leaf = curr_children[best_action];
-        curr_node_ptr = leaf.get();
+        curr_node_ptr = &curr_node_ptr->get_child(best_action, stats);
+        if (use_virtual_loss)
+            curr_node_ptr->virtual_loss().fetch_add(1, std::memory_order_relaxed);
         ++while_loop_iteration;
 
     }
@@ -621,111 +1589,675 @@ void uct_node<G>::select(
         && !curr_node_ptr->get_state().is_terminal()
         // and check that there isn't a non-terminal eval
         && !curr_node_ptr->check_non_terminal_eval()
+        // and that it hasn't been solved
+        && !curr_node_ptr->is_proven()
     );    
+    return reached(false);
 }
 
 template <typename G>
-std::vector<typename uct_node<G>::uct_node_ptr> & uct_node<G>::get_children()
+typename uct_node<G>::child_block uct_node<G>::get_children(search_stats * stats)
 {
     // nb: get_children can be thought of memoization for a child of a lazy evaluated
     // (which itself is a lazy tree)
-    if (children.size()==0)
+
+    // exactly one thread builds the children; any others wait for it to finish
+    unsigned char current = expansion_state.load(std::memory_order_acquire);
+    while (current!=EXPANDED)
+    {
+        if (current==UNEXPANDED && expansion_state.compare_exchange_strong(current, EXPANDING, std::memory_order_acquire))
+        {
+            stats_timer timer(stats);
+            try
+            {
+                expand();
+            }
+            catch (...)
+            {
+                expansion_state.store(UNEXPANDED, std::memory_order_release);
+                throw;
+            }
+            expansion_state.store(EXPANDED, std::memory_order_release);
+            if (stats)
+            {
+                stats->expand_ns += timer.lap();
+                ++stats->expansions;
+                stats->children += children_stats ? children_stats->count : 0;
+            }
+            break;
+        }
+        std::this_thread::yield();
+        current = expansion_state.load(std::memory_order_acquire);
+    }
+    return child_block{this, children_stats ? children_stats->count : 0};
+}
+
+// builds child i's node the first time it is asked for. (In a parallel search several
+// threads may build it at once: the first to publish its node wins, and the others
+// throw theirs away.)
+template <typename G>
+uct_node<G> & uct_node<G>::get_child(const size_t i, search_stats * stats)
+{
+    std::atomic<uct_node *> & slot = children[i];
+    uct_node * child = slot.load(std::memory_order_acquire);
+    if (child)
+        return *child;
+
+    G child_state = make_child_state(i);
+    void * memory = arena->allocate(sizeof(uct_node));
+    child = new (memory) uct_node(std::move(child_state), *this, children_stats, i);
+    uct_node * published = NULL;
+    if (!slot.compare_exchange_strong(published, child, std::memory_order_acq_rel, std::memory_order_acquire))
+    {
+        child->~uct_node();
+        arena->deallocate(memory, sizeof(uct_node));
+        return *published;
+    }
+    if (stats) ++stats->nodes_built;
+    return *child;
+}
+
+template <typename G>
+bool uct_node<G>::has_child(const size_t i) const noexcept
+{
+    return children[i].load(std::memory_order_acquire)!=NULL;
+}
+
+template <typename G>
+G uct_node<G>::make_child_state(const size_t i) const
+{
+    G child_state(state);
+    child_state.play_action_id(child_action_ids[i]);
+    return child_state;
+}
+
+template <typename G>
+size_t uct_node<G>::get_child_action_id(const size_t i, const bool flip) const noexcept
+{
+    // (stored from the perspective of the player making the move)
+    return flip ? child_action_ids[i] : G::flip_action_id(child_action_ids[i]);
+}
+
+// false once the tree has reached its memory budget, unless this node is already expanded
+template <typename G>
+bool uct_node<G>::can_expand() const noexcept
+{
+    return expansion_state.load(std::memory_order_acquire)==EXPANDED || !arena->over_budget();
+}
+
+template <typename G>
+void uct_node<G>::set_memory_budget(const size_t bytes) noexcept
+{
+    arena->set_budget(bytes);
+}
+
+template <typename G>
+size_t uct_node<G>::get_memory_budget() const noexcept
+{
+    return arena->get_budget();
+}
+
+template <typename G>
+size_t uct_node<G>::get_memory_usage() const noexcept
+{
+    return arena->get_bytes_in_use();
+}
+
+template <typename G>
+size_t uct_node<G>::get_memory_reserved() const noexcept
+{
+    return arena->get_bytes_reserved();
+}
+
+// sets up the children in a single block from the arena: their statistics and action ids,
+// but none of their nodes (or positions), which wait until they're needed (see get_child)
+template <typename G>
+void uct_node<G>::expand()
+{
+    // gather the moves first, so that the block can be sized exactly
+    static thread_local std::vector<size_t> action_ids;
+    action_ids.clear();
+    state.get_legal_action_ids(action_ids, true);
+    const size_t count = action_ids.size();
+    if (count==0)
+        return;
+
+    char * block = static_cast<char *>(arena->allocate(child_block_bytes(count)));
+    child_stats * _children_stats = child_stats::create(block, count);
+    std::atomic<uct_node *> * nodes = reinterpret_cast<std::atomic<uct_node *> *>(block + child_nodes_offset(count));
+    uint16_t * ids = reinterpret_cast<uint16_t *>(nodes + count);
+    for (size_t i=0;i<count;++i)
     {
-        state.get_legal_moves(*this);
-        children.shrink_to_fit();
+        new (nodes+i) std::atomic<uct_node *>(NULL);
+        ids[i] = (uint16_t)action_ids[i];
     }
-    return children;
+    children_stats = _children_stats;
+    children = nodes;
+    child_action_ids = ids;
+}
+
+// destroys the subtree below this node, handing its blocks back to the arena
+template <typename G>
+void uct_node<G>::release_children() noexcept
+{
+    if (!children_stats)
+        return;
+    const size_t count = children_stats->count;
+    for (size_t i=0;i<count;++i)
+    {
+        uct_node * child = children[i].load(std::memory_order_relaxed);
+        if (child)
+        {
+            child->~uct_node();
+            arena->deallocate(child, sizeof(uct_node));
+        }
+    }
+    arena->deallocate(children_stats, child_block_bytes(count));
+    children_stats = NULL;
+    children = NULL;
+    child_action_ids = NULL;
+}
+
+// the proof (if any) recorded in a tree image entry's flags
+template <typename G>
+signed char uct_node<G>::proof(const uint8_t flags) noexcept
+{
+    if (flags & tree_image<G>::PROVEN_WIN)
+        return child_stats::PROVEN_WIN;
+    if (flags & tree_image<G>::PROVEN_LOSS)
+        return child_stats::PROVEN_LOSS;
+    return child_stats::UNPROVEN;
+}
+
+// sets up the children of the node saved as entry, as expand would, with the statistics
+// they were saved with (the image's moves must be this position's, in the same order)
+template <typename G>
+void uct_node<G>::restore_children(const tree_image<G> & image, const size_t entry)
+{
+    static thread_local std::vector<size_t> action_ids;
+    action_ids.clear();
+    state.get_legal_action_ids(action_ids, true);
+    const size_t count = image.child_count(entry);
+    const size_t first = image.first_child(entry);
+    if (count!=action_ids.size())
+        throw std::string("Error: tree image doesn't match the position's moves");
+    for (size_t i=0;i<count;++i)
+        if (image.action_id(first+i)!=action_ids[i])
+            throw std::string("Error: tree image doesn't match the position's moves");
+
+    if (count>0)
+    {
+        expand();
+        for (size_t i=0;i<count;++i)
+        {
+            const size_t child = first+i;
+            children_stats->Q_sum[i] = image.Q_sum(child);
+            children_stats->eval_Q[i] = image.eval_Q(child);
+            children_stats->visit_count[i] = (size_t)image.visit_count(child);
+            children_stats->prior[i] = image.prior(child);
+            children_stats->eval_claimed[i] = children_stats->is_evaluated(i);
+            children_stats->proven[i] = proof(image.flags(child));
+            if (children_stats->proven[i]!=child_stats::UNPROVEN)
+                any_child_proven = true;
+        }
+    }
+    all_children_evaluated = (image.flags(entry) & tree_image<G>::ALL_CHILDREN_EVALUATED)!=0;
+    expansion_state.store(EXPANDED, std::memory_order_release);
+}
+
+template <typename G>
+std::vector<char> uct_node<G>::save() const
+{
+    // number the nodes breadth first, so that each node's children take consecutive entries.
+    // Unbuilt children get an entry (for their statistics) but no node
+    std::vector<const uct_node *> nodes(1, this);
+    std::vector<uint32_t> first_child(1, 0);
+    for (size_t e=0;e<nodes.size();++e)
+    {
+        const uct_node * node = nodes[e];
+        if (!node || !node->children_stats)
+            continue;
+        first_child[e] = (uint32_t)nodes.size();
+        const size_t count = node->children_stats->count;
+        if (nodes.size()+count > std::numeric_limits<uint32_t>::max())
+            throw std::string("Error: tree is too big to save");
+        for (size_t i=0;i<count;++i)
+            nodes.push_back(node->children[i].load(std::memory_order_acquire));
+        first_child.resize(nodes.size(), 0);
+    }
+
+    const size_t n = nodes.size();
+    std::vector<char> bytes = tree_image<G>::create(state, n);
+    const typename tree_image<G>::layout at(n);
+    auto put = [&](const size_t offset, const size_t i, const auto value)
+    {
+        std::memcpy(bytes.data() + offset + i*sizeof(value), &value, sizeof(value));
+    };
+    auto put_stats = [&](const size_t e, const child_stats & from, const size_t i)
+    {
+        put(at.visit_count, e, (uint64_t)from.visit_count[i].load(std::memory_order_relaxed));
+        put(at.Q_sum, e, from.Q_sum[i].load(std::memory_order_relaxed));
+        put(at.eval_Q, e, from.eval_Q[i].load(std::memory_order_relaxed));
+        put(at.prior, e, from.prior[i]);
+        const signed char result = from.proven[i].load(std::memory_order_relaxed);
+        put(at.flags, e, (uint8_t)(result==child_stats::PROVEN_WIN ? tree_image<G>::PROVEN_WIN : result==child_stats::PROVEN_LOSS ? tree_image<G>::PROVEN_LOSS : 0));
+    };
+    put_stats(0, *stats, stats_index);
+    for (size_t e=0;e<n;++e)
+    {
+        const uct_node * node = nodes[e];
+        if (!node)
+            continue;
+        uint8_t flags = (uint8_t)bytes[at.flags + e]; // (the proof, from put_stats)
+        if (node->expansion_state.load(std::memory_order_acquire)==EXPANDED)
+            flags |= tree_image<G>::EXPANDED;
+        if (node->all_children_evaluated.load(std::memory_order_relaxed))
+            flags |= tree_image<G>::ALL_CHILDREN_EVALUATED;
+        put(at.flags, e, flags);
+        if (!node->children_stats)
+            continue;
+        const size_t count = node->children_stats->count;
+        put(at.first_child, e, first_child[e]);
+        put(at.child_count, e, (uint16_t)count);
+        for (size_t i=0;i<count;++i)
+        {
+            put_stats(first_child[e]+i, *node->children_stats, i);
+            put(at.action_id, first_child[e]+i, node->child_action_ids[i]);
+        }
+    }
+    return bytes;
+}
+
+template <typename G>
+typename uct_node<G>::uct_node_ptr uct_node<G>::load(const tree_image<G> & image)
+{
+    uct_node_ptr root(new uct_node(image.root_state()));
+    root->Q_sum() = image.Q_sum(0);
+    root->eval_Q() = image.eval_Q(0);
+    root->visit_count() = (size_t)image.visit_count(0);
+    root->stats->prior[0] = image.prior(0);
+    root->eval_claimed() = root->is_evaluated();
+    root->proven() = proof(image.flags(0));
+
+    // (depth first, building just the nodes that had been expanded)
+    std::vector<std::pair<uct_node *, size_t>> pending(1, std::make_pair(root.get(), size_t(0)));
+    while (!pending.empty())
+    {
+        uct_node * node = pending.back().first;
+        const size_t entry = pending.back().second;
+        pending.pop_back();
+        if (!(image.flags(entry) & tree_image<G>::EXPANDED))
+            continue;
+        node->restore_children(image, entry);
+        const size_t first = image.first_child(entry);
+        for (size_t i=0;i<image.child_count(entry);++i)
+            if (image.flags(first+i) & tree_image<G>::EXPANDED)
+                pending.emplace_back(&node->get_child(i), first+i);
+    }
+    return root;
+}
+
+template <typename G>
+bool uct_node<G>::seed(const opening_book<G> & book)
+{
+    const size_t p = book.find(state);
+    if (p==opening_book<G>::NOT_FOUND)
+        return false;
+    const child_block _children = get_children();
+
+    bool seeded=false;
+    for (size_t m=book.first_move(p);m<book.first_move(p)+book.move_count(p);++m)
+    {
+        size_t i=0;
+        while (i<_children.size() && child_action_ids[i]!=book.action_id(m))
+            ++i;
+        if (i==_children.size())
+            continue;
+        child_stats & to = *children_stats;
+        const size_t visits = (size_t)book.visit_count(m);
+        const size_t own_visits = to.visit_count[i].load(std::memory_order_relaxed);
+        if (visits <= own_visits)
+            continue;
+        if (!to.is_evaluated(i))
+        {
+            to.eval_Q[i].store(book.eval_Q(m), std::memory_order_relaxed);
+            to.eval_claimed[i].store(true, std::memory_order_relaxed);
+        }
+        to.visit_count[i].store(visits, std::memory_order_relaxed);
+        to.Q_sum[i].store(book.Q_sum(m), std::memory_order_relaxed);
+        seeded=true;
+    }
+    if (!seeded)
+        return true;
+
+    // the root's own visit (its evaluation), and one for each of its children's, each of which
+    // backprops the negation of the child's value
+    const bool evaluated = is_evaluated();
+    size_t visits = evaluated ? 1 : 0;
+    double _Q_sum = evaluated ? eval_Q().load(std::memory_order_relaxed) : 0.0;
+    for (size_t i=0;i<_children.size();++i)
+    {
+        visits += children_stats->visit_count[i].load(std::memory_order_relaxed);
+        _Q_sum -= children_stats->Q_sum[i].load(std::memory_order_relaxed);
+    }
+    if (visits <= get_visit_count())
+        return true;
+    visit_count().store(visits, std::memory_order_relaxed);
+    Q_sum().store(_Q_sum, std::memory_order_relaxed);
+    if (!evaluated)
+    {
+        eval_Q().store(_Q_sum / (double)visits, std::memory_order_release);
+        eval_claimed().store(true, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+// where the node pointers start in a block of count children (just past their child_stats)
+template <typename G>
+size_t uct_node<G>::child_nodes_offset(const size_t count) noexcept
+{
+    constexpr size_t alignment = alignof(std::atomic<uct_node *>);
+    return (child_stats::bytes(count) + alignment-1) / alignment * alignment;
+}
+
+// bytes for a block of count children's child_stats, node pointers and action ids
+template <typename G>
+size_t uct_node<G>::child_block_bytes(const size_t count) noexcept
+{
+    return child_nodes_offset(count) + count*(sizeof(std::atomic<uct_node *>) + sizeof(uint16_t));
 }
  
 template <typename G>
-void uct_node<G>::eval(
+size_t uct_node<G>::eval(
     Rand & rand,
     const bool use_rollout,
-    const bool eval_children)
+    const bool eval_children,
+    transposition_table * table,
+    const rollout_policy & policy,
+    search_stats * stats,
+    rollout_pool<G> * pool)
 {
     if (!is_evaluated())
     {
-        // check if game is over
-        double non_terminal_eval;
+        double _eval_Q;
         bool truncate=false;
-        if (state.is_terminal())
-        {
-            eval_Q=state.get_terminal_eval();
-            truncate=true;
-        }
-        // check if a non-terminal exact eval is available
-        else if (state.check_non_terminal_eval(non_terminal_eval))
-        {
-            eval_Q=non_terminal_eval;
-            truncate=true;
-        }
+        size_t reused_visits=0;
+        if (try_quick_eval(_eval_Q, truncate, table, stats, &reused_visits))
+            ;
         else if (use_rollout)
             // use random rollout
-            eval_Q=rollout(rand);
+            _eval_Q=rollout(rand,policy,stats,pool);
         else {
             // use bespoke evaluation function (which may or may not provide action probs)
-            const std::vector<uct_node_ptr> & _children = get_children();
-            state.eval(_children,eval_Q,eval_probs);
+            const child_block _children = get_children(stats);
+            std::vector<double> eval_probs;
+            state.eval(_children,_eval_Q,eval_probs);
             // test code
             assert (eval_probs.size()==0 || eval_probs.size()==_children.size());
+            for (size_t i=0;i<eval_probs.size();++i)
+                children_stats->prior[i] = eval_probs[i];
         }
 
-        eval_probs.shrink_to_fit(); // want to shrink regardless of whether it has content
+        // publish the evaluation last, so that other threads that see is_evaluated()
+        // also see the children's priors
+        eval_Q().store(_eval_Q, std::memory_order_release);
 
-        if (eval_children && !truncate)
+        // (terminal and exact positions are solved)
+        if (truncate)
+            prove(_eval_Q>0 ? child_stats::PROVEN_WIN : child_stats::PROVEN_LOSS);
+
+        if (eval_children && !truncate && can_expand())
         {
-            const std::vector<uct_node_ptr> & _children = get_children();
+            const child_block _children = get_children(stats);
             for (size_t i=0;i<_children.size();++i)
-                _children[i]->eval(rand,use_rollout,false);
+            {
+                // (in a parallel search, another thread may have got to this child first)
+                uct_node & child = get_child(i, stats);
+                if (child.claim_eval())
+                    child.eval(rand,use_rollout,false,table,policy,stats,pool);
+            }
             all_children_evaluated=true;
         }
 
-        return;
+        return reused_visits;
     }
 
     throw std::string("Error: calling eval when already evaluated");
 }
 
+// the evaluations that need neither a rollout nor a model: terminal and exact non-terminal
+// positions (for which truncate is set, as there's nothing to learn from their children),
+// and transpositions that have already been searched, for which reused_visits (if given)
+// gets the visits the evaluation brings with it (see backprop), and is 0 otherwise. Returns
+// false if none applies.
+template <typename G>
+bool uct_node<G>::try_quick_eval(double & _eval_Q, bool & truncate, transposition_table * table, search_stats * stats, size_t * reused_visits) const
+{
+    truncate=false;
+    if (reused_visits) *reused_visits=0;
+
+    // check if game is over
+    if (state.is_terminal())
+    {
+        _eval_Q=state.get_terminal_eval();
+        truncate=true;
+        return true;
+    }
+
+    // check if a non-terminal exact eval is available
+    double non_terminal_eval;
+    if (state.check_non_terminal_eval(non_terminal_eval))
+    {
+        _eval_Q=non_terminal_eval;
+        truncate=true;
+        return true;
+    }
+
+    // reuse the statistics of a transposition, if one has already been searched
+    size_t visits;
+    if (!table || !table->probe(state.get_hash(), _eval_Q, visits))
+        return false;
+    if (reused_visits) *reused_visits = std::min(visits, transposition_table::MAX_REUSED_VISITS);
+    if (stats) ++stats->transposition_hits;
+    return true;
+}
+
+// publishes an evaluation from a batch_evaluator: _eval_Q from this node's perspective, and
+// a policy (G::POLICY_SIZE entries, by action id) that is renormalized over the legal moves
+// to give the children's priors
+template <typename G>
+void uct_node<G>::apply_eval(const double _eval_Q, const float * policy, search_stats * stats)
+{
+    // (at the memory budget, the priors wait until the node can be expanded)
+    const child_block _children = can_expand() ? get_children(stats) : child_block{NULL, 0};
+    double total=0;
+    for (size_t i=0;i<_children.size();++i)
+    {
+        const double prob = std::max(0.0f, policy[get_child_action_id(i, true)]);
+        children_stats->prior[i] = prob;
+        total += prob;
+    }
+    for (size_t i=0;i<_children.size();++i)
+        children_stats->prior[i] = total>0 ? children_stats->prior[i]/total : 1.0/(double)_children.size();
+
+    // publish the evaluation last, so that other threads that see is_evaluated()
+    // also see the children's priors
+    eval_Q().store(_eval_Q, std::memory_order_release);
+}
+
 template <typename G>
-double uct_node<G>::rollout(Rand & rand) const
+double uct_node<G>::rollout(Rand & rand, const rollout_policy & policy, search_stats * stats, rollout_pool<G> * pool) const
 {
-    return mcts::rollout<G>()(state,rand);
+    size_t plies=0;
+    const double value = pool
+        ? pool->run(state,policy,rand,stats ? &plies : NULL)
+        : mcts::rollout<G>()(state,policy,rand,stats ? &plies : NULL);
+    if (stats)
+    {
+        stats->rollouts += pool ? pool->size() : 1;
+        stats->rollout_plies += plies;
+    }
+    return value;
 }
 
-// performs the "backup" phase of the MCTS search
+// performs the "backup" phase of the MCTS search. virtual_loss_origin is the node the
+// (parallel) select started from: virtual loss is removed from every node below it.
+// With a transposition table, each node's value is also recorded against its position.
+// An evaluation taken from the table counts as the reused_visits visits behind it (see
+// try_quick_eval), rather than as one
 template <typename G>
-void uct_node<G>::backprop()
+void uct_node<G>::backprop(const uct_node * virtual_loss_origin, transposition_table * table, const size_t reused_visits)
 {
     // test code
     if (!is_evaluated())
         throw std::string("Error: cannot backprop without an evaluation");
-    if (visit_count>0 && !get_state().is_terminal() && !check_non_terminal_eval())
+    // (in a parallel search, other threads can search through this node as soon as its
+    // evaluation is published, so it may already have visits by now)
+    if (!virtual_loss_origin && get_visit_count()>0 && !is_proven() && !get_state().is_terminal() && !check_non_terminal_eval())
         throw std::string("Error: cannot backprop from a node with visits that is not terminal");
 
+    // a solved node backs up its proven value, rather than what it was first evaluated at
+    const signed char result = proven().load(std::memory_order_relaxed);
+    propagate(result!=child_stats::UNPROVEN ? (double)result : eval_Q().load(std::memory_order_relaxed), virtual_loss_origin, table, reused_visits);
+}
+
+// adds a visit with value _eval_Q (from this node's perspective) to this node and its
+// ancestors, or reused_visits of them, if that many come from the transposition table (see
+// backprop). backprop uses the node's own evaluation.
+//
+// The table isn't told about the root, which no other position transposes into, nor about
+// proven nodes, whose values are settled (and which are reached as terminal positions,
+// rather than from the table), nor about this node's own reused visits, which came from it
+template <typename G>
+void uct_node<G>::propagate(const double _eval_Q, const uct_node * virtual_loss_origin, transposition_table * table, const size_t reused_visits)
+{
+    const size_t visits = reused_visits>0 ? reused_visits : 1;
     uct_node * curr_node_ptr = this;
     bool initial_heros_turn = true;
+    bool below_origin = virtual_loss_origin!=NULL;
     while(curr_node_ptr)
     {
-        curr_node_ptr->Q_sum+=(initial_heros_turn?1.0:-1.0) * eval_Q;
-        curr_node_ptr->visit_count++;
+        if (curr_node_ptr==virtual_loss_origin)
+            below_origin=false;
+        // visit_count goes first (see get_equity)
+        curr_node_ptr->visit_count().fetch_add(visits, std::memory_order_relaxed);
+        atomic_add(curr_node_ptr->Q_sum(), (initial_heros_turn?1.0:-1.0) * _eval_Q * (double)visits);
+        if (table && curr_node_ptr->parent && !curr_node_ptr->is_proven() && !(curr_node_ptr==this && reused_visits>0))
+            table->update(curr_node_ptr->state.get_hash(), (initial_heros_turn?1.0:-1.0) * _eval_Q, visits);
+        if (below_origin)
+            curr_node_ptr->virtual_loss().fetch_sub(1, std::memory_order_relaxed);
         curr_node_ptr=curr_node_ptr->parent;
         initial_heros_turn = !initial_heros_turn;
     }
 }
 
+// undoes the virtual loss applied by select, for a simulation that was abandoned
+template <typename G>
+void uct_node<G>::revert_virtual_loss(const uct_node * virtual_loss_origin)
+{
+    if (!virtual_loss_origin)
+        return;
+    for (uct_node * curr_node_ptr = this; curr_node_ptr && curr_node_ptr!=virtual_loss_origin; curr_node_ptr=curr_node_ptr->parent)
+        curr_node_ptr->virtual_loss().fetch_sub(1, std::memory_order_relaxed);
+}
+
+// returns true if the calling thread has won the right to evaluate this node
+template <typename G>
+bool uct_node<G>::claim_eval()
+{
+    bool expected=false;
+    return eval_claimed().compare_exchange_strong(expected, true, std::memory_order_acq_rel);
+}
+
+template <typename G>
+void uct_node<G>::release_eval()
+{
+    eval_claimed().store(false, std::memory_order_release);
+}
+
+// records that this node's position is a proven win or loss (child_stats::PROVEN_WIN or
+// PROVEN_LOSS) for the player to move, and what follows from that for its ancestors.
+// (Proofs only ever go from unproven to proven, so threads can race to make them)
+template <typename G>
+void uct_node<G>::prove(const signed char result)
+{
+    signed char expected = child_stats::UNPROVEN;
+    if (proven().compare_exchange_strong(expected, result) && parent)
+        parent->child_proven(result);
+}
+
+// called once one of this node's children has been proven, with its result (from the
+// child's perspective)
+template <typename G>
+void uct_node<G>::child_proven(const signed char result)
+{
+    any_child_proven.store(true, std::memory_order_relaxed);
+    if (is_proven())
+        return;
+    if (result==child_stats::PROVEN_LOSS)
+    {
+        prove(child_stats::PROVEN_WIN);
+        return;
+    }
+    for (size_t i=0;i<children_stats->count;++i)
+        if (children_stats->proven[i].load()!=child_stats::PROVEN_WIN)
+            return;
+    prove(child_stats::PROVEN_LOSS);
+}
+
+template <typename G>
+bool uct_node<G>::is_proven() const noexcept
+{
+    return proven().load(std::memory_order_relaxed)!=child_stats::UNPROVEN;
+}
+
+template <typename G>
+int uct_node<G>::get_proven_result() const noexcept
+{
+    return proven().load(std::memory_order_acquire);
+}
+
+template <typename G>
+bool uct_node<G>::search_decided(const size_t remaining, const double factor) const noexcept
+{
+    if (get_proven_result()!=child_stats::UNPROVEN)
+        return true;
+    if (!children_stats)
+        return false;
+    size_t most=0, runner_up=0;
+    for (size_t i=0;i<children_stats->count;++i)
+    {
+        const size_t visits = children_stats->visit_count[i].load(std::memory_order_relaxed);
+        if (visits>most)
+        {
+            runner_up = most;
+            most = visits;
+        }
+        else if (visits>runner_up)
+            runner_up = visits;
+    }
+    // (a tie would be broken at random, so the runner-up must fall short of it)
+    return (double)most > (double)runner_up + (double)remaining/factor;
+}
+
 template <typename G>
 void uct_node<G>::Set_Null()
 {
-    Q_sum = 0;
-    eval_Q = std::numeric_limits<double>::lowest();
-    visit_count = 0;
     all_children_evaluated = false;
+    expansion_state = UNEXPANDED;
+    any_child_proven = false;
     parent = NULL;
+    arena = NULL;
+    stats = NULL;
+    stats_index = 0;
+    children_stats = NULL;
+    children = NULL;
+    child_action_ids = NULL;
 }
 
-// performs naive (completely random) rollout
+// plays moves chosen according to how until the episode ends
 template <typename G>
-double rollout<G>::operator()(const G & input, Rand & rand) const
+double rollout<G>::operator()(const G & input, const policy & how, Rand & rand, size_t * plies) const
 {
     bool initial_heros_turn = true;
 
@@ -736,17 +2268,18 @@ double rollout<G>::operator()(const G & input, Rand & rand) const
         // agent from initial move)
         if (curr_move.is_terminal())
         {
+            if (plies) *plies = i;
             return (initial_heros_turn?1.0:-1.0) * curr_move.get_terminal_eval();
         }
 
         double eval;
         if (curr_move.check_non_terminal_eval(eval))
+        {
+            if (plies) *plies = i;
             return (initial_heros_turn?1.0:-1.0) * eval;
+        }
 
-        std::vector<G> actions;
-        curr_move.get_legal_moves(actions);
-
-        curr_move = select_random_value(actions,rand);
+        play_random_move(curr_move,how,rand);
 
         // flip whose turn it is
         initial_heros_turn = !initial_heros_turn;
@@ -756,6 +2289,136 @@ double rollout<G>::operator()(const G & input, Rand & rand) const
     throw std::string("Error: mcts::rollout MAX_ITERATIONS reached without end of episode.");
 }
 
+template <typename G>
+void rollout<G>::play_random_move(G & position, const policy & /*how*/, Rand & rand) const
+{
+    // (reused across rollouts, so that a rollout allocates nothing once it has warmed up)
+    static thread_local std::vector<G> actions;
+    actions.clear();
+    position.get_legal_moves(actions);
+
+    position = select_random_value(actions,rand);
+}
+
+template <typename G>
+rollout_pool<G>::rollout_pool(const size_t rollouts, Rand & rand) :
+    position(NULL),
+    how(NULL),
+    round(0),
+    pending(0),
+    stopping(false)
+{
+    // (all sized before any thread starts, so that nothing moves under them)
+    const size_t count = std::max<size_t>(rollouts, 1) - 1;
+    for (size_t k=0;k<count;++k)
+        worker_rands.push_back(rand.split());
+    values.resize(count);
+    lengths.resize(count);
+    try
+    {
+        for (size_t k=0;k<count;++k)
+            workers.emplace_back(&rollout_pool::work, this, k);
+    }
+    catch (...)
+    {
+        stop();
+        throw;
+    }
+}
+
+template <typename G>
+rollout_pool<G>::~rollout_pool() noexcept
+{
+    stop();
+}
+
+template <typename G>
+double rollout_pool<G>::run(const G & input, const policy & _how, Rand & rand, size_t * plies)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        position = &input;
+        how = &_how;
+        pending = workers.size();
+        ++round;
+    }
+    work_ready.notify_all();
+
+    double sum=0.0;
+    size_t length=0;
+    std::exception_ptr own_error;
+    try
+    {
+        sum = rollout<G>()(input, _how, rand, &length);
+    }
+    catch (...)
+    {
+        own_error = std::current_exception();
+    }
+
+    // (the threads are reading input, so wait for them even after an error)
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this] { return pending==0; });
+    std::exception_ptr worker_error(std::move(error));
+    error = NULL;
+    if (own_error)
+        std::rethrow_exception(own_error);
+    if (worker_error)
+        std::rethrow_exception(worker_error);
+
+    for (size_t k=0;k<values.size();++k)
+    {
+        sum += values[k];
+        length += lengths[k];
+    }
+    if (plies) *plies = length;
+    return sum / (double)size();
+}
+
+template <typename G>
+void rollout_pool<G>::work(const size_t k)
+{
+    size_t seen=0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        work_ready.wait(lock, [&] { return stopping || round!=seen; });
+        if (stopping)
+            return;
+        seen = round;
+        lock.unlock();
+
+        std::exception_ptr own_error;
+        try
+        {
+            lengths[k] = 0;
+            values[k] = rollout<G>()(*position, *how, worker_rands[k], &lengths[k]);
+        }
+        catch (...)
+        {
+            own_error = std::current_exception();
+        }
+
+        lock.lock();
+        if (own_error && !error)
+            error = own_error;
+        if (--pending==0)
+            work_done.notify_one();
+    }
+}
+
+template <typename G>
+void rollout_pool<G>::stop() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (std::thread & w : workers)
+        w.join();
+}
+
 } // namespace mcts
 
 // Make lexical_cast available globally for compatibility
@@ -0,0 +1,196 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <new>
+#include <algorithm>
+
+namespace mcts {
+
+// Backing storage for the child blocks of one search tree.
+//
+// Memory is carved out of large slabs and recycled through free lists, one per size class
+// (sizes are rounded up to a cache line), so expanding a node is a pointer bump or a free
+// list pop rather than ~100 separate heap allocations. Blocks released when make_move
+// discards a subtree go back on the free lists for later expansions, and the slabs
+// themselves are only returned to the system when the last tree using the arena goes away.
+//
+// The arena is shared by the trees that descend from one another via make_move, and is
+// reference counted by them (see acquire / release). All operations are thread safe.
+//
+// It also keeps track of how much memory the trees are using, against an optional budget
+// that the search checks before growing the tree (see uct_node::set_memory_budget).
+class node_arena
+{
+public:
+    constexpr static size_t BLOCK_ALIGNMENT = 64;
+    constexpr static size_t SLAB_BYTES = size_t(1) << 20;
+
+    node_arena() noexcept : references(1), in_use(0), reserved(0), budget(0), slab_cursor(NULL), slab_end(NULL) {}
+    node_arena(const node_arena & source) = delete;
+    node_arena & operator=(const node_arena & source) = delete;
+
+    ~node_arena() noexcept
+    {
+        for (void * slab : slabs)
+            ::operator delete(slab, std::align_val_t(BLOCK_ALIGNMENT));
+    }
+
+    void * allocate(const size_t bytes)
+    {
+        const size_t size_class = get_size_class(bytes);
+        lock();
+        void * block;
+        size_t donor_class = size_class;
+        while (donor_class < free_lists.size() && !free_lists[donor_class])
+            ++donor_class;
+        if (donor_class < free_lists.size())
+        {
+            block = pop(donor_class);
+
+            // positions (and so child counts) shrink as the game goes on, so carving the
+            // block we need out of a bigger free one keeps old blocks from going to waste
+            if (donor_class > size_class)
+                push(static_cast<char *>(block) + size_class * BLOCK_ALIGNMENT, donor_class - size_class);
+        }
+        else
+        {
+            try
+            {
+                // (sized here so that deallocate never needs to allocate)
+                if (size_class >= free_lists.size())
+                    free_lists.resize(size_class+1, NULL);
+                block = carve(size_class * BLOCK_ALIGNMENT);
+            }
+            catch (...)
+            {
+                unlock();
+                throw;
+            }
+        }
+        in_use.store(in_use.load(std::memory_order_relaxed) + size_class * BLOCK_ALIGNMENT, std::memory_order_relaxed);
+        unlock();
+        return block;
+    }
+
+    // bytes must match the size the block was allocated with
+    void deallocate(void * block, const size_t bytes) noexcept
+    {
+        const size_t size_class = get_size_class(bytes);
+        lock();
+        push(block, size_class);
+        in_use.store(in_use.load(std::memory_order_relaxed) - size_class * BLOCK_ALIGNMENT, std::memory_order_relaxed);
+        unlock();
+    }
+
+    // bytes in blocks that are currently allocated (rounded up to whole cache lines)
+    size_t get_bytes_in_use() const noexcept
+    {
+        return in_use.load(std::memory_order_relaxed);
+    }
+
+    // bytes taken from the system, allocated or not
+    size_t get_bytes_reserved() const noexcept
+    {
+        return reserved.load(std::memory_order_relaxed);
+    }
+
+    // 0 means no budget
+    void set_budget(const size_t bytes) noexcept
+    {
+        budget.store(bytes, std::memory_order_relaxed);
+    }
+
+    size_t get_budget() const noexcept
+    {
+        return budget.load(std::memory_order_relaxed);
+    }
+
+    bool over_budget() const noexcept
+    {
+        const size_t _budget = budget.load(std::memory_order_relaxed);
+        return _budget>0 && in_use.load(std::memory_order_relaxed) >= _budget;
+    }
+
+    void acquire() noexcept
+    {
+        references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // deletes the arena once the last reference has gone
+    void release() noexcept
+    {
+        if (references.fetch_sub(1, std::memory_order_acq_rel)==1)
+            delete this;
+    }
+
+private:
+    std::atomic<size_t> references;
+    std::atomic<size_t> in_use; // (only changed under the lock, but read without it)
+    std::atomic<size_t> reserved;
+    std::atomic<size_t> budget;
+    std::atomic_flag locked = ATOMIC_FLAG_INIT;
+    std::vector<void *> free_lists; // singly linked through the first word of each free block
+    std::vector<void *> slabs;
+    char * slab_cursor;
+    char * slab_end;
+
+    static size_t get_size_class(const size_t bytes) noexcept
+    {
+        return (std::max(bytes, sizeof(void *)) + BLOCK_ALIGNMENT-1) / BLOCK_ALIGNMENT;
+    }
+
+    void * pop(const size_t size_class) noexcept
+    {
+        void * block = free_lists[size_class];
+        free_lists[size_class] = *static_cast<void **>(block);
+        return block;
+    }
+
+    void push(void * block, const size_t size_class) noexcept
+    {
+        *static_cast<void **>(block) = free_lists[size_class];
+        free_lists[size_class] = block;
+    }
+
+    // takes fresh memory from the current slab, starting a new one if it's full. Blocks too
+    // big to share a slab get one to themselves, so that at most a quarter of a slab is ever
+    // left unused at the end.
+    void * carve(const size_t bytes)
+    {
+        if (bytes > SLAB_BYTES/4)
+            return new_slab(bytes);
+        if (bytes > size_t(slab_end - slab_cursor))
+        {
+            slab_cursor = new_slab(SLAB_BYTES);
+            slab_end = slab_cursor + SLAB_BYTES;
+        }
+        void * block = slab_cursor;
+        slab_cursor += bytes;
+        return block;
+    }
+
+    char * new_slab(const size_t bytes)
+    {
+        slabs.reserve(slabs.size()+1);
+        char * slab = static_cast<char *>(::operator new(bytes, std::align_val_t(BLOCK_ALIGNMENT)));
+        slabs.push_back(slab);
+        reserved.store(reserved.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        return slab;
+    }
+
+    // critical sections are a handful of instructions, so spin rather than sleep
+    void lock() noexcept
+    {
+        while (locked.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+
+    void unlock() noexcept
+    {
+        locked.clear(std::memory_order_release);
+    }
+};
+
+} // namespace mcts
@@ -0,0 +1,254 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "mapped_file.hpp"
+#include "tree_image.hpp"
+
+namespace mcts {
+
+// Search statistics for the positions at the start of the game, gathered by deep searches
+// done ahead of time, so that a game can start from them instead of from nothing (see
+// uct_node::seed).
+//
+// For each position it holds the statistics of every move the searches tried there, just
+// as the position's node held them in the search tree: visit count, Q_sum and evaluation,
+// each from the perspective of the position the move leads to, with the move's action id
+// from the perspective of the player making it. Positions are kept sorted by hash (with the
+// position itself, to tell collisions apart) in flat arrays, so a book is mapped from its
+// file and searched where it lies.
+//
+// Books are built from saved search trees (see build), and are only read by builds with the
+// same G, in the byte order of the machine that built them.
+template <typename G>
+class opening_book
+{
+    static_assert(std::is_trivially_copyable<G>::value, "positions are stored as their bytes");
+public:
+    constexpr static size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+
+    struct header
+    {
+        format_header<G> format;
+        uint64_t positions;
+        uint64_t moves;
+    };
+
+    constexpr static uint32_t VERSION = 2;
+
+    // a book of every position in trees that was searched at least min_visits times, within
+    // max_depth moves of its tree's root. A position in more than one tree (or reached by
+    // more than one order of moves) is taken from wherever it was searched most
+    static std::vector<char> build(const std::vector<tree_image<G>> & trees, const size_t min_visits, const size_t max_depth)
+    {
+        struct candidate
+        {
+            G state;
+            uint64_t hash;
+            uint64_t visits;
+            const tree_image<G> * tree;
+            size_t entry;
+        };
+        std::vector<candidate> found;
+        for (const tree_image<G> & tree : trees)
+        {
+            std::vector<std::tuple<size_t, G, size_t>> pending(1, std::make_tuple(size_t(0), tree.root_state(), size_t(0)));
+            while (!pending.empty())
+            {
+                const size_t entry = std::get<0>(pending.back());
+                const G state = std::get<1>(pending.back());
+                const size_t depth = std::get<2>(pending.back());
+                pending.pop_back();
+                if (tree.visit_count(entry) < std::max<size_t>(min_visits, 1) || tree.child_count(entry)==0)
+                    continue;
+                found.push_back(candidate{state, (uint64_t)state.get_hash(), tree.visit_count(entry), &tree, entry});
+                if (depth==max_depth)
+                    continue;
+                const size_t first = tree.first_child(entry);
+                for (size_t child=first;child<first+tree.child_count(entry);++child)
+                {
+                    if (tree.visit_count(child) < std::max<size_t>(min_visits, 1))
+                        continue;
+                    G next(state);
+                    next.play_action_id(tree.action_id(child));
+                    pending.emplace_back(child, next, depth+1);
+                }
+            }
+        }
+
+        // by hash, then most searched first, so the copy of a position to keep comes first
+        std::sort(found.begin(), found.end(), [](const candidate & a, const candidate & b)
+        {
+            return a.hash!=b.hash ? a.hash<b.hash : a.visits>b.visits;
+        });
+        std::vector<const candidate *> kept;
+        for (size_t i=0;i<found.size();++i)
+        {
+            bool duplicate=false;
+            for (size_t j=kept.size();j>0 && kept[j-1]->hash==found[i].hash && !duplicate;--j)
+                duplicate = kept[j-1]->state==found[i].state;
+            if (!duplicate)
+                kept.push_back(&found[i]);
+        }
+
+        size_t moves=0;
+        for (const candidate * c : kept)
+            for (size_t child=c->tree->first_child(c->entry);child<c->tree->first_child(c->entry)+c->tree->child_count(c->entry);++child)
+                moves += c->tree->visit_count(child)>0;
+
+        const layout at(kept.size(), moves);
+        std::vector<char> bytes(at.bytes, 0);
+        header h;
+        h.format = format_header<G>(MAGIC, VERSION);
+        h.positions = kept.size();
+        h.moves = moves;
+        std::memcpy(bytes.data(), &h, sizeof(h));
+        auto put = [&](const size_t offset, const size_t i, const auto value)
+        {
+            std::memcpy(bytes.data() + offset + i*sizeof(value), &value, sizeof(value));
+        };
+        size_t m=0;
+        for (size_t p=0;p<kept.size();++p)
+        {
+            const candidate & c = *kept[p];
+            put(at.state, p, c.state);
+            put(at.hash, p, c.hash);
+            put(at.first_move, p, (uint32_t)m);
+            const size_t first = c.tree->first_child(c.entry);
+            uint16_t count=0;
+            for (size_t child=first;child<first+c.tree->child_count(c.entry);++child)
+            {
+                if (c.tree->visit_count(child)==0)
+                    continue;
+                put(at.action_id, m, (uint16_t)c.tree->action_id(child));
+                put(at.visit_count, m, c.tree->visit_count(child));
+                put(at.Q_sum, m, c.tree->Q_sum(child));
+                put(at.eval_Q, m, c.tree->eval_Q(child));
+                ++m;
+                ++count;
+            }
+            put(at.move_count, p, count);
+        }
+        return bytes;
+    }
+
+    // takes over a book held in memory
+    explicit opening_book(std::vector<char> && bytes) :
+        file(std::move(bytes))
+    {
+        check();
+    }
+
+    // maps a book written by write
+    static opening_book open(const std::string & path)
+    {
+        return opening_book(mapped_file::open(path, "opening book"));
+    }
+
+    // writes bytes (as made by build) to path, replacing the file
+    static void write(const std::string & path, const std::vector<char> & bytes)
+    {
+        mapped_file::write(path, bytes, "opening book");
+    }
+
+    size_t positions() const noexcept { return (size_t)get_header().positions; }
+    size_t moves() const noexcept { return (size_t)get_header().moves; }
+
+    // the index of state's position, or NOT_FOUND
+    size_t find(const G & state) const noexcept
+    {
+        const uint64_t hash = (uint64_t)state.get_hash();
+        size_t low=0, high=positions();
+        while (low<high)
+        {
+            const size_t middle = low + (high-low)/2;
+            if (file.read<uint64_t>(at.hash, middle) < hash)
+                low = middle+1;
+            else
+                high = middle;
+        }
+        for (size_t p=low;p<positions() && file.read<uint64_t>(at.hash, p)==hash;++p)
+            if (file.read<G>(at.state, p)==state)
+                return p;
+        return NOT_FOUND;
+    }
+
+    G state(const size_t p) const noexcept { return file.read<G>(at.state, p); }
+    size_t first_move(const size_t p) const noexcept { return file.read<uint32_t>(at.first_move, p); }
+    size_t move_count(const size_t p) const noexcept { return file.read<uint16_t>(at.move_count, p); }
+
+    size_t action_id(const size_t m) const noexcept { return file.read<uint16_t>(at.action_id, m); }
+    uint64_t visit_count(const size_t m) const noexcept { return file.read<uint64_t>(at.visit_count, m); }
+    double Q_sum(const size_t m) const noexcept { return file.read<double>(at.Q_sum, m); }
+    double eval_Q(const size_t m) const noexcept { return file.read<double>(at.eval_Q, m); }
+
+private:
+    constexpr static char MAGIC[8] = {'M','C','T','S','B','O','O','K'};
+
+    // the arrays follow the header in this order
+    struct layout
+    {
+        size_t state, hash, first_move, move_count, action_id, visit_count, Q_sum, eval_Q, bytes;
+
+        layout(const uint64_t positions, const uint64_t moves) noexcept
+        {
+            const size_t p = (size_t)positions;
+            const size_t m = (size_t)moves;
+            array_layout arrays(sizeof(header));
+            state = arrays.place(p*sizeof(G));
+            hash = arrays.place(p*sizeof(uint64_t));
+            first_move = arrays.place(p*sizeof(uint32_t));
+            move_count = arrays.place(p*sizeof(uint16_t));
+            action_id = arrays.place(m*sizeof(uint16_t));
+            visit_count = arrays.place(m*sizeof(uint64_t));
+            Q_sum = arrays.place(m*sizeof(double));
+            eval_Q = arrays.place(m*sizeof(double));
+            bytes = arrays.end();
+        }
+    };
+
+    mapped_file file;
+    layout at{0, 0};
+
+    explicit opening_book(mapped_file && _file) :
+        file(std::move(_file))
+    {
+        check();
+    }
+
+    header get_header() const noexcept
+    {
+        return file.read<header>(0);
+    }
+
+    // rejects anything that isn't a well formed book for this G, so that lookups never read
+    // out of bounds and every position is one G can play from (see G::is_valid), filed
+    // under its own hash
+    void check()
+    {
+        if (file.size() < sizeof(header))
+            throw std::string("Error: opening book is truncated");
+        const header h = get_header();
+        h.format.check(MAGIC, VERSION, "opening book");
+        if (h.positions > std::numeric_limits<uint32_t>::max() || h.moves > std::numeric_limits<uint32_t>::max())
+            throw std::string("Error: opening book is corrupt");
+        at = layout(h.positions, h.moves);
+        if (file.size() < at.bytes)
+            throw std::string("Error: opening book is truncated");
+        for (size_t p=0;p<positions();++p)
+            if (first_move(p)+move_count(p) > moves() || (p>0 && file.read<uint64_t>(at.hash, p-1) > file.read<uint64_t>(at.hash, p))
+                || !state(p).is_valid() || (uint64_t)state(p).get_hash()!=file.read<uint64_t>(at.hash, p))
+                throw std::string("Error: opening book is corrupt");
+    }
+};
+
+template <typename G>
+constexpr char opening_book<G>::MAGIC[8];
+
+} // namespace mcts
@@ -0,0 +1,113 @@
+#pragma once
+#include <memory>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <cstddef>
+
+namespace mcts {
+
+// Destroys discarded search trees on a background thread.
+//
+// After a big search, tearing down the siblings of the chosen move visits every node below
+// them, which takes long enough to show up in the latency of a move. Handing the old root
+// to reclaim instead returns at once: the last reference to it is dropped by the worker,
+// while the caller gets on with searching the subtree it kept. (The two trees share an
+// arena, whose blocks can be freed and reused from any thread -- see node_arena.)
+//
+// The worker is started by the first reclaim, and the destructor waits for everything
+// already handed over.
+class reclaimer
+{
+public:
+    reclaimer() noexcept : stopping(false), busy(false), reclaimed(0) {}
+    reclaimer(const reclaimer & source) = delete;
+    reclaimer & operator=(const reclaimer & source) = delete;
+
+    ~reclaimer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_one();
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // garbage is released on the worker thread (or right here, if no thread can be started)
+    void reclaim(std::shared_ptr<void> garbage)
+    {
+        if (!garbage) return;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        queue.push_back(std::move(garbage));
+        if (!worker.joinable())
+        {
+            try
+            {
+                worker = std::thread(&reclaimer::run, this);
+            }
+            catch (const std::system_error &)
+            {
+                garbage = std::move(queue.back());
+                queue.pop_back();
+                ++reclaimed;
+                lock.unlock();
+                return; // (garbage goes here)
+            }
+        }
+        lock.unlock();
+        work_available.notify_one();
+    }
+
+    // blocks until everything handed over so far has been destroyed
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        idle.wait(lock, [this] { return queue.empty() && !busy; });
+    }
+
+    // the number of trees destroyed so far
+    size_t get_reclaimed() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return reclaimed;
+    }
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable idle;
+    std::deque<std::shared_ptr<void>> queue;
+    std::thread worker;
+    bool stopping;
+    bool busy;
+    size_t reclaimed;
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            work_available.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (queue.empty())
+                return; // (only once stopping, so nothing handed over is ever leaked)
+
+            std::shared_ptr<void> garbage(std::move(queue.front()));
+            queue.pop_front();
+            busy = true;
+            lock.unlock();
+            garbage.reset();
+            lock.lock();
+            busy = false;
+            ++reclaimed;
+            if (queue.empty())
+                idle.notify_all();
+        }
+    }
+};
+
+} // namespace mcts
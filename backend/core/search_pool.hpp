@@ -0,0 +1,269 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+#include "mcts.hpp"
+
+namespace mcts {
+
+// Runs many searches (typically one per game, each of its own tree) on one fixed set of
+// threads, a quantum of simulations at a time.
+//
+// Whenever a thread is free, it runs the next quantum of the waiting search with the highest
+// priority, then the earliest deadline, then the longest wait since its previous quantum. So
+// searches with the same priority and deadline take turns, and none is held up by a long one
+// for more than a quantum. A search is only ever run by one thread at a time.
+//
+// A search is done once it has run all its simulations, its deadline has passed, it has
+// been cancelled, or it has thrown. Its completion is then called, on the thread that ran
+// its last quantum (so it should be quick, and must not throw). The destructor cancels
+// every search still waiting or running, and waits for all their completions.
+class search_pool
+{
+public:
+    // runs up to simulations simulations, stopping early at the deadline or once stop is set
+    // (as uct_node::simulate does), and returns the number actually run
+    typedef std::function<size_t(const size_t simulations, const Deadline deadline, const std::atomic<bool> * stop)> quantum;
+    typedef std::function<void(const size_t completed, std::exception_ptr error)> completion;
+
+    // threads==0 means one per hardware thread. Pinned threads each stay on a core of their own
+    // (where the platform allows it)
+    search_pool(const size_t threads, const size_t quantum_size, const bool pin_threads = false) :
+        quantum_size(std::max<size_t>(quantum_size, 1)),
+        next_id(1),
+        next_ticket(0),
+        stopping(false)
+    {
+        const size_t hardware_threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        const size_t count = threads>0 ? threads : hardware_threads;
+        try
+        {
+            for (size_t t=0;t<count;++t)
+            {
+                workers.emplace_back(&search_pool::run, this);
+                if (pin_threads)
+                    pin(workers.back(), t % hardware_threads);
+            }
+        }
+        catch (...)
+        {
+            shut_down();
+            throw;
+        }
+    }
+    search_pool(const search_pool & source) = delete;
+    search_pool & operator=(const search_pool & source) = delete;
+
+    ~search_pool()
+    {
+        shut_down();
+    }
+
+    // queues a search, returning its id (never 0)
+    size_t submit(quantum work, const size_t simulations, const int priority, const Deadline deadline, completion done)
+    {
+        std::unique_ptr<search> s(new search());
+        s->work = std::move(work);
+        s->done = std::move(done);
+        s->remaining = simulations;
+        s->priority = priority;
+        s->deadline = deadline;
+        size_t id;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            id = s->id = next_id++;
+            s->ticket = next_ticket++;
+            searches.push_back(std::move(s));
+        }
+        work_available.notify_one();
+        return id;
+    }
+
+    // stops the search (in the middle of its quantum, if it's running). Its completion is still
+    // called, with the simulations run so far. Does nothing once the search is done
+    void cancel(const size_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const std::unique_ptr<search> & s : searches)
+            if (s->id==id)
+                s->stop.store(true, std::memory_order_relaxed);
+        work_available.notify_one(); // (a waiting search that's been cancelled is finished off at once)
+    }
+
+    // blocks until the search is done (its completion may still be running)
+    void wait(const size_t id)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        search_done.wait(lock, [&]
+        {
+            return std::none_of(searches.begin(), searches.end(), [&](const std::unique_ptr<search> & s) { return s->id==id; });
+        });
+    }
+
+    size_t get_threads() const noexcept
+    {
+        return workers.size();
+    }
+
+    size_t get_quantum_size() const noexcept
+    {
+        return quantum_size;
+    }
+
+    // searches waiting or running
+    size_t get_searches() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return searches.size();
+    }
+
+private:
+    struct search
+    {
+        size_t id;
+        quantum work;
+        completion done;
+        size_t remaining;
+        size_t completed = 0;
+        int priority;
+        Deadline deadline;
+        uint64_t ticket; // when it last joined the queue (lowest goes first, other things equal)
+        bool running = false;
+        std::atomic<bool> stop{false};
+    };
+
+    const size_t quantum_size;
+    mutable std::mutex mutex;
+    std::condition_variable work_available;
+    std::condition_variable search_done;
+    std::vector<std::unique_ptr<search>> searches;
+    std::vector<std::thread> workers;
+    size_t next_id;
+    uint64_t next_ticket;
+    bool stopping;
+
+    // the waiting search to run next (see the class comment), or NULL
+    search * pick() const
+    {
+        search * best = NULL;
+        for (const std::unique_ptr<search> & s : searches)
+        {
+            if (s->running)
+                continue;
+            if (!best
+                || s->priority > best->priority
+                || (s->priority==best->priority && (s->deadline < best->deadline
+                    || (s->deadline==best->deadline && s->ticket < best->ticket))))
+                best = s.get();
+        }
+        return best;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;)
+        {
+            search * s;
+            work_available.wait(lock, [&] { return (s = pick())!=NULL || stopping; });
+            if (!s)
+                return; // (only once stopping: the searches still running belong to other threads)
+
+            s->running = true;
+            const size_t simulations = std::min(quantum_size, s->remaining);
+            lock.unlock();
+
+            size_t completed=0;
+            std::exception_ptr error;
+            if (!s->stop.load(std::memory_order_relaxed))
+            {
+                try
+                {
+                    completed = s->work(simulations, s->deadline, &s->stop);
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            lock.lock();
+            s->completed += completed;
+            s->remaining -= std::min(completed, s->remaining);
+            // (a quantum cut short means the deadline passed, or the search can't go on)
+            const bool done = error
+                || s->stop.load(std::memory_order_relaxed)
+                || s->remaining==0
+                || completed < simulations
+                || (s->deadline!=NO_DEADLINE && std::chrono::steady_clock::now() >= s->deadline);
+            if (!done)
+            {
+                s->running = false;
+                s->ticket = next_ticket++;
+                continue; // (this thread is free again, so it picks the next quantum itself)
+            }
+
+            std::unique_ptr<search> finished;
+            for (std::unique_ptr<search> & entry : searches)
+                if (entry.get()==s)
+                {
+                    finished = std::move(entry);
+                    std::swap(entry, searches.back());
+                    searches.pop_back();
+                    break;
+                }
+            lock.unlock();
+            search_done.notify_all();
+            try
+            {
+                finished->done(finished->completed, error);
+            }
+            catch (...)
+            {
+            }
+            finished.reset(); // (the search's functions are released here, before the lock is retaken)
+            lock.lock();
+        }
+    }
+
+    void shut_down() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            for (const std::unique_ptr<search> & s : searches)
+                s->stop.store(true, std::memory_order_relaxed);
+        }
+        work_available.notify_all();
+        for (std::thread & w : workers)
+            w.join();
+        workers.clear();
+    }
+
+    static void pin(std::thread & thread, const size_t core) noexcept
+    {
+#ifdef __linux__
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(core, &cores);
+        pthread_setaffinity_np(thread.native_handle(), sizeof(cores), &cores); // (best effort)
+#else
+        (void)thread;
+        (void)core;
+#endif
+    }
+};
+
+} // namespace mcts
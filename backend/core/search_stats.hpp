@@ -0,0 +1,98 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+namespace mcts {
+
+// Counters describing where a search spent its time, filled in by uct_node::simulate when
+// it is given a search_stats to fill (and skipped entirely, clock reads included, when not).
+//
+// Each search thread counts into its own copy, which is added to the caller's once the
+// search is over, so the counters are plain integers. Times are in nanoseconds, summed over
+// threads: in a parallel search they add up to more than elapsed_ns.
+struct search_stats
+{
+    uint64_t simulations = 0;
+    uint64_t simulations_saved = 0; // left unrun by an early stop (see early_stop)
+    uint64_t elapsed_ns = 0; // wall-clock time spent in simulate
+    uint64_t select_ns = 0; // (less the expansions done on the way)
+    uint64_t expand_ns = 0;
+    uint64_t eval_ns = 0; // rollouts, evaluation functions and batch evaluator calls
+    uint64_t backprop_ns = 0;
+    uint64_t expansions = 0; // nodes whose children were set up
+    uint64_t children = 0; // children set up by those expansions (children/expansions is the mean branching factor)
+    uint64_t nodes_built = 0; // child nodes built on first use (see uct_node::get_child)
+    uint64_t leaves = 0; // leaves reached by select
+    uint64_t depth_sum = 0; // of those leaves, below the search's root
+    uint64_t max_depth = 0;
+    uint64_t rollouts = 0;
+    uint64_t rollout_plies = 0;
+    uint64_t terminal_hits = 0; // leaves that were terminal positions
+    uint64_t non_terminal_eval_hits = 0; // leaves with an exact evaluation (see G::check_non_terminal_eval)
+    uint64_t solved_hits = 0; // other leaves that the search had proven won or lost (see uct_node::prove)
+    uint64_t transposition_hits = 0; // positions evaluated from the transposition table
+    uint64_t collisions = 0; // parallel simulations abandoned because another thread had their leaf
+    uint64_t exceptions = 0; // errors that ended a search
+
+    search_stats & operator+=(const search_stats & other) noexcept
+    {
+        simulations += other.simulations;
+        simulations_saved += other.simulations_saved;
+        elapsed_ns += other.elapsed_ns;
+        select_ns += other.select_ns;
+        expand_ns += other.expand_ns;
+        eval_ns += other.eval_ns;
+        backprop_ns += other.backprop_ns;
+        expansions += other.expansions;
+        children += other.children;
+        nodes_built += other.nodes_built;
+        leaves += other.leaves;
+        depth_sum += other.depth_sum;
+        max_depth = std::max(max_depth, other.max_depth);
+        rollouts += other.rollouts;
+        rollout_plies += other.rollout_plies;
+        terminal_hits += other.terminal_hits;
+        non_terminal_eval_hits += other.non_terminal_eval_hits;
+        solved_hits += other.solved_hits;
+        transposition_hits += other.transposition_hits;
+        collisions += other.collisions;
+        exceptions += other.exceptions;
+        return *this;
+    }
+};
+
+// Times the stretches between calls to lap for a search_stats (or, given none, does nothing).
+// Expansions are timed on their own, so the time stats records for them in the meantime is
+// left out: it is only ever counted as expand_ns.
+class stats_timer
+{
+public:
+    explicit stats_timer(const search_stats * stats) noexcept :
+        stats(stats),
+        start(stats ? clock::now() : clock::time_point()),
+        expand_ns(stats ? stats->expand_ns : 0)
+    {
+    }
+
+    // nanoseconds since construction or the previous lap (0 when disabled)
+    uint64_t lap() noexcept
+    {
+        if (!stats)
+            return 0;
+        const clock::time_point now = clock::now();
+        const uint64_t elapsed = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - start).count();
+        const uint64_t expanding = stats->expand_ns - expand_ns;
+        start = now;
+        expand_ns = stats->expand_ns;
+        return elapsed > expanding ? elapsed - expanding : 0;
+    }
+
+private:
+    typedef std::chrono::steady_clock clock;
+    const search_stats * stats;
+    clock::time_point start;
+    uint64_t expand_ns; // stats->expand_ns as of the last lap
+};
+
+} // namespace mcts
@@ -0,0 +1,183 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+#include "mcts.hpp"
+
+namespace mcts {
+
+// How self_play searches and chooses each move (see uct_node::simulate and choose_best_action)
+template <typename G>
+struct self_play_settings
+{
+    size_t sims_per_move = 1000; // added to the visits the tree kept from the previous move
+    double c = 1.0;
+    bool use_rollout = true;
+    bool eval_children = false;
+    bool use_puct = false;
+    bool use_probs = false;
+    bool decide_using_visits = true;
+    double epsilon = 0.0; // chance of playing a random move instead of the best one
+    size_t max_moves = 200; // a game still going after this many moves is recorded as unfinished
+    bool stop_on_eval = false; // ends a game at its first position with an exact evaluation (see G::check_non_terminal_eval)
+    size_t memory_budget = 0; // bytes per game's tree, 0 for no limit
+    typename G::rollout_policy policy;
+};
+
+// Self-play games, stored one after the other in flat arrays (so that a whole batch can be
+// handed over in one go, instead of a game or a move at a time)
+template <typename G>
+struct self_play_records
+{
+    // game i made moves offsets[i] to offsets[i+1]-1, so there is one more offset than games
+    std::vector<size_t> offsets;
+    // for each move, its action id, from the perspective of the player making it (so that a
+    // game is replayed by make_move_by_id(action, true))
+    std::vector<uint16_t> actions;
+    // for each move, the root's visit counts when it was chosen: G::POLICY_SIZE of them,
+    // indexed as the action ids (see uct_node::get_visit_policy)
+    std::vector<float> visits;
+    // for each game, 1 if the player who moved first won, -1 if they lost, and 0 if the game
+    // ended at max_moves (or an exact evaluation of 0)
+    std::vector<int8_t> outcomes;
+
+    size_t games() const noexcept { return outcomes.size(); }
+};
+
+// Plays games of the search against itself, each from the initial position with a tree of
+// its own, on up to threads threads at once. Games are handed out one at a time from a shared
+// counter: they vary in length far more than it costs to claim one, so a thread that finishes
+// a short game just takes the next. Every game has its own generator, seeded from rand before
+// any are played, so the games don't depend on how many threads play them.
+//
+// An evaluator (if given) is shared by all the games' searches. Once cancel is set the games
+// in progress are abandoned, and only those already finished are returned (in order).
+template <typename G>
+self_play_records<G> self_play(
+    const size_t games,
+    const self_play_settings<G> & settings,
+    const size_t threads,
+    Rand & rand,
+    batch_evaluator<G> * evaluator = NULL,
+    const std::atomic<bool> * cancel = NULL)
+{
+    struct game
+    {
+        std::vector<uint16_t> actions;
+        std::vector<float> visits;
+        int8_t outcome = 0;
+        bool finished = false;
+    };
+
+    // (a stream per game, so that a game plays the same whichever thread runs it)
+    std::vector<Rand> game_rands;
+    for (size_t i=0;i<games;++i)
+        game_rands.push_back(rand.split());
+    std::vector<game> played(games);
+
+    auto stop_requested = [&]()
+    {
+        return cancel && cancel->load(std::memory_order_relaxed);
+    };
+
+    auto play = [&](game & record, Rand & game_rand)
+    {
+        std::shared_ptr<uct_node<G>> root(new uct_node<G>());
+        root->set_memory_budget(settings.memory_budget);
+        double value=0.0; // at the end of the game, from the perspective of the player to move
+        bool decided=false;
+        size_t moves=0;
+        for (;;)
+        {
+            const G & state = root->get_state();
+            if (state.is_terminal())
+            {
+                value = state.get_terminal_eval();
+                decided = true;
+                break;
+            }
+            if (settings.stop_on_eval && state.check_non_terminal_eval(value))
+            {
+                decided = true;
+                break;
+            }
+            if (moves==settings.max_moves)
+                break;
+
+            root->simulate(settings.sims_per_move, game_rand, settings.c, settings.use_rollout, settings.eval_children, settings.use_puct, settings.use_probs,
+                1, NO_DEADLINE, cancel, NULL, settings.policy, evaluator);
+            if (stop_requested())
+                return;
+
+            record.visits.resize(record.visits.size() + G::POLICY_SIZE);
+            root->get_visit_policy(record.visits.data() + record.visits.size() - G::POLICY_SIZE);
+            root = root->make_move(root->select_best_action(game_rand, settings.epsilon, settings.decide_using_visits));
+            record.actions.push_back((uint16_t)root->get_state().get_action_id(true));
+            ++moves;
+        }
+
+        // (the first player is to move after an even number of moves)
+        if (decided && value!=0.0)
+            record.outcome = (value>0.0) == (moves%2==0) ? 1 : -1;
+        record.finished = true;
+    };
+
+    std::atomic<size_t> next_game(0);
+    std::atomic<bool> worker_failed(false);
+    std::exception_ptr worker_error;
+    std::mutex worker_error_mutex;
+
+    auto worker = [&]()
+    {
+        try
+        {
+            for (;;)
+            {
+                if (worker_failed.load(std::memory_order_relaxed) || stop_requested())
+                    return;
+                const size_t i = next_game.fetch_add(1, std::memory_order_relaxed);
+                if (i >= games)
+                    return;
+                play(played[i], game_rands[i]);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(worker_error_mutex);
+            if (!worker_error)
+                worker_error = std::current_exception();
+            worker_failed.store(true, std::memory_order_relaxed); // stop the other workers
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t t=1;t<std::min(threads, games);++t)
+        workers.emplace_back(worker);
+    worker(); // calling thread plays its share of the games
+    for (auto & w : workers)
+        w.join();
+    if (worker_error)
+        std::rethrow_exception(worker_error);
+
+    self_play_records<G> records;
+    records.offsets.push_back(0);
+    for (game & record : played)
+    {
+        if (!record.finished)
+            continue;
+        records.actions.insert(records.actions.end(), record.actions.begin(), record.actions.end());
+        records.visits.insert(records.visits.end(), record.visits.begin(), record.visits.end());
+        records.outcomes.push_back(record.outcome);
+        records.offsets.push_back(records.actions.size());
+        // (each game's copy goes as soon as it's been added)
+        std::vector<uint16_t>().swap(record.actions);
+        std::vector<float>().swap(record.visits);
+    }
+    return records;
+}
+
+} // namespace mcts
@@ -4,7 +4,6 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <ctime>
 #include <memory>
 #include "conio.h"
 #include <random>
@@ -22,25 +21,7 @@ int main()
     }*/
 
     
-    // rollout timing loop
-    {
-        corridors::board sb;
-        mcts::Rand rand(42);
-        size_t evals = 10000;
-        double sum=0;
-        std::cout << "Pure rollouts:" << std::endl;
-        clock_t begin = clock();
-        for (size_t i = 0;i<evals;++i)
-            sum += mcts::rollout<corridors::board>()(sb,rand);
-        clock_t end = clock();
-        double elapsed_secs = double(end - begin) / CLOCKS_PER_SEC;
-        std::cout << "It took " << elapsed_secs/(double)evals << " per rollout, or " << (double)evals / elapsed_secs << " per second."<< std::endl;
-        std::cout << "Mean value: " << sum / (double) evals << std::endl;
-        std::cout << std::endl;
-    }
-
-    
-    // self-play testing loop
+    // self-play testing loop (for timings, see the benchmarks in bench.cpp)
     {   
         // hyperparameters
         mcts::Rand rand(66); // 63 segfaults; 66 infinite cycle at end 
@@ -52,6 +33,7 @@ int main()
         bool use_puct = false;
         bool use_probs = false;
         bool decide_using_visits = true;
+        size_t threads = 1; // >1 runs a tree-parallel search
         bool terminate_early = false; // true means we terminate when there's a non-terminal eval
         bool getch_each_move = false; // true means pauses for user input
 
@@ -59,16 +41,9 @@ int main()
         try {
 
             std::shared_ptr<mcts::uct_node<corridors::board>> my_mcts(new mcts::uct_node<corridors::board>());
-            clock_t begin, end;
-            double elapsed_secs; // eval
             size_t move_number = 0;
             std::cout << "***Self play simulation***" << std::endl;
-            begin = clock();
-            my_mcts->simulate(initial_sims,rand,c,use_rollout,eval_children,use_puct,use_probs);
-            end = clock();
-            elapsed_secs = double(end - begin) / CLOCKS_PER_SEC;
-            std::cout << "Initial sims took " << elapsed_secs/(double)initial_sims << " per simulation, or " << (double)initial_sims / elapsed_secs << " per second."<< std::endl;
-            std::cout << std::endl;
+            my_mcts->simulate(initial_sims,rand,c,use_rollout,eval_children,use_puct,use_probs,threads);
 
             bool initial_heros_turn = true;
             do
@@ -83,11 +58,7 @@ int main()
                 std::string pre_sim_equity = my_mcts->is_evaluated()
                     ? lexical_cast<std::string>(my_mcts->get_equity())
                     : "NA";
-                begin = clock();
-                my_mcts->simulate(per_move_sims,rand,c,use_rollout,eval_children,use_puct,use_probs);
-                end = clock();
-                elapsed_secs = double(end - begin) / CLOCKS_PER_SEC;
-                std::cout << "Move sims took " << elapsed_secs/(double)per_move_sims << " per simulation, or " << (double)per_move_sims / elapsed_secs << " per second."<< std::endl;
+                my_mcts->simulate(per_move_sims,rand,c,use_rollout,eval_children,use_puct,use_probs,threads);
                 std::string post_sim_equity = my_mcts->is_evaluated()
                     ? lexical_cast<std::string>(my_mcts->get_equity())
                     : "NA";
@@ -0,0 +1,152 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcts {
+
+// Fixed-size table of search statistics keyed by position hash (G::get_hash()), shared by
+// every node that reaches the same position -- whatever the move order that got there.
+//
+// Every backprop adds its value to the entry of each position it passes through (bar the
+// search's root, and proven positions, whose values are settled), and a newly reached
+// position takes the equity already recorded for it as its evaluation instead of running a
+// fresh rollout, along with up to MAX_REUSED_VISITS of the visits behind it (see
+// uct_node::try_quick_eval). The tree itself stays a tree: only the statistics are shared.
+//
+// The table is split into cache-line sized buckets of two entries, each with its own lock.
+// When both entries of a bucket are taken, the one that was last touched in an older
+// search (see new_search) goes first, then the one with fewer visits.
+class transposition_table
+{
+public:
+    // The most visits a newly reached position takes over from its entry. A transposition
+    // reached by another move order can be worth more than one rollout, but it wasn't searched
+    // from here, so it shouldn't outweigh the children searched from here for long
+    constexpr static size_t MAX_REUSED_VISITS = 8;
+
+    // megabytes is rounded down to a power of two number of buckets (minimum 1)
+    explicit transposition_table(const size_t megabytes) :
+        buckets(get_num_buckets(megabytes)),
+        mask(buckets.size()-1),
+        generation(0)
+    {
+    }
+
+    // looks up the mean equity recorded for a position (from the perspective of the player to
+    // move), and the number of visits it's the mean of
+    bool probe(const uint64_t key, double & equity, size_t & visits) const
+    {
+        bucket & b = get_bucket(key);
+        b.lock();
+        bool found=false;
+        for (size_t i=0;i<ENTRIES_PER_BUCKET;++i)
+        {
+            if (b.visits[i]>0 && b.key[i]==key)
+            {
+                equity = b.Q_sum[i] / (double)b.visits[i];
+                visits = (size_t)b.visits[i];
+                found=true;
+                break;
+            }
+        }
+        b.unlock();
+        return found;
+    }
+
+    // records visits more visits to a position, worth value each
+    void update(const uint64_t key, const double value, const size_t visits = 1)
+    {
+        bucket & b = get_bucket(key);
+        const unsigned char current_generation = generation.load(std::memory_order_relaxed);
+        b.lock();
+        size_t slot = ENTRIES_PER_BUCKET;
+        for (size_t i=0;i<ENTRIES_PER_BUCKET;++i)
+            if (b.visits[i]>0 && b.key[i]==key)
+                slot = i;
+        if (slot==ENTRIES_PER_BUCKET)
+        {
+            // replace the least valuable entry
+            slot = 0;
+            for (size_t i=1;i<ENTRIES_PER_BUCKET;++i)
+                if (less_valuable(b, i, slot, current_generation))
+                    slot = i;
+            b.key[slot] = key;
+            b.Q_sum[slot] = 0;
+            b.visits[slot] = 0;
+        }
+        b.Q_sum[slot] += value * (double)visits;
+        b.visits[slot] += visits;
+        b.generation[slot] = current_generation;
+        b.unlock();
+    }
+
+    // marks everything currently in the table as belonging to an older search (typically
+    // called once a move has been made), so that it is replaced first
+    void new_search() noexcept
+    {
+        generation.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const noexcept
+    {
+        return buckets.size()*ENTRIES_PER_BUCKET;
+    }
+
+private:
+    constexpr static size_t ENTRIES_PER_BUCKET = 2;
+
+    struct alignas(64) bucket
+    {
+        std::atomic_flag locked = ATOMIC_FLAG_INIT;
+        unsigned char generation[ENTRIES_PER_BUCKET] = {};
+        uint64_t key[ENTRIES_PER_BUCKET] = {};
+        double Q_sum[ENTRIES_PER_BUCKET] = {};
+        uint64_t visits[ENTRIES_PER_BUCKET] = {}; // 0 means the entry is empty
+
+        void lock() noexcept
+        {
+            while (locked.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+
+        void unlock() noexcept
+        {
+            locked.clear(std::memory_order_release);
+        }
+    };
+
+    mutable std::vector<bucket> buckets;
+    size_t mask;
+    std::atomic<unsigned char> generation;
+
+    static size_t get_num_buckets(const size_t megabytes) noexcept
+    {
+        size_t num_buckets = 1;
+        while (num_buckets*2*sizeof(bucket) <= megabytes*(size_t(1) << 20))
+            num_buckets *= 2;
+        return num_buckets;
+    }
+
+    bucket & get_bucket(const uint64_t key) const noexcept
+    {
+        // mix the bits first, in case a game's hash is weak in the low bits
+        uint64_t h = key * 0x9E3779B97F4A7C15ull;
+        return buckets[(h >> 32) & mask];
+    }
+
+    static bool less_valuable(const bucket & b, const size_t i, const size_t j, const unsigned char current_generation) noexcept
+    {
+        if (b.visits[i]==0 || b.visits[j]==0)
+            return b.visits[i]==0;
+        const bool i_stale = b.generation[i]!=current_generation;
+        const bool j_stale = b.generation[j]!=current_generation;
+        if (i_stale!=j_stale)
+            return i_stale;
+        return b.visits[i] < b.visits[j];
+    }
+};
+
+} // namespace mcts
@@ -0,0 +1,172 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <type_traits>
+#include <limits>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "mapped_file.hpp"
+
+namespace mcts {
+
+// A search tree (or subtree) flattened into one contiguous buffer, so that it can be written
+// to a file and brought back with a single mmap. Nothing in it is a pointer: the statistics
+// of every node are held in parallel arrays, one entry per node, and a node's children are
+// the entries first_child .. first_child+child_count-1 (entries are in breadth-first order,
+// so a node's children always come after it). Entry 0 is the root, and the root's position
+// is the only one stored: every other position is its parent's, with action_id played (from
+// the perspective of the player making it), just as uct_node keeps them.
+//
+// An image can be read where it lies (see the accessors) or turned back into a tree by
+// uct_node::load. Images are in the byte order of the machine that wrote them, and are only
+// read by builds with the same G (see header).
+template <typename G>
+class tree_image
+{
+    static_assert(std::is_trivially_copyable<G>::value, "positions are stored as their bytes");
+public:
+    // entry flags
+    enum : uint8_t
+    {
+        EXPANDED = 1, // the node's children were set up (child_count of them, possibly none)
+        ALL_CHILDREN_EVALUATED = 2,
+        PROVEN_WIN = 4, // the position is won for the player to move there (see uct_node::prove)
+        PROVEN_LOSS = 8
+    };
+
+    struct header
+    {
+        format_header<G> format;
+        uint64_t entries;
+    };
+
+    constexpr static uint32_t VERSION = 2;
+
+    // the layout of an image of the given number of entries. Each array starts on an 8 byte
+    // boundary, in the order below
+    struct layout
+    {
+        size_t state, visit_count, Q_sum, eval_Q, prior, first_child, child_count, action_id, flags, bytes;
+
+        explicit layout(const uint64_t entries) noexcept
+        {
+            const size_t n = (size_t)entries;
+            array_layout arrays(sizeof(header));
+            state = arrays.place(sizeof(G));
+            visit_count = arrays.place(n*sizeof(uint64_t));
+            Q_sum = arrays.place(n*sizeof(double));
+            eval_Q = arrays.place(n*sizeof(double));
+            prior = arrays.place(n*sizeof(double));
+            first_child = arrays.place(n*sizeof(uint32_t));
+            child_count = arrays.place(n*sizeof(uint16_t));
+            action_id = arrays.place(n*sizeof(uint16_t));
+            flags = arrays.place(n*sizeof(uint8_t));
+            bytes = arrays.end();
+        }
+    };
+
+    // a zeroed buffer of the right size for an image of entries entries, with its header and
+    // root position filled in. The writer fills in the arrays (at the offsets of layout)
+    static std::vector<char> create(const G & root_state, const uint64_t entries)
+    {
+        const layout at(entries);
+        std::vector<char> bytes(at.bytes, 0);
+        header h;
+        h.format = format_header<G>(MAGIC, VERSION);
+        h.entries = entries;
+        std::memcpy(bytes.data(), &h, sizeof(h));
+        std::memcpy(bytes.data() + at.state, &root_state, sizeof(G));
+        return bytes;
+    }
+
+    // takes over an image held in memory
+    explicit tree_image(std::vector<char> && bytes) :
+        file(std::move(bytes))
+    {
+        check();
+    }
+
+    // maps an image written by write
+    static tree_image open(const std::string & path)
+    {
+        return tree_image(mapped_file::open(path, "tree image"));
+    }
+
+    // writes bytes (as made by uct_node::save) to path, replacing the file
+    static void write(const std::string & path, const std::vector<char> & bytes)
+    {
+        mapped_file::write(path, bytes, "tree image");
+    }
+
+    size_t entries() const noexcept { return (size_t)get_header().entries; }
+    size_t bytes() const noexcept { return file.size(); }
+    G root_state() const noexcept { return file.read<G>(at.state); }
+
+    uint64_t visit_count(const size_t i) const noexcept { return file.read<uint64_t>(at.visit_count, i); }
+    double Q_sum(const size_t i) const noexcept { return file.read<double>(at.Q_sum, i); }
+    double eval_Q(const size_t i) const noexcept { return file.read<double>(at.eval_Q, i); }
+    double prior(const size_t i) const noexcept { return file.read<double>(at.prior, i); }
+    size_t first_child(const size_t i) const noexcept { return file.read<uint32_t>(at.first_child, i); }
+    size_t child_count(const size_t i) const noexcept { return file.read<uint16_t>(at.child_count, i); }
+    size_t action_id(const size_t i) const noexcept { return file.read<uint16_t>(at.action_id, i); }
+    uint8_t flags(const size_t i) const noexcept { return file.read<uint8_t>(at.flags, i); }
+
+    // the child of entry i reached by action_id (from the perspective of the player making
+    // it), or 0 (never a child) if it has none
+    size_t find_child(const size_t i, const size_t action) const noexcept
+    {
+        const size_t first = first_child(i);
+        for (size_t j=first;j<first+child_count(i);++j)
+            if (action_id(j)==action)
+                return j;
+        return 0;
+    }
+
+private:
+    constexpr static char MAGIC[8] = {'M','C','T','S','T','R','E','E'};
+
+    mapped_file file;
+    layout at{0};
+
+    explicit tree_image(mapped_file && _file) :
+        file(std::move(_file))
+    {
+        check();
+    }
+
+    header get_header() const noexcept
+    {
+        return file.read<header>(0);
+    }
+
+    // rejects anything that isn't a well formed image for this G, so that the accessors
+    // never read out of bounds, every child range is within the image and the root's
+    // position is one G can play from (see G::is_valid)
+    void check()
+    {
+        if (file.size() < sizeof(header))
+            throw std::string("Error: tree image is truncated");
+        const header h = get_header();
+        h.format.check(MAGIC, VERSION, "tree image");
+        if (h.entries==0 || h.entries > std::numeric_limits<uint32_t>::max())
+            throw std::string("Error: tree image has a bad entry count");
+        at = layout(h.entries);
+        if (file.size() < at.bytes)
+            throw std::string("Error: tree image is truncated");
+        if (!root_state().is_valid())
+            throw std::string("Error: tree image is corrupt");
+        const size_t n = (size_t)h.entries;
+        for (size_t i=0;i<n;++i)
+        {
+            const size_t count = child_count(i);
+            if (count>0 && (first_child(i)<=i || first_child(i)+count > n))
+                throw std::string("Error: tree image is corrupt");
+        }
+    }
+};
+
+template <typename G>
+constexpr char tree_image<G>::MAGIC[8];
+
+} // namespace mcts
@@ -6,7 +6,6 @@ allowing proper integration with FastAPI and other async frameworks.
 """
 
 import asyncio
-import threading
 import time
 from dataclasses import dataclass
 from enum import Enum, auto
@@ -28,7 +27,7 @@ from typing import (
 from types import TracebackType
 import functools
 
-from pydantic import BaseModel, Field, field_validator
+from pydantic import BaseModel, Field, ValidationInfo, field_validator
 from corridors import _corridors_mcts
 
 # Type variables for decorator typing
@@ -104,6 +103,17 @@ class MCTSConfig(BaseModel):
     use_puct: bool = False
     use_probs: bool = False
     decide_using_visits: bool = True
+    threads: int = 1
+    parallelism: str = "tree"  # how threads share a search: "tree", "root" or "leaf"
+    transposition_table_mb: int = 0  # 0 disables the transposition table
+    rollout_policy: str = "random"  # "random", "shortest_path" or "smart_walls"
+    rollout_path_probability: float = 0.5  # chance of a shortest-path step (heuristic policies)
+    background_reclaim: bool = False  # free discarded subtrees on a background thread
+    memory_budget_mb: int = 0  # search tree size limit; 0 for no limit
+    collect_stats: bool = False  # count where searches spend their time
+    early_stop: float = 0.0  # stop once the best move is settled; 0 off, 1 certain
+    board_size: int = 9  # 9 (10 walls each), or 7 (6 walls) or 5 (3 walls)
+    priority: int = 0  # on a shared EnginePool, higher priority searches run first
 
     @field_validator("c")
     @classmethod
@@ -113,7 +123,9 @@ class MCTSConfig(BaseModel):
             raise ValueError("c must be greater than 0")
         return v
 
-    @field_validator("seed", "min_simulations", "max_simulations", "sim_increment")
+    @field_validator(
+        "seed", "min_simulations", "max_simulations", "sim_increment", "threads"
+    )
     @classmethod
     def validate_positive_int(cls, v: int) -> int:
         """Ensure positive integers."""
@@ -121,6 +133,58 @@ class MCTSConfig(BaseModel):
             raise ValueError("Value must be >= 1")
         return v
 
+    @field_validator("transposition_table_mb", "memory_budget_mb")
+    @classmethod
+    def validate_non_negative_int(cls, v: int) -> int:
+        """Ensure non-negative integers."""
+        if v < 0:
+            raise ValueError("Value must be >= 0")
+        return v
+
+    @field_validator("early_stop")
+    @classmethod
+    def validate_early_stop(cls, v: float, info: ValidationInfo) -> float:
+        """Ensure early_stop is 0 (off), or at least 1 when deciding by visits."""
+        if v != 0.0 and v < 1.0:
+            raise ValueError("early_stop must be 0 (off) or at least 1")
+        if v != 0.0 and not info.data.get("decide_using_visits", True):
+            raise ValueError("early_stop needs decide_using_visits")
+        return v
+
+    @field_validator("board_size")
+    @classmethod
+    def validate_board_size(cls, v: int) -> int:
+        """Ensure the board size is one the engine is built for."""
+        if v not in (5, 7, 9):
+            raise ValueError("board_size must be 5, 7 or 9")
+        return v
+
+    @field_validator("rollout_policy")
+    @classmethod
+    def validate_rollout_policy(cls, v: str) -> str:
+        """Ensure the rollout policy is one the engine knows."""
+        if v not in ("random", "shortest_path", "smart_walls"):
+            raise ValueError(
+                "rollout_policy must be 'random', 'shortest_path' or 'smart_walls'"
+            )
+        return v
+
+    @field_validator("parallelism")
+    @classmethod
+    def validate_parallelism(cls, v: str) -> str:
+        """Ensure the parallelism is one the engine knows."""
+        if v not in ("tree", "root", "leaf"):
+            raise ValueError("parallelism must be 'tree', 'root' or 'leaf'")
+        return v
+
+    @field_validator("rollout_path_probability")
+    @classmethod
+    def validate_probability(cls, v: float) -> float:
+        """Ensure 0 <= v <= 1."""
+        if not 0.0 <= v <= 1.0:
+            raise ValueError("Value must be between 0 and 1")
+        return v
+
     @field_validator("max_simulations")
     @classmethod
     def validate_max_simulations(cls, v: int) -> int:
@@ -161,6 +225,17 @@ class MCTSProtocol(Protocol):
     def run_simulations(self, n: int) -> None:
         ...
 
+    def run_for(self, milliseconds: int) -> int:
+        ...
+
+    def run_until(
+        self,
+        n: int,
+        milliseconds: Optional[float] = None,
+        cancel: Optional["_corridors_mcts.cancel_token"] = None,
+    ) -> int:
+        ...
+
     def make_move(self, action: str, flip: bool = False) -> None:
         ...
 
@@ -176,6 +251,36 @@ class MCTSProtocol(Protocol):
     def get_visit_count(self) -> int:
         ...
 
+    def get_tree_reuse(self) -> Tuple[int, int]:
+        ...
+
+    def get_memory_usage(self) -> Tuple[int, int]:
+        ...
+
+    def get_search_stats(self) -> Dict[str, float]:
+        ...
+
+    def reset_search_stats(self) -> None:
+        ...
+
+    def start_pondering(self, max_simulations: int = 1000000) -> None:
+        ...
+
+    def stop_pondering(self) -> int:
+        ...
+
+    def save_tree(self, path: str) -> None:
+        ...
+
+    def load_tree(self, path: str) -> None:
+        ...
+
+    def set_opening_book(self, path: str) -> bool:
+        ...
+
+    def get_book_moves(self, flip: bool = False) -> List[Tuple[int, float, str]]:
+        ...
+
     def display(self, flip: bool = False) -> str:
         ...
 
@@ -197,12 +302,24 @@ class AsyncCorridorsMCTS:
     def __init__(
         self,
         config: MCTSConfig,
+        pool: Optional["_corridors_mcts.EnginePool"] = None,
     ) -> None:
         # Store validated configuration
         self._config = config
 
+        # Searches run on the shared pool's threads when given one, instead of
+        # taking an executor thread each
+        self._pool = pool
+
         # Create C++ instance with validated configuration
-        self._impl: MCTSProtocol = _corridors_mcts._corridors_mcts(
+        engine_class: Type[_corridors_mcts._corridors_mcts] = (
+            _corridors_mcts._corridors_mcts
+        )
+        if self._config.board_size == 7:
+            engine_class = _corridors_mcts._corridors_mcts_7x7
+        elif self._config.board_size == 5:
+            engine_class = _corridors_mcts._corridors_mcts_5x5
+        self._engine = engine_class(
             self._config.c,
             self._config.seed,
             self._config.use_rollout,
@@ -210,10 +327,21 @@ class AsyncCorridorsMCTS:
             self._config.use_puct,
             self._config.use_probs,
             self._config.decide_using_visits,
+            self._config.threads,
+            self._config.transposition_table_mb,
+            self._config.rollout_policy,
+            self._config.rollout_path_probability,
+            self._config.background_reclaim,
+            self._config.memory_budget_mb,
+            self._config.collect_stats,
+            self._config.parallelism,
+            self._config.early_stop,
         )
+        self._impl: MCTSProtocol = self._engine
 
-        # Cancellation support (immutable)
-        self._cancel_flag = threading.Event()
+        # Cancellation support (immutable). The native token is checked inside the
+        # C++ search loop, which runs with the GIL released.
+        self._cancel_flag = _corridors_mcts.cancel_token()
         self._current_task: Optional[
             Union[asyncio.Task[int], asyncio.Future[int]]
         ] = None
@@ -278,30 +406,62 @@ class AsyncCorridorsMCTS:
                 # Already released or in error state, transition to idle
                 self._operation_state = OperationState.idle()
 
-    def _run_simulations_batch(self, n: int, batch_size: int = 100) -> int:
-        """Functional simulation runner that processes in batches."""
-        simulations_completed = 0
+    def _run_simulations_native(self, n: int, timeout: Optional[float]) -> int:
+        """Run simulations in C++ until done, timed out or cancelled."""
+        try:
+            return self._impl.run_until(
+                n, timeout * 1000.0 if timeout else None, self._cancel_flag
+            )
+        except Exception:
+            return 0
 
-        while simulations_completed < n and not self._cancel_flag.is_set():
-            current_batch = min(batch_size, n - simulations_completed)
-            try:
-                self._impl.run_simulations(current_batch)
-                simulations_completed += current_batch
-            except Exception:
-                break
+    async def _run_simulations_on_pool(
+        self, pool: "_corridors_mcts.EnginePool", n: int, timeout: Optional[float]
+    ) -> int:
+        """Queue the search on the shared pool and await its callback."""
+        loop = asyncio.get_running_loop()
+        done: asyncio.Future[int] = loop.create_future()
 
-        return simulations_completed
+        def resolve(completed: int) -> None:
+            if not done.done():
+                done.set_result(completed)
+
+        def finished(completed: int, error: Optional[str]) -> None:
+            # Called on one of the pool's threads
+            try:
+                loop.call_soon_threadsafe(resolve, 0 if error else completed)
+            except RuntimeError:
+                pass  # the loop has been closed, so nobody is waiting
+
+        pool.search(
+            self._engine,
+            n,
+            self._config.priority,
+            timeout * 1000.0 if timeout else None,
+            finished,
+        )
+        try:
+            return await done
+        except asyncio.CancelledError:
+            pool.cancel(self._engine)
+            raise
 
     async def _run_simulations_with_timeout(
         self, n: int, timeout: Optional[float]
     ) -> int:
         """Functional simulation runner with timeout and cancellation."""
-        # Execute with timeout handling using asyncio's default thread pool
+        if self._pool is not None:
+            return await self._run_simulations_on_pool(self._pool, n, timeout)
+
+        # Execute with timeout handling using asyncio's default thread pool.
+        # The native search enforces the timeout itself; wait_for is a backstop.
         loop = asyncio.get_event_loop()
-        task = loop.run_in_executor(None, lambda: self._run_simulations_batch(n))
+        task = loop.run_in_executor(
+            None, lambda: self._run_simulations_native(n, timeout)
+        )
 
         try:
-            return await asyncio.wait_for(task, timeout) if timeout else await task
+            return await asyncio.wait_for(task, timeout + 1.0) if timeout else await task
         except asyncio.TimeoutError:
             # Functional cancellation - set flag and wait for graceful completion
             self._cancel_flag.set()
@@ -457,6 +617,131 @@ class AsyncCorridorsMCTS:
         finally:
             await self._release_operation_lock()
 
+    async def get_tree_reuse_async(self) -> Tuple[int, int]:
+        """Get (visits kept, visits discarded) by the last move asynchronously."""
+        await self._acquire_operation_lock("get_tree_reuse")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            return await loop.run_in_executor(None, self._impl.get_tree_reuse)
+        finally:
+            await self._release_operation_lock()
+
+    async def get_memory_usage_async(self) -> Tuple[int, int]:
+        """Get (bytes in use, bytes reserved) by the search tree asynchronously."""
+        await self._acquire_operation_lock("get_memory_usage")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            return await loop.run_in_executor(None, self._impl.get_memory_usage)
+        finally:
+            await self._release_operation_lock()
+
+    async def get_search_stats_async(self) -> Dict[str, float]:
+        """Get the search counters collected since the last reset asynchronously."""
+        await self._acquire_operation_lock("get_search_stats")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            return await loop.run_in_executor(None, self._impl.get_search_stats)
+        finally:
+            await self._release_operation_lock()
+
+    async def reset_search_stats_async(self) -> None:
+        """Zero the search counters asynchronously."""
+        await self._acquire_operation_lock("reset_search_stats")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            await loop.run_in_executor(None, self._impl.reset_search_stats)
+        finally:
+            await self._release_operation_lock()
+
+    async def start_pondering_async(self, max_simulations: int = 1000000) -> None:
+        """Keep searching the current position in the background until the next move."""
+        await self._acquire_operation_lock("start_pondering")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            await loop.run_in_executor(
+                None, lambda: self._impl.start_pondering(max_simulations)
+            )
+        finally:
+            await self._release_operation_lock()
+
+    async def stop_pondering_async(self) -> int:
+        """Stop the background search, returning how many simulations it ran."""
+        await self._acquire_operation_lock("stop_pondering")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            return await loop.run_in_executor(None, self._impl.stop_pondering)
+        finally:
+            await self._release_operation_lock()
+
+    async def save_tree_async(self, path: str) -> None:
+        """Write the search tree to a file, for load_tree_async to pick up later."""
+        await self._acquire_operation_lock("save_tree")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            await loop.run_in_executor(None, lambda: self._impl.save_tree(path))
+        finally:
+            await self._release_operation_lock()
+
+    async def load_tree_async(self, path: str) -> None:
+        """Replace the search tree with one written by save_tree_async."""
+        await self._acquire_operation_lock("load_tree")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            await loop.run_in_executor(None, lambda: self._impl.load_tree(path))
+        finally:
+            await self._release_operation_lock()
+
+    async def set_opening_book_async(self, path: str) -> bool:
+        """Seed this and every later position found in an opening book from it."""
+        await self._acquire_operation_lock("set_opening_book")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            loop = asyncio.get_event_loop()
+            return await loop.run_in_executor(
+                None, lambda: self._impl.set_opening_book(path)
+            )
+        finally:
+            await self._release_operation_lock()
+
+    async def get_book_moves_async(
+        self, flip: bool = False
+    ) -> List[Tuple[int, float, str]]:
+        """Get the opening book's moves for the current position."""
+        await self._acquire_operation_lock("get_book_moves")
+        try:
+            if self._closed:
+                raise RuntimeError("AsyncCorridorsMCTS has been closed")
+
+            return self._impl.get_book_moves(flip)
+        finally:
+            await self._release_operation_lock()
+
     async def display_async(self, flip: bool = False) -> str:
         """Get board display asynchronously."""
         await self._acquire_operation_lock("display")
@@ -511,6 +796,8 @@ class AsyncCorridorsMCTS:
     def cancel_simulations(self) -> None:
         """Cancel any currently running simulations."""
         self._cancel_flag.set()
+        if self._pool is not None:
+            self._pool.cancel(self._engine)
         if self._current_task and not self._current_task.done():
             self._current_task.cancel()
 
@@ -546,7 +833,8 @@ class MCTSRegistry:
     with per-instance locks to prevent race conditions.
     """
 
-    def __init__(self) -> None:
+    def __init__(self, pool: Optional["_corridors_mcts.EnginePool"] = None) -> None:
+        self._pool = pool  # shared by the searches of every instance, if given
         self._instances: Dict[str, AsyncCorridorsMCTS] = {}
         self._registry_lock = asyncio.Lock()  # Protects registry dict operations
         self._instance_locks: Dict[str, asyncio.Lock] = {}  # Per-instance API locks
@@ -579,7 +867,7 @@ class MCTSRegistry:
         async with self._registry_lock:
             if game_id not in self._instances:
                 # Create new instance with config
-                self._instances[game_id] = AsyncCorridorsMCTS(config)
+                self._instances[game_id] = AsyncCorridorsMCTS(config, self._pool)
 
                 # Create corresponding API lock
                 self._instance_locks[game_id] = asyncio.Lock()
@@ -1,6 +1,20 @@
 """Stub file for the C++ _corridors_mcts extension module."""
 
-from typing import List, Optional, Tuple
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+import numpy as np
+import numpy.typing as npt
+
+# (values, policies) for a batch of encoded positions
+EvaluatorResult = Tuple[npt.NDArray[np.float32], npt.NDArray[np.float32]]
+
+class cancel_token:
+    """Cancellation flag checked inside the native search loop."""
+
+    def __init__(self) -> None: ...
+    def set(self) -> None: ...
+    def clear(self) -> None: ...
+    def is_set(self) -> bool: ...
 
 class _corridors_mcts:
     """C++ MCTS implementation."""
@@ -14,15 +28,107 @@ class _corridors_mcts:
         use_puct: bool,
         use_probs: bool,
         decide_using_visits: bool,
+        threads: int = 1,
+        transposition_table_mb: int = 0,
+        rollout_policy: str = "random",
+        rollout_path_probability: float = 0.5,
+        background_reclaim: bool = False,
+        memory_budget_mb: int = 0,
+        collect_stats: bool = False,
+        parallelism: str = "tree",
+        early_stop: float = 0.0,
     ) -> None: ...
     def run_simulations(self, n: int) -> None: ...
+    def run_for(self, milliseconds: int) -> int: ...
+    def run_until(
+        self,
+        n: int,
+        milliseconds: Optional[float] = None,
+        cancel: Optional[cancel_token] = None,
+    ) -> int: ...
     def make_move(self, action: str, flip: bool = False) -> None: ...
+    def make_move_id(self, action_id: int, flip: bool = False) -> None: ...
+    def get_legal_moves(self, flip: bool = False) -> List[str]: ...
+    def get_legal_action_ids(self, flip: bool = False) -> List[int]: ...
     def get_sorted_actions(
         self, flip: bool = False
     ) -> List[Tuple[int, float, str]]: ...
+    def get_sorted_action_ids(
+        self, flip: bool = False
+    ) -> List[Tuple[int, float, int]]: ...
+    @staticmethod
+    def action_id_to_text(action_id: int) -> str: ...
+    @staticmethod
+    def action_text_to_id(action: str) -> int: ...
     def choose_best_action(self, epsilon: float = 0.0) -> str: ...
     def get_evaluation(self) -> Optional[float]: ...
+    def get_proven_result(self) -> Optional[int]: ...
+    def to_planes(self) -> npt.NDArray[np.float32]: ...
+    def get_visit_policy(self) -> npt.NDArray[np.float32]: ...
+    def set_evaluator(
+        self,
+        evaluate: Callable[[npt.NDArray[np.float32]], EvaluatorResult],
+        batch_size: int = 16,
+    ) -> None: ...
+    def clear_evaluator(self) -> None: ...
     def get_visit_count(self) -> int: ...
+    def self_play(
+        self,
+        num_games: int,
+        sims_per_move: int,
+        threads: int = 1,
+        epsilon: float = 0.0,
+        max_moves: int = 200,
+        stop_on_eval: bool = False,
+        cancel: Optional[cancel_token] = None,
+    ) -> Dict[str, npt.NDArray[Any]]: ...
+    def start_pondering(self, max_simulations: int = 1000000) -> None: ...
+    def stop_pondering(self) -> int: ...
+    def is_pondering(self) -> bool: ...
+    def save_tree(self, path: str) -> None: ...
+    def load_tree(self, path: str) -> None: ...
+    def save_tree_bytes(self) -> bytes: ...
+    def load_tree_bytes(self, data: bytes) -> None: ...
+    @staticmethod
+    def build_opening_book(
+        tree_paths: List[str], path: str, min_visits: int = 1000, max_depth: int = 8
+    ) -> int: ...
+    def set_opening_book(self, path: str) -> bool: ...
+    def clear_opening_book(self) -> None: ...
+    def get_book_moves(self, flip: bool = False) -> List[Tuple[int, float, str]]: ...
+    def get_tree_reuse(self) -> Tuple[int, int]: ...
+    def get_memory_usage(self) -> Tuple[int, int]: ...
+    def get_search_stats(self) -> Dict[str, float]: ...
+    def reset_search_stats(self) -> None: ...
+    def wait_for_reclaim(self) -> None: ...
     def display(self, flip: bool = False) -> str: ...
     def reset_to_initial_state(self) -> None: ...
     def is_terminal(self) -> bool: ...
+
+# (not subclasses at runtime: each board size is a class of its own, with the same
+# methods, and EnginePool takes any of them)
+class _corridors_mcts_7x7(_corridors_mcts):
+    """C++ MCTS implementation on a 7x7 board, with 6 walls each."""
+
+class _corridors_mcts_5x5(_corridors_mcts):
+    """C++ MCTS implementation on a 5x5 board, with 3 walls each."""
+
+class EnginePool:
+    """Fixed set of threads shared by the searches of many engines."""
+
+    def __init__(
+        self, threads: int = 0, quantum: int = 64, pin_threads: bool = False
+    ) -> None: ...
+    def search(
+        self,
+        engine: _corridors_mcts,
+        n: int,
+        priority: int = 0,
+        milliseconds: Optional[float] = None,
+        callback: Optional[Callable[[int, Optional[str]], None]] = None,
+    ) -> None: ...
+    def cancel(self, engine: _corridors_mcts) -> None: ...
+    def wait(self, engine: _corridors_mcts) -> None: ...
+    def get_threads(self) -> int: ...
+    def get_quantum(self) -> int: ...
+    def get_searches(self) -> int: ...
@@ -20,11 +20,17 @@ These tests verify the core board logic implemented in C++:
 """
 
 
+import threading
+import time
+from pathlib import Path
+from typing import Callable, List, Optional, Tuple, Type
+
+import numpy as np
 import pytest
 
-from tests.conftest import MCTSParams, MCTSTestHelper
+from tests.conftest import EngineFactory, MCTSParams, MCTSTestHelper
 
-from corridors import AsyncCorridorsMCTS
+from corridors import AsyncCorridorsMCTS, _corridors_mcts
 from corridors.async_mcts import MCTSConfig
 
 
@@ -475,3 +481,949 @@ class TestGameFlow:
             assert moves_made > 0
             # Game should eventually end
             assert moves_made < max_moves
+
+
+@cpp
+@mcts
+class TestNativeSearchBudget:
+    """Test the time-budgeted and cancellable search entry points."""
+
+    def test_run_for_respects_time_budget(self, make_engine: EngineFactory) -> None:
+        """Test run_for stops close to its deadline and reports its work."""
+        engine = make_engine()
+        start = time.monotonic()
+        completed = engine.run_for(200)
+        elapsed = time.monotonic() - start
+
+        assert completed > 0
+        assert elapsed < 2.0
+        # One extra visit for the root's own evaluation
+        assert engine.get_visit_count() == completed + 1
+
+    def test_run_until_stops_at_simulation_budget(
+        self, make_engine: EngineFactory
+    ) -> None:
+        """Test run_until with only a simulation budget runs exactly that many."""
+        engine = make_engine()
+        assert engine.run_until(50) == 50
+        assert engine.get_visit_count() == 51
+
+    def test_run_until_cancelled_token(self, make_engine: EngineFactory) -> None:
+        """Test a pre-set cancel token stops the search before any simulation."""
+        engine = make_engine()
+        token = _corridors_mcts.cancel_token()
+        token.set()
+        assert token.is_set()
+        assert engine.run_until(1000, None, token) == 0
+
+        token.clear()
+        assert not token.is_set()
+        assert engine.run_until(10, None, token) == 10
+
+    def test_cancel_from_another_thread(self, make_engine: EngineFactory) -> None:
+        """Test the search releases the GIL so another thread can cancel it."""
+        engine = make_engine()
+        token = _corridors_mcts.cancel_token()
+        timer = threading.Timer(0.2, token.set)
+        timer.start()
+        try:
+            start = time.monotonic()
+            completed = engine.run_until(10_000_000, 30_000.0, token)
+            elapsed = time.monotonic() - start
+        finally:
+            timer.cancel()
+
+        assert 0 < completed < 10_000_000
+        assert elapsed < 5.0
+
+
+@cpp
+@mcts
+class TestSubtreeReuse:
+    """Test that make_move keeps the statistics of the chosen subtree."""
+
+    def test_make_move_keeps_child_visits(self, make_engine: EngineFactory) -> None:
+        """Test the new root starts with the visits its subtree already had."""
+        engine = make_engine()
+        for flip in (True, False, True):
+            engine.run_until(300)
+            visits, _, action = engine.get_sorted_actions(flip)[0]
+            engine.make_move(action, flip)
+            assert engine.get_visit_count() == visits
+
+        # the reused subtree can still be searched and extended
+        assert engine.run_until(50) == 50
+        assert engine.get_visit_count() >= 50
+
+    def test_tree_reuse_report(self, make_engine: EngineFactory) -> None:
+        """Test get_tree_reuse accounts for the visits kept and discarded."""
+        engine = make_engine()
+        assert engine.get_tree_reuse() == (0, 0)
+        engine.run_until(300)
+        before = engine.get_visit_count()
+        visits, _, action = engine.get_sorted_actions(True)[0]
+        engine.make_move(action, True)
+        assert engine.get_tree_reuse() == (visits, before - visits)
+
+    def test_choose_best_action_keeps_subtree(self, make_engine: EngineFactory) -> None:
+        """Test choosing a move doesn't throw away its subtree before it's played."""
+        engine = make_engine()
+        engine.run_until(300)
+        visits = {a[2]: a[0] for a in engine.get_sorted_actions(False)}
+        best = engine.choose_best_action()
+        assert visits[best] > 0
+        engine.make_move(best, False)
+        assert engine.get_visit_count() == visits[best]
+
+    def test_background_reclaim(self, make_engine: EngineFactory) -> None:
+        """Test moves behave the same when old trees are freed in the background."""
+        engines = [make_engine(background_reclaim=b) for b in (False, True)]
+        for _ in range(3):
+            for engine in engines:
+                engine.run_until(300)
+                engine.make_move(engine.get_sorted_actions(True)[0][2], True)
+            assert engines[0].get_tree_reuse() == engines[1].get_tree_reuse()
+            assert engines[0].display() == engines[1].display()
+        engines[1].wait_for_reclaim()
+        engines[1].reset_to_initial_state()
+        assert engines[1].run_until(50) == 50
+
+
+@cpp
+@mcts
+class TestPondering:
+    """Test searching in the background between moves."""
+
+    def test_ponder_until_stopped(self, make_engine: EngineFactory) -> None:
+        """Test the background search runs until stopped, and can be queried."""
+        engine = make_engine()
+        engine.start_pondering()
+        assert engine.is_pondering()
+        time.sleep(0.2)
+        assert engine.get_visit_count() > 1
+        assert len(engine.get_sorted_actions(True)) > 0
+        pondered = engine.stop_pondering()
+        assert not engine.is_pondering()
+        assert pondered > 0
+        assert engine.get_visit_count() == pondered + 1
+        assert engine.stop_pondering() == pondered  # stopping again is harmless
+
+    def test_ponder_budget(self, make_engine: EngineFactory) -> None:
+        """Test the background search stops by itself once its budget is spent."""
+        engine = make_engine()
+        engine.start_pondering(100)
+        deadline = time.time() + 10
+        while engine.is_pondering() and time.time() < deadline:
+            time.sleep(0.01)
+        assert engine.stop_pondering() == 100
+        assert engine.get_visit_count() == 101
+
+    def test_make_move_keeps_pondered_subtree(self, make_engine: EngineFactory) -> None:
+        """Test the opponent's move stops pondering and keeps what was searched."""
+        engine = make_engine()
+        engine.run_until(100)
+        engine.make_move(engine.get_sorted_actions(True)[0][2], True)
+        engine.start_pondering()
+        time.sleep(0.2)
+        # (stop first only so that the visit count doesn't move under us)
+        engine.stop_pondering()
+        visits, _, reply = engine.get_sorted_actions(True)[0]
+        engine.start_pondering()
+        engine.make_move(reply, True)
+        assert not engine.is_pondering()
+        assert engine.get_visit_count() >= visits
+        assert engine.run_until(50) == 50
+
+    def test_search_stops_pondering(self, make_engine: EngineFactory) -> None:
+        """Test a foreground search takes over from the background one."""
+        engine = make_engine()
+        engine.start_pondering()
+        assert engine.run_until(50) == 50
+        assert not engine.is_pondering()
+        engine.start_pondering()
+        del engine  # the background search is stopped with the engine
+
+
+@cpp
+@mcts
+class TestTensorExport:
+    """Test the NumPy views of positions and visit distributions."""
+
+    def test_starting_position_planes(self, make_engine: EngineFactory) -> None:
+        """Test the planes of the starting position, from the side to move."""
+        engine = make_engine()
+        planes = engine.to_planes()
+        assert planes.dtype == np.float32
+        assert planes.shape == (6, 9, 9)
+        assert planes[0, 0, 4] == 1.0 and planes[0].sum() == 1.0  # hero at the bottom
+        assert planes[1, 8, 4] == 1.0 and planes[1].sum() == 1.0  # villain at the top
+        assert planes[2:4].sum() == 0.0  # no walls
+        assert np.all(planes[4:6] == 1.0)  # all walls remaining
+
+    def test_planes_follow_walls_and_side_to_move(
+        self, make_engine: EngineFactory
+    ) -> None:
+        """Test a wall shows up in the planes, rotated for the other player."""
+        engine = make_engine()
+        engine.make_move("H(0,0)", True)
+        planes = engine.to_planes()
+        # the wall was placed by the previous player, so it appears rotated 180 degrees
+        assert planes[2].sum() == 1.0 and planes[2, 7, 7] == 1.0
+        assert planes[3].sum() == 0.0
+        assert np.all(planes[4] == 1.0)  # the side to move still has all its walls
+        assert np.allclose(planes[5], 0.9)
+
+    def test_visit_policy_matches_sorted_actions(
+        self, make_engine: EngineFactory
+    ) -> None:
+        """Test the visit policy holds the same counts as get_sorted_actions."""
+        engine = make_engine()
+        engine.run_until(300)
+        visits = engine.get_visit_policy()
+        assert visits.dtype == np.float32
+        assert visits.shape == (209,)
+        assert visits.sum() == engine.get_visit_count() - 1
+        assert np.count_nonzero(visits) <= len(engine.get_legal_moves())
+        counts = sorted((int(a[0]) for a in engine.get_sorted_actions(True)), reverse=True)
+        assert sorted(visits[visits > 0].astype(int).tolist(), reverse=True) == [
+            c for c in counts if c > 0
+        ]
+
+    def test_arrays_outlive_the_engine(self, make_engine: EngineFactory) -> None:
+        """Test the returned arrays own their buffers."""
+        engine = make_engine()
+        planes = engine.to_planes()
+        first = engine.to_planes()
+        del engine
+        assert planes[0].sum() == 1.0
+        assert not np.shares_memory(planes, first)
+
+
+@cpp
+@mcts
+class TestBatchEvaluator:
+    """Test evaluating leaves in batches through a Python model."""
+
+    def test_batches_are_encoded_and_bounded(self, make_engine: EngineFactory) -> None:
+        """Test the model sees encoded batches no bigger than batch_size."""
+        batch_sizes: List[int] = []
+
+        def evaluate(planes: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+            assert planes.dtype == np.float32
+            assert planes.shape[1:] == (6, 9, 9)
+            # each position has exactly one pawn per player
+            assert np.all(planes[:, 0].sum(axis=(1, 2)) == 1.0)
+            assert np.all(planes[:, 1].sum(axis=(1, 2)) == 1.0)
+            batch_sizes.append(planes.shape[0])
+            count = planes.shape[0]
+            return np.zeros(count, np.float32), np.ones((count, 209), np.float32)
+
+        engine = make_engine(c=1.0, seed=42, use_puct=True, use_probs=True)
+        engine.set_evaluator(evaluate, 8)
+        assert engine.run_until(300) == 300
+
+        assert max(batch_sizes) <= 8
+        assert max(batch_sizes) > 1
+        assert sum(batch_sizes) <= 301  # the root, plus at most one leaf per simulation
+        actions = engine.get_sorted_actions(True)
+        assert sum(a[0] for a in actions) == engine.get_visit_count() - 1
+
+        # rollouts take over again once the evaluator is cleared
+        engine.clear_evaluator()
+        calls = len(batch_sizes)
+        assert engine.run_until(50) == 50
+        assert len(batch_sizes) == calls
+
+    def test_evaluator_errors_propagate(self, make_engine: EngineFactory) -> None:
+        """Test an exception in the model surfaces from the search."""
+
+        def evaluate(planes: np.ndarray) -> Tuple[np.ndarray, np.ndarray]:
+            raise ValueError("model failure")
+
+        engine = make_engine(c=1.0, seed=42, use_puct=True, use_probs=True)
+        engine.set_evaluator(evaluate, 4)
+        with pytest.raises(RuntimeError, match="model failure"):
+            engine.run_until(10)
+
+
+@cpp
+@mcts
+class TestActionIds:
+    """Test the integer action ids alongside the string action API."""
+
+    def test_id_text_round_trip(self) -> None:
+        """Test every action id maps to a distinct string and back."""
+        cls = _corridors_mcts._corridors_mcts
+        texts = [cls.action_id_to_text(i) for i in range(209)]
+        assert len(set(texts)) == 209
+        assert texts[0] == "*(0,0)" and texts[80] == "*(8,8)"
+        assert texts[81] == "H(0,0)" and texts[145] == "V(0,0)"
+        assert texts[208] == "V(7,7)"
+        assert [cls.action_text_to_id(t) for t in texts] == list(range(209))
+        for bad in ["", "*(9,0)", "H(8,0)", "X(1,1)", "*(1,1", "h(0,0)"]:
+            with pytest.raises(RuntimeError):
+                cls.action_text_to_id(bad)
+        with pytest.raises(RuntimeError):
+            cls.action_id_to_text(209)
+
+    @pytest.mark.parametrize("flip", [False, True])
+    def test_legal_ids_match_legal_moves(
+        self, make_engine: EngineFactory, flip: bool
+    ) -> None:
+        """Test the legal action ids name the same moves as get_legal_moves."""
+        engine = make_engine()
+        for move in ["*(4,1)", "*(4,1)", "H(3,3)", "V(5,2)"]:
+            ids = engine.get_legal_action_ids(flip)
+            texts = [engine.action_id_to_text(i) for i in ids]
+            assert texts == engine.get_legal_moves(flip)
+            engine.make_move(move, True)
+
+    def test_sorted_action_ids_match_sorted_actions(
+        self, make_engine: EngineFactory
+    ) -> None:
+        """Test get_sorted_action_ids reports the same statistics per move."""
+        engine = make_engine()
+        engine.run_until(200)
+        by_text = {a[2]: a[:2] for a in engine.get_sorted_actions(True)}
+        by_id = {
+            engine.action_id_to_text(a[2]): a[:2]
+            for a in engine.get_sorted_action_ids(True)
+        }
+        assert by_id == by_text
+        counts = [a[0] for a in engine.get_sorted_action_ids(True)]
+        assert sum(counts) == engine.get_visit_count() - 1
+
+    def test_make_move_id(self, make_engine: EngineFactory) -> None:
+        """Test moving by id reaches the same position as moving by string."""
+        by_text = make_engine()
+        by_id = make_engine()
+        for move in ["*(4,1)", "H(0,0)", "V(3,3)"]:
+            by_text.make_move(move, True)
+            by_id.make_move_id(by_id.action_text_to_id(move), True)
+            assert by_id.display() == by_text.display()
+        # the villain has already placed this wall
+        with pytest.raises(RuntimeError, match="Invalid move"):
+            by_id.make_move_id(by_id.action_text_to_id("H(0,0)"), True)
+        with pytest.raises(RuntimeError):
+            by_id.make_move_id(209)
+
+
+@cpp
+@mcts
+class TestMemoryBudget:
+    """Test bounding the memory used by the search tree."""
+
+    def test_memory_usage_grows_with_the_tree(self, make_engine: EngineFactory) -> None:
+        """Test the reported memory use follows the tree."""
+        engine = make_engine(memory_budget_mb=0)
+        in_use, reserved = engine.get_memory_usage()
+        assert 0 < in_use <= reserved
+        engine.run_until(2000)
+        grown, reserved = engine.get_memory_usage()
+        assert in_use < grown <= reserved
+
+    def test_root_parallel_trees_share_the_budget(
+        self, make_engine: EngineFactory
+    ) -> None:
+        """Test each root-parallel tree grows by only its share of the budget."""
+        engine = make_engine(threads=3, parallelism="root", memory_budget_mb=1)
+        assert engine.run_until(20000) == 20000
+        # (this tree's share is a third of the budget, give or take a children block)
+        assert engine.get_memory_usage()[0] < (1 << 20) // 2
+
+    def test_reading_the_root_builds_nothing(self, make_engine: EngineFactory) -> None:
+        """Test listing the root's moves leaves its unsearched children unbuilt."""
+        engine = make_engine()
+        engine.run_until(20)
+        in_use, _ = engine.get_memory_usage()
+        assert len(engine.get_sorted_actions(True)) == 3 + 2 * 8 * 8
+        assert engine.get_memory_usage()[0] == in_use
+
+    def test_search_continues_at_the_budget(self, make_engine: EngineFactory) -> None:
+        """Test the tree stops growing at its budget, but the search carries on."""
+        engine = make_engine(memory_budget_mb=1)
+        assert engine.run_until(20000) == 20000
+        in_use, _ = engine.get_memory_usage()
+        # (a few children blocks may be allocated past the budget)
+        assert in_use < 2 << 20
+        assert sum(a[0] for a in engine.get_sorted_actions(True)) == 20000
+
+        # the budget carries over to the reused subtree
+        engine.make_move(engine.get_sorted_actions(True)[0][2], True)
+        assert engine.run_until(20000) == 20000
+        assert engine.get_memory_usage()[0] < 2 << 20
+
+
+@cpp
+@mcts
+class TestSearchStats:
+    """Test the search counters exposed by get_search_stats."""
+
+    def test_disabled_by_default(self, make_engine: EngineFactory) -> None:
+        """Test nothing is counted unless the engine collects stats."""
+        engine = make_engine(collect_stats=False)
+        engine.run_until(500)
+        stats = engine.get_search_stats()
+        assert "sims_per_second" in stats
+        assert all(value == 0 for value in stats.values())
+
+    @pytest.mark.parametrize("threads", [1, 3])
+    def test_counts_the_search(self, make_engine: EngineFactory, threads: int) -> None:
+        """Test the counters describe the simulations that were run."""
+        engine = make_engine(collect_stats=True, threads=threads)
+        assert engine.run_until(2000) == 2000
+        stats = engine.get_search_stats()
+        assert stats["simulations"] == 2000
+        assert stats["sims_per_second"] > 0
+        assert stats["seconds"] > 0
+        # this early on, each simulation builds one leaf and rolls out from it, as does
+        # the root (simulations abandoned after colliding with another thread are rerun)
+        assert stats["nodes_allocated"] == 2000
+        assert stats["rollouts"] == 2001
+        assert stats["mean_rollout_length"] > 0
+        assert 1 <= stats["mean_depth"] <= stats["max_depth"]
+        # the opening has 131 moves, and later positions about as many
+        assert stats["nodes_expanded"] >= 1
+        assert 100 < stats["mean_branching_factor"] < 140
+        assert stats["exceptions"] == 0
+
+    def test_counts_transpositions(self, make_engine: EngineFactory) -> None:
+        """Test positions reached by another move order take the table's statistics."""
+        engine = make_engine(collect_stats=True, transposition_table_mb=16)
+        assert engine.run_until(2000) == 2000
+        stats = engine.get_search_stats()
+        assert stats["transposition_hits"] > 0
+        # each hit takes the place of a leaf's rollout, and brings the visits behind it
+        assert stats["rollouts"] + stats["transposition_hits"] == 2001
+        assert engine.get_visit_count() >= 2001
+
+    def test_accumulates_until_reset(self, make_engine: EngineFactory) -> None:
+        """Test the counters add up over searches and moves until reset."""
+        engine = make_engine(collect_stats=True)
+        engine.run_until(500)
+        engine.make_move(engine.get_sorted_actions(True)[0][2], True)
+        engine.run_until(300)
+        assert engine.get_search_stats()["simulations"] == 800
+
+        engine.reset_search_stats()
+        assert all(value == 0 for value in engine.get_search_stats().values())
+        engine.run_until(100)
+        assert engine.get_search_stats()["simulations"] == 100
+
+
+@cpp
+@mcts
+class TestParallelism:
+    """Test the ways threads can share a search."""
+
+    def test_root_parallel_adds_up_the_trees(self, make_engine: EngineFactory) -> None:
+        """Test the root's children hold the visits of every thread's tree."""
+        engine = make_engine(threads=3, collect_stats=True, parallelism="root")
+        assert engine.run_until(900) == 900
+        assert engine.get_visit_count() == 901
+        assert sum(a[0] for a in engine.get_sorted_actions(True)) == 900
+        # each tree evaluates its own root
+        assert engine.get_search_stats()["rollouts"] == 903
+
+    def test_leaf_parallel_rolls_out_once_per_thread(
+        self, make_engine: EngineFactory
+    ) -> None:
+        """Test each simulation's evaluation comes from a rollout per thread."""
+        engine = make_engine(threads=3, collect_stats=True, parallelism="leaf")
+        assert engine.run_until(300) == 300
+        assert engine.get_visit_count() == 301
+        assert engine.get_search_stats()["rollouts"] == 3 * 301
+
+    def test_invalid_parallelism(self, make_engine: EngineFactory) -> None:
+        """Test unknown modes, and leaf parallelism without rollouts, are rejected."""
+        with pytest.raises(RuntimeError, match="Unknown parallelism"):
+            make_engine(threads=3, collect_stats=True, parallelism="forest")
+        with pytest.raises(RuntimeError, match="use_rollout"):
+            make_engine(
+                threads=3, collect_stats=True, parallelism="leaf", use_rollout=False
+            )
+
+
+@cpp
+@mcts
+class TestSelfPlay:
+    """Test playing self-play games natively."""
+
+    def test_records(self, make_engine: EngineFactory) -> None:
+        """Test the records describe complete games that replay move by move."""
+        records = make_engine().self_play(4, 30, threads=2)
+        offsets, actions = records["offsets"], records["actions"]
+        visits, outcomes = records["visits"], records["outcomes"]
+        assert offsets.shape == (5,) and offsets[0] == 0
+        assert offsets[-1] == actions.shape[0]
+        assert visits.shape == (actions.shape[0], 209)
+        assert outcomes.shape == (4,) and set(outcomes) <= {-1, 1}
+
+        for game in range(4):
+            replay = make_engine()
+            for move in range(offsets[game], offsets[game + 1]):
+                assert visits[move, actions[move]] > 0
+                replay.make_move_id(int(actions[move]), True)
+            assert replay.is_terminal()
+            # the player who made the last move won
+            moves = offsets[game + 1] - offsets[game]
+            assert outcomes[game] == (1 if moves % 2 == 1 else -1)
+
+    def test_independent_of_threads(self, make_engine: EngineFactory) -> None:
+        """Test the games depend on the engine's seed, not on the number of threads."""
+        serial = make_engine().self_play(3, 20, threads=1)
+        parallel = make_engine().self_play(3, 20, threads=3)
+        for key in ("offsets", "actions", "visits", "outcomes"):
+            assert np.array_equal(serial[key], parallel[key])
+
+    def test_max_moves(self, make_engine: EngineFactory) -> None:
+        """Test games cut short by max_moves are recorded as unfinished."""
+        records = make_engine().self_play(2, 20, max_moves=3)
+        assert list(records["offsets"]) == [0, 3, 6]
+        assert list(records["outcomes"]) == [0, 0]
+
+    def test_leaves_the_tree_alone(self, make_engine: EngineFactory) -> None:
+        """Test self-play doesn't touch the engine's own search."""
+        engine = make_engine()
+        engine.run_until(200)
+        engine.self_play(1, 20)
+        assert engine.get_visit_count() == 201
+
+    def test_cancelled_before_starting(self, make_engine: EngineFactory) -> None:
+        """Test a cancelled run returns no games."""
+        token = _corridors_mcts.cancel_token()
+        token.set()
+        records = make_engine().self_play(2, 20, cancel=token)
+        assert list(records["offsets"]) == [0]
+        assert records["visits"].shape == (0, 209)
+
+    def test_invalid_arguments(self, make_engine: EngineFactory) -> None:
+        """Test bad settings are rejected."""
+        engine = make_engine()
+        with pytest.raises(RuntimeError):
+            engine.self_play(1, 0)
+        with pytest.raises(RuntimeError):
+            engine.self_play(1, 20, epsilon=1.5)
+
+
+@cpp
+@mcts
+class TestEnginePool:
+    """Test sharing one set of threads between many engines' searches."""
+
+    def test_searches_many_engines(self, make_engine: EngineFactory) -> None:
+        """Test each engine's search runs to its budget, reporting through callbacks."""
+        pool = _corridors_mcts.EnginePool(threads=2, quantum=16)
+        assert pool.get_threads() == 2 and pool.get_quantum() == 16
+        engines = [make_engine() for _ in range(4)]
+        results: List[Tuple[int, int, Optional[str]]] = []
+        lock = threading.Lock()
+
+        def callback_for(index: int) -> Callable[[int, Optional[str]], None]:
+            def callback(completed: int, error: Optional[str]) -> None:
+                with lock:
+                    results.append((index, completed, error))
+
+            return callback
+
+        for index, engine in enumerate(engines):
+            pool.search(engine, 300, callback=callback_for(index))
+        for engine in engines:
+            pool.wait(engine)
+        assert pool.get_searches() == 0
+        # (each callback runs just after its search is done)
+        deadline = time.time() + 10
+        while len(results) < 4 and time.time() < deadline:
+            time.sleep(0.01)
+        assert sorted(results) == [(index, 300, None) for index in range(4)]
+        assert all(engine.get_visit_count() == 301 for engine in engines)
+
+    def test_priority(self, make_engine: EngineFactory) -> None:
+        """Test a higher priority search is run ahead of one already waiting."""
+        pool = _corridors_mcts.EnginePool(threads=1, quantum=8)
+        low, high = make_engine(), make_engine()
+        finished: List[str] = []
+        pool.search(low, 400, callback=lambda n, e: finished.append("low"))
+        pool.search(
+            high, 400, priority=1, callback=lambda n, e: finished.append("high")
+        )
+        pool.wait(low)
+        pool.wait(high)
+        deadline = time.time() + 10
+        while len(finished) < 2 and time.time() < deadline:
+            time.sleep(0.01)
+        assert finished == ["high", "low"]
+
+    def test_cancel_and_deadline(self, make_engine: EngineFactory) -> None:
+        """Test cancelled and timed out searches end early, keeping their visits."""
+        pool = _corridors_mcts.EnginePool(threads=2)
+        cancelled, timed = make_engine(), make_engine()
+        pool.search(cancelled, 10**8)
+        pool.search(timed, 10**8, milliseconds=100)
+        time.sleep(0.1)
+        pool.cancel(cancelled)
+        pool.wait(cancelled)
+        pool.wait(timed)
+        assert 1 < cancelled.get_visit_count() < 10**8
+        assert 1 < timed.get_visit_count() < 10**8
+        assert cancelled.run_until(50) == 50  # the engine is free again
+
+    def test_engine_change_stops_search(self, make_engine: EngineFactory) -> None:
+        """Test changing the engine stops its pooled search first, as with pondering."""
+        pool = _corridors_mcts.EnginePool(threads=1)
+        engine = make_engine()
+        pool.search(engine, 10**8)
+        time.sleep(0.05)
+        engine.make_move(engine.get_sorted_actions(True)[0][2], True)
+        assert pool.get_searches() == 0
+        pool.search(engine, 10**8)
+        del engine  # the search is stopped with the engine
+        assert pool.get_searches() == 0
+
+    def test_invalid_arguments(self, make_engine: EngineFactory) -> None:
+        """Test bad settings are rejected."""
+        with pytest.raises(RuntimeError):
+            _corridors_mcts.EnginePool(quantum=0)
+        with pytest.raises(RuntimeError):
+            _corridors_mcts.EnginePool().search(make_engine(), 0)
+
+
+@cpp
+@mcts
+class TestTreePersistence:
+    """Test saving search trees and loading them back."""
+
+    def test_file_round_trip(self, make_engine: EngineFactory, tmp_path: Path) -> None:
+        """Test a loaded tree has the statistics and position it was saved with."""
+        engine = make_engine()
+        engine.run_until(300)
+        engine.make_move(engine.choose_best_action(), True)
+        engine.run_until(200)
+        path = str(tmp_path / "tree.bin")
+        engine.save_tree(path)
+
+        restored = make_engine()
+        restored.load_tree(path)
+        assert restored.get_visit_count() == engine.get_visit_count()
+        assert restored.get_sorted_actions(True) == engine.get_sorted_actions(True)
+        assert restored.get_legal_action_ids() == engine.get_legal_action_ids()
+        assert restored.display() == engine.display()
+        assert restored.save_tree_bytes() == engine.save_tree_bytes()
+
+        # the search carries on from where it left off
+        assert restored.run_until(100) == 100
+        restored.make_move(restored.choose_best_action(), True)
+
+    def test_bytes_round_trip(self, make_engine: EngineFactory) -> None:
+        """Test a tree can be moved between engines without a file."""
+        engine = make_engine()
+        engine.run_until(200)
+        data = engine.save_tree_bytes()
+        other = make_engine()
+        other.load_tree_bytes(data)
+        assert other.get_visit_count() == 201
+        assert other.get_evaluation() == engine.get_evaluation()
+
+    def test_bad_images_rejected(
+        self, make_engine: EngineFactory, tmp_path: Path
+    ) -> None:
+        """Test missing, truncated, foreign and corrupt images are rejected."""
+        engine = make_engine()
+        engine.run_until(100)
+        data = engine.save_tree_bytes()
+        with pytest.raises(RuntimeError):
+            engine.load_tree(str(tmp_path / "missing.bin"))
+        with pytest.raises(RuntimeError):
+            engine.load_tree_bytes(data[: len(data) // 2])
+        with pytest.raises(RuntimeError):
+            engine.load_tree_bytes(b"not a tree image at all")
+        # the root's position follows the 32 byte header; no position has every bit set
+        corrupt = data[:32] + b"\xff" * 64 + data[96:]
+        with pytest.raises(RuntimeError):
+            engine.load_tree_bytes(corrupt)
+        assert engine.get_visit_count() == 101
+
+    @pytest.mark.asyncio
+    async def test_async_round_trip(
+        self, fast_mcts_params: MCTSParams, tmp_path: Path
+    ) -> None:
+        """Test the async wrapper saves and loads trees."""
+        path = str(tmp_path / "tree.bin")
+        config = MCTSConfig(**fast_mcts_params)
+        async with AsyncCorridorsMCTS(config) as mcts:
+            await mcts.run_simulations_async(150)
+            await mcts.save_tree_async(path)
+        async with AsyncCorridorsMCTS(config) as mcts:
+            await mcts.load_tree_async(path)
+            assert await mcts.get_visit_count_async() == 151
+
+
+@cpp
+@mcts
+class TestOpeningBook:
+    """Test opening books built from saved trees and the engines seeded from them."""
+
+    def _build_book(
+        self, make_engine: EngineFactory, tmp_path: Path
+    ) -> Tuple[_corridors_mcts._corridors_mcts, str]:
+        searched = make_engine()
+        searched.run_until(2000)
+        tree_path = str(tmp_path / "tree.bin")
+        searched.save_tree(tree_path)
+        book_path = str(tmp_path / "book.bin")
+        positions = _corridors_mcts._corridors_mcts.build_opening_book(
+            [tree_path], book_path, 100, 4
+        )
+        assert positions >= 1
+        return searched, book_path
+
+    def test_seeded_from_book(self, make_engine: EngineFactory, tmp_path: Path) -> None:
+        """Test a fresh engine starts from the book's statistics without searching."""
+        searched, book_path = self._build_book(make_engine, tmp_path)
+        engine = make_engine()
+        assert engine.set_opening_book(book_path)
+        assert engine.get_visit_count() >= 2000
+        assert engine.run_until(2000) == 0
+        assert engine.choose_best_action() == searched.choose_best_action()
+        assert engine.get_sorted_actions(True) == searched.get_sorted_actions(True)
+
+        # the book's moves are those the search tried, most searched first
+        book_moves = engine.get_book_moves(True)
+        tried = [m for m in searched.get_sorted_actions(True) if m[0] > 0]
+        assert sorted(book_moves) == sorted(tried)
+        assert [m[0] for m in book_moves] == sorted(
+            (m[0] for m in book_moves), reverse=True
+        )
+
+    def test_seeds_later_positions(
+        self, make_engine: EngineFactory, tmp_path: Path
+    ) -> None:
+        """Test positions reached by moves and resets are seeded, and only those."""
+        searched, book_path = self._build_book(make_engine, tmp_path)
+        engine = make_engine()
+        engine.set_opening_book(book_path)
+        visits = engine.get_visit_count()
+
+        best = max(searched.get_sorted_actions(True))
+        engine.make_move(best[2], True)
+        assert engine.get_visit_count() >= best[0] - 1
+        assert engine.get_book_moves(True)
+
+        engine.reset_to_initial_state()
+        assert engine.get_visit_count() == visits
+
+        # a move the search hardly tried leaves the book
+        rare = min(searched.get_sorted_actions(True))
+        assert rare[0] < 100
+        engine.make_move(rare[2], True)
+        assert engine.get_book_moves(True) == []
+
+        engine.reset_to_initial_state()
+        engine.clear_opening_book()
+        assert engine.get_book_moves(True) == []
+        engine.reset_to_initial_state()
+        assert engine.get_visit_count() == 0
+
+    def test_bad_books_rejected(
+        self, make_engine: EngineFactory, tmp_path: Path
+    ) -> None:
+        """Test missing, foreign and truncated books are rejected."""
+        searched, book_path = self._build_book(make_engine, tmp_path)
+        engine = make_engine()
+        with pytest.raises(RuntimeError):
+            engine.set_opening_book(str(tmp_path / "missing.bin"))
+        tree_path = str(tmp_path / "tree.bin")
+        with pytest.raises(RuntimeError):
+            engine.set_opening_book(tree_path)
+        truncated = tmp_path / "truncated.bin"
+        data = Path(book_path).read_bytes()
+        truncated.write_bytes(data[: len(data) // 2])
+        with pytest.raises(RuntimeError):
+            engine.set_opening_book(str(truncated))
+        with pytest.raises(RuntimeError):
+            _corridors_mcts._corridors_mcts.build_opening_book(
+                [book_path], str(tmp_path / "out.bin")
+            )
+        assert engine.get_visit_count() == 0
+
+
+@cpp
+@mcts
+class TestSolver:
+    """Test the positions the search proves won or lost."""
+
+    def test_opening_unsolved(self, make_engine: EngineFactory) -> None:
+        """Test a short search leaves the opening unsolved."""
+        engine = make_engine(collect_stats=True)
+        engine.run_until(500)
+        assert engine.get_proven_result() is None
+        assert engine.get_search_stats()["solved_hits"] == 0
+
+    def test_proofs_follow_the_game(self, make_engine: EngineFactory) -> None:
+        """Test a game is solved before its end, and stays solved as it's played."""
+        engine = make_engine(collect_stats=True)
+        results: List[Optional[int]] = []
+        while not engine.is_terminal():
+            engine.run_until(300)
+            results.append(engine.get_proven_result())
+            engine.make_move(engine.choose_best_action())
+        assert results[-1] == 1
+        first = next(i for i, result in enumerate(results) if result is not None)
+        # the player proven to win keeps a won position with every move it plays, and
+        # its opponent is left with a lost one
+        assert all(
+            result == (1 if (len(results) - 1 - i) % 2 == 0 else -1)
+            for i, result in enumerate(results[first:], first)
+        )
+        stats = engine.get_search_stats()
+        assert stats["non_terminal_eval_hits"] + stats["solved_hits"] > 0
+
+
+@cpp
+@mcts
+class TestEarlyStop:
+    """Test searches that stop once their choice of move is settled."""
+
+    def test_choice_unchanged(self, make_engine: EngineFactory) -> None:
+        """Test stopping once the leader is safe picks what the full search does."""
+        full = make_engine(collect_stats=True, early_stop=0.0)
+        assert full.run_until(5000) == 5000
+        assert full.get_search_stats()["simulations_saved"] == 0
+        engine = make_engine(collect_stats=True, early_stop=1.0)
+        completed = engine.run_until(5000)
+        saved = engine.get_search_stats()["simulations_saved"]
+        assert saved > 0
+        assert completed + saved == 5000
+        assert engine.choose_best_action() == full.choose_best_action()
+
+    def test_proven_position(self, make_engine: EngineFactory) -> None:
+        """Test a search of a position already solved stops at once."""
+        engine = make_engine(collect_stats=True, early_stop=1.0)
+        while engine.get_proven_result() is None:
+            engine.run_until(300)
+            engine.make_move(engine.choose_best_action())
+        engine.reset_search_stats()
+        assert engine.run_for(1000) == 0
+        assert engine.run_until(10000) == 0
+        assert engine.get_search_stats()["simulations_saved"] >= 10000
+
+    def test_bad_factor(self, make_engine: EngineFactory) -> None:
+        """Test factors between 0 and 1 are rejected."""
+        with pytest.raises(RuntimeError):
+            make_engine(collect_stats=True, early_stop=0.5)
+
+    def test_deciding_by_equity(self, make_engine: EngineFactory) -> None:
+        """Test engines choosing moves by equity can't stop on the visit leader."""
+        with pytest.raises(RuntimeError):
+            make_engine(decide_using_visits=False, early_stop=1.0)
+        make_engine(decide_using_visits=False, early_stop=0.0)
+
+
+# (engine class, board size, legal moves at the start: 3 steps, then every wall)
+BOARD_SIZES = [
+    (_corridors_mcts._corridors_mcts_5x5, 5, 3 + 2 * 4 * 4),
+    (_corridors_mcts._corridors_mcts_7x7, 7, 3 + 2 * 6 * 6),
+    (_corridors_mcts._corridors_mcts, 9, 3 + 2 * 8 * 8),
+]
+
+
+@cpp
+@mcts
+class TestBoardSizes:
+    """Test the engines for the smaller boards."""
+
+    @parametrize("engine_class, size, first_moves", BOARD_SIZES)
+    def test_geometry(
+        self,
+        make_engine: EngineFactory,
+        engine_class: Type[_corridors_mcts._corridors_mcts],
+        size: int,
+        first_moves: int,
+    ) -> None:
+        """Test moves, action ids and encodings are sized for the board."""
+        engine = make_engine(engine_class=engine_class)
+        moves = engine.get_legal_moves()
+        assert len(moves) == first_moves
+        for move in moves:
+            limit = size if move[0] == "*" else size - 1
+            assert int(move[2]) < limit and int(move[4]) < limit
+            assert engine.action_id_to_text(engine.action_text_to_id(move)) == move
+        policy_size = size * size + 2 * (size - 1) * (size - 1)
+        assert max(engine.get_legal_action_ids()) < policy_size
+        engine.run_until(200)
+        assert engine.get_visit_policy().shape == (policy_size,)
+        assert engine.to_planes().shape == (6, size, size)
+
+    @parametrize(
+        "engine_class",
+        [_corridors_mcts._corridors_mcts_5x5, _corridors_mcts._corridors_mcts_7x7],
+    )
+    def test_game_ends(
+        self,
+        make_engine: EngineFactory,
+        engine_class: Type[_corridors_mcts._corridors_mcts],
+    ) -> None:
+        """Test a game on a small board plays through to the end."""
+        engine = make_engine(engine_class=engine_class)
+        for _ in range(200):
+            if engine.is_terminal():
+                break
+            engine.run_until(100)
+            engine.make_move(engine.choose_best_action())
+        assert engine.is_terminal()
+
+    def test_trees_keep_to_their_size(self, make_engine: EngineFactory) -> None:
+        """Test a tree saved on one board size can't be loaded on another."""
+        small = _corridors_mcts._corridors_mcts_5x5
+        larger = _corridors_mcts._corridors_mcts_7x7
+        engine = make_engine(engine_class=small)
+        engine.run_until(100)
+        data = engine.save_tree_bytes()
+        with pytest.raises(RuntimeError):
+            make_engine(engine_class=larger).load_tree_bytes(data)
+        other = make_engine(engine_class=small)
+        other.load_tree_bytes(data)
+        assert other.get_visit_count() == 101
+
+    def test_pool_takes_every_size(self, make_engine: EngineFactory) -> None:
+        """Test an EnginePool searches engines of different board sizes together."""
+        pool = _corridors_mcts.EnginePool(threads=2)
+        engines = [make_engine(engine_class=cls) for cls, _, _ in BOARD_SIZES]
+        for engine in engines:
+            pool.search(engine, 200)
+        for engine in engines:
+            pool.wait(engine)
+        assert all(engine.get_visit_count() == 201 for engine in engines)
+
+
+@cpp
+@mcts
+class TestReproducibility:
+    """Test searches replay exactly from their seed and thread count."""
+
+    @parametrize("threads, parallelism", [(1, "tree"), (4, "root"), (4, "leaf")])
+    def test_same_search(
+        self, make_engine: EngineFactory, threads: int, parallelism: str
+    ) -> None:
+        """Test two engines with the same seed search their games identically."""
+        engines = [
+            make_engine(threads=threads, parallelism=parallelism) for _ in range(2)
+        ]
+        for _ in range(3):
+            for engine in engines:
+                engine.run_simulations(500)
+            first, second = engines
+            assert first.get_sorted_actions() == second.get_sorted_actions()
+            action = first.choose_best_action(epsilon=0.5)
+            assert second.choose_best_action(epsilon=0.5) == action
+            for engine in engines:
+                engine.make_move(action)
+
+    def test_self_play_ignores_threads(self, make_engine: EngineFactory) -> None:
+        """Test self-play games come out the same whatever threads play them."""
+        records = [
+            make_engine().self_play(4, 50, threads=threads, max_moves=20)
+            for threads in (1, 3)
+        ]
+        for key in ("offsets", "actions", "visits", "outcomes"):
+            assert np.array_equal(records[0][key], records[1][key])
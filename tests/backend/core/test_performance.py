@@ -16,12 +16,13 @@ These tests verify performance characteristics and handle edge cases:
 - Algorithm efficiency
 """
 
+import asyncio
 import gc
 import time
 
 import pytest
 
-from corridors import AsyncCorridorsMCTS
+from corridors import AsyncCorridorsMCTS, _corridors_mcts
 from corridors.async_mcts import MCTSConfig
 
 
@@ -369,6 +370,163 @@ class TestAlgorithmVariants:
             actions = await mcts_uct.get_sorted_actions_async(flip=True)
             assert len(actions) > 0
 
+    @parametrize("threads", [2, 4])
+    @pytest.mark.asyncio
+    async def test_tree_parallel_search(self, threads: int) -> None:
+        """Test that a tree-parallel search spends exactly the requested budget."""
+        config = MCTSConfig(
+            c=1.0,
+            seed=42,
+            min_simulations=100,
+            max_simulations=1000,
+            sim_increment=50,
+            use_rollout=True,
+            eval_children=False,
+            use_puct=False,
+            use_probs=False,
+            decide_using_visits=True,
+            threads=threads,
+        )
+        async with AsyncCorridorsMCTS(config) as mcts_parallel:
+            await mcts_parallel.ensure_sims_async(500)
+
+            actions = await mcts_parallel.get_sorted_actions_async(flip=True)
+            assert len(actions) > 0
+
+            # Root gets one visit for its own evaluation, plus one per simulation
+            visits = await mcts_parallel.get_visit_count_async()
+            assert visits >= 500
+            assert sum(a[0] for a in actions) == visits - 1
+
+            # Tree stays usable for normal play afterwards
+            best = await mcts_parallel.choose_best_action_async(0.0)
+            assert isinstance(best, str)
+
+    @parametrize("parallelism", ["root", "leaf"])
+    @pytest.mark.asyncio
+    async def test_root_and_leaf_parallel_search(self, parallelism: str) -> None:
+        """Test that the other parallel modes leave the tree as a serial search would."""
+        config = MCTSConfig(
+            c=1.0,
+            seed=42,
+            min_simulations=100,
+            max_simulations=1000,
+            sim_increment=50,
+            use_rollout=True,
+            eval_children=False,
+            use_puct=False,
+            use_probs=False,
+            decide_using_visits=True,
+            threads=3,
+            parallelism=parallelism,
+        )
+        async with AsyncCorridorsMCTS(config) as mcts_parallel:
+            await mcts_parallel.ensure_sims_async(500)
+
+            # (in root mode, the other trees' root visits are added to this one's)
+            actions = await mcts_parallel.get_sorted_actions_async(flip=True)
+            visits = await mcts_parallel.get_visit_count_async()
+            assert visits >= 500
+            assert sum(a[0] for a in actions) == visits - 1
+
+            evaluation = await mcts_parallel.get_evaluation_async()
+            assert evaluation is not None and -1.0 <= evaluation <= 1.0
+
+            best = await mcts_parallel.choose_best_action_async(0.0)
+            assert isinstance(best, str)
+            await mcts_parallel.ensure_sims_async(200)
+
+    @pytest.mark.asyncio
+    async def test_shared_engine_pool(self) -> None:
+        """Test that many instances can search at once on one shared pool of threads."""
+        pool = _corridors_mcts.EnginePool(threads=2, quantum=32)
+        instances = [
+            AsyncCorridorsMCTS(
+                MCTSConfig(seed=seed, max_simulations=1000, priority=seed % 2), pool
+            )
+            for seed in range(1, 7)
+        ]
+        try:
+            completed = await asyncio.gather(
+                *(instance.run_simulations_async(200) for instance in instances)
+            )
+            assert completed == [200] * len(instances)
+            for instance in instances:
+                assert await instance.get_visit_count_async() == 201
+
+            # a timed out search comes back with what it managed
+            timed = await instances[0].run_simulations_async(10**8, timeout=0.1)
+            assert 0 < timed < 10**8
+        finally:
+            for instance in instances:
+                await instance.cleanup()
+        assert pool.get_searches() == 0
+
+    @pytest.mark.asyncio
+    async def test_transposition_table_search(self) -> None:
+        """Test that searching with a transposition table keeps the tree consistent."""
+        config = MCTSConfig(
+            c=1.0,
+            seed=42,
+            min_simulations=100,
+            max_simulations=1000,
+            sim_increment=50,
+            use_rollout=True,
+            eval_children=False,
+            use_puct=False,
+            use_probs=False,
+            decide_using_visits=True,
+            transposition_table_mb=4,
+        )
+        async with AsyncCorridorsMCTS(config) as mcts_tt:
+            for _ in range(3):
+                await mcts_tt.ensure_sims_async(300)
+
+                # Statistics are shared through the table, but visits are still per node
+                actions = await mcts_tt.get_sorted_actions_async(flip=True)
+                visits = await mcts_tt.get_visit_count_async()
+                assert sum(a[0] for a in actions) == visits - 1
+
+                evaluation = await mcts_tt.get_evaluation_async()
+                assert evaluation is not None and -1.0 <= evaluation <= 1.0
+
+                await mcts_tt.choose_best_action_async(0.0)
+
+    @parametrize("rollout_policy", ["random", "shortest_path", "smart_walls"])
+    @pytest.mark.asyncio
+    async def test_rollout_policies(self, rollout_policy: str) -> None:
+        """Test that every rollout policy runs a complete search."""
+        config = MCTSConfig(
+            c=1.0,
+            seed=42,
+            min_simulations=100,
+            max_simulations=1000,
+            sim_increment=50,
+            use_rollout=True,
+            eval_children=False,
+            use_puct=False,
+            use_probs=False,
+            decide_using_visits=True,
+            rollout_policy=rollout_policy,
+            rollout_path_probability=0.7,
+        )
+        async with AsyncCorridorsMCTS(config) as mcts_policy:
+            await mcts_policy.ensure_sims_async(300)
+
+            actions = await mcts_policy.get_sorted_actions_async(flip=True)
+            visits = await mcts_policy.get_visit_count_async()
+            assert sum(a[0] for a in actions) == visits - 1
+
+            evaluation = await mcts_policy.get_evaluation_async()
+            assert evaluation is not None and -1.0 <= evaluation <= 1.0
+
+    def test_unknown_rollout_policy_rejected(self) -> None:
+        """Test that config validation rejects rollout policies the engine lacks."""
+        with pytest.raises(ValueError):
+            MCTSConfig(rollout_policy="greedy")
+        with pytest.raises(ValueError):
+            MCTSConfig(rollout_path_probability=1.5)
+
 
 @performance
 class TestConcurrencySimulation:
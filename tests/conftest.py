@@ -5,13 +5,13 @@ Pytest configuration and fixtures for MCTS testing.
 # Approach that completely avoids assignment issues by setting up module constants
 import sys
 from math import sqrt
-from typing import Dict, List, Optional, Tuple, TypedDict
+from typing import Dict, List, Optional, Tuple, Type, TypedDict
 
 import numpy as np
 import pytest
 
 # Import the corridors async module - required for all tests
-from corridors import AsyncCorridorsMCTS, ConcurrencyViolationError
+from corridors import AsyncCorridorsMCTS, ConcurrencyViolationError, _corridors_mcts
 from corridors.async_mcts import MCTSConfig
 
 
@@ -79,6 +79,65 @@ def fast_mcts_params() -> MCTSParams:
     }
 
 
+class EngineFactory:
+    """Creates C++ engines from a set of MCTS parameters.
+
+    Keyword arguments override the parameters, or set the engine's other options.
+    """
+
+    def __init__(self, params: MCTSParams) -> None:
+        self.params = params
+
+    def __call__(
+        self,
+        *,
+        engine_class: Type[_corridors_mcts._corridors_mcts] = (
+            _corridors_mcts._corridors_mcts
+        ),
+        c: Optional[float] = None,
+        seed: Optional[int] = None,
+        use_rollout: Optional[bool] = None,
+        use_puct: Optional[bool] = None,
+        use_probs: Optional[bool] = None,
+        decide_using_visits: Optional[bool] = None,
+        threads: int = 1,
+        transposition_table_mb: int = 0,
+        background_reclaim: bool = False,
+        memory_budget_mb: int = 0,
+        collect_stats: bool = False,
+        parallelism: str = "tree",
+        early_stop: float = 0.0,
+    ) -> _corridors_mcts._corridors_mcts:
+        """Create an engine."""
+        params = self.params
+        return engine_class(
+            params["c"] if c is None else c,
+            params["seed"] if seed is None else seed,
+            params["use_rollout"] if use_rollout is None else use_rollout,
+            params["eval_children"],
+            params["use_puct"] if use_puct is None else use_puct,
+            params["use_probs"] if use_probs is None else use_probs,
+            (
+                params["decide_using_visits"]
+                if decide_using_visits is None
+                else decide_using_visits
+            ),
+            threads=threads,
+            transposition_table_mb=transposition_table_mb,
+            background_reclaim=background_reclaim,
+            memory_budget_mb=memory_budget_mb,
+            collect_stats=collect_stats,
+            parallelism=parallelism,
+            early_stop=early_stop,
+        )
+
+
+@pytest.fixture
+def make_engine(fast_mcts_params: MCTSParams) -> EngineFactory:
+    """Create C++ engines with the fast parameters (see EngineFactory)."""
+    return EngineFactory(fast_mcts_params)
+
+
 @pytest.fixture
 def puct_mcts_params() -> MCTSParams:
     """PUCT-style MCTS parameters."""
@@ -11,6 +11,7 @@ def build(
     profile: bool = False,
     sanitize: bool = False,
     test: bool = False,
+    bench: bool = False,
 ) -> None:
     """Build the C++ backend using SCons with proper target.
 
@@ -19,6 +20,7 @@ def build(
         profile: Enable profiling build with gprof
         sanitize: Enable AddressSanitizer build
         test: Build test executable instead of shared library
+        bench: Build the Google Benchmark executable instead of shared library
     """
     # Ensure we're in Docker container
     if not os.environ.get("DOCKER_CONTAINER"):
@@ -42,6 +44,8 @@ def build(
     if test:
         # For test builds, use default target location
         cmd = ["scons", "test=1"]
+    elif bench:
+        cmd = ["scons", "bench=1"]
     else:
         # For library builds, always use the volume mount target
         cmd = ["scons", f"target={target_dir}/_corridors_mcts"]
@@ -69,6 +73,12 @@ def build(
             print("✅ Backend test executable built successfully")
         else:
             print("Warning: Test executable not found after build")
+    elif bench:
+        bench_exe = Path("_corridors_bench")
+        if bench_exe.exists():
+            print("✅ Backend benchmark executable built successfully")
+        else:
+            print("Warning: Benchmark executable not found after build")
     else:
         so_file = target_dir / "_corridors_mcts.so"
         if so_file.exists():
@@ -102,11 +112,15 @@ def clean() -> None:
             sconsign_file.unlink()
             print("Removed SCons database file")
 
-        # Remove test executable if it exists
+        # Remove test and benchmark executables if they exist
         test_exe = Path("_corridors_mcts")
         if test_exe.exists():
             test_exe.unlink()
             print("Removed test executable")
+        bench_exe = Path("_corridors_bench")
+        if bench_exe.exists():
+            bench_exe.unlink()
+            print("Removed benchmark executable")
 
     print("✅ Backend build cleaned")
 
@@ -142,6 +156,28 @@ def test() -> None:
     build(test=True)
 
 
+def bench() -> None:
+    """Build and run the backend benchmarks, saving the results as JSON.
+
+    Two result files can be compared with Google Benchmark's tools/compare.py.
+    """
+    print("Building backend benchmarks...")
+    build(bench=True)
+
+    output = Path("/opt/mcts/backend-build/bench.json")
+    cmd = [
+        "./_corridors_bench",
+        f"--benchmark_out={output}",
+        "--benchmark_out_format=json",
+    ]
+    print(f"Running benchmarks: {' '.join(cmd)}")
+    result = subprocess.run(cmd)
+    if result.returncode != 0:
+        print("Backend benchmarks failed", file=sys.stderr)
+        sys.exit(result.returncode)
+    print(f"✅ Benchmark results written to {output}")
+
+
 def main() -> None:
     """Main entry point for command-line usage."""
     import argparse
@@ -153,6 +189,9 @@ def main() -> None:
         "--sanitize", action="store_true", help="Enable sanitizer build"
     )
     parser.add_argument("--test", action="store_true", help="Build test executable")
+    parser.add_argument(
+        "--bench", action="store_true", help="Build benchmark executable"
+    )
 
     subparsers = parser.add_subparsers(dest="command", help="Available commands")
     subparsers.add_parser("clean", help="Clean build artifacts")
@@ -170,6 +209,7 @@ def main() -> None:
             profile=args.profile,
             sanitize=args.sanitize,
             test=args.test,
+            bench=args.bench,
         )
 
 
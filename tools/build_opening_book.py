@@ -0,0 +1,103 @@
+#!/usr/bin/env python
+"""
+Build an opening book for the C++ MCTS engine.
+
+Runs a deep search from the initial position and from the positions reached by the
+most searched moves of each search, some moves deep, then merges the saved trees
+into a book that engines load with set_opening_book.
+"""
+
+import argparse
+import sys
+import tempfile
+import time
+from math import sqrt
+from pathlib import Path
+from typing import List, Tuple
+
+from corridors import _corridors_mcts
+
+
+def search_position(
+    moves: List[str], args: argparse.Namespace, tree_path: Path
+) -> List[str]:
+    """Search the position reached by moves, save its tree and return its best moves."""
+    engine = _corridors_mcts._corridors_mcts(
+        args.c,
+        args.seed,
+        True,
+        False,
+        False,
+        False,
+        True,
+        threads=args.threads,
+    )
+    for move in moves:
+        engine.make_move(move)
+    engine.run_until(args.simulations)
+    engine.save_tree(str(tree_path))
+    return [action for _, _, action in engine.get_sorted_actions()[: args.width]]
+
+
+def main() -> int:
+    """Main entry point for the opening book builder."""
+    parser = argparse.ArgumentParser(description="Build an opening book")
+    parser.add_argument("output", help="Book file to write")
+    parser.add_argument(
+        "--simulations",
+        type=int,
+        default=200000,
+        help="Simulations searched from each position",
+    )
+    parser.add_argument(
+        "--width", type=int, default=3, help="Moves followed from each position"
+    )
+    parser.add_argument(
+        "--lines", type=int, default=2, help="How many moves deep to follow them"
+    )
+    parser.add_argument(
+        "--min-visits",
+        type=int,
+        default=1000,
+        help="Leave out positions searched fewer times than this",
+    )
+    parser.add_argument(
+        "--max-depth",
+        type=int,
+        default=8,
+        help="Leave out positions more than this many moves below a search's root",
+    )
+    parser.add_argument("--threads", type=int, default=1, help="Search threads")
+    parser.add_argument("--seed", type=int, default=42, help="Random seed")
+    parser.add_argument("--c", type=float, default=sqrt(2), help="Exploration")
+
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tree_dir:
+        tree_paths: List[str] = []
+        pending: List[Tuple[List[str], int]] = [([], 0)]
+        while pending:
+            moves, depth = pending.pop(0)
+            tree_path = Path(tree_dir) / f"tree{len(tree_paths)}.bin"
+            start = time.perf_counter()
+            best = search_position(moves, args, tree_path)
+            tree_paths.append(str(tree_path))
+            line = " ".join(moves) or "(initial position)"
+            print(f"{line}: {time.perf_counter() - start:.1f}s")
+            if depth < args.lines:
+                pending.extend((moves + [move], depth + 1) for move in best)
+
+        try:
+            positions = _corridors_mcts._corridors_mcts.build_opening_book(
+                tree_paths, args.output, args.min_visits, args.max_depth
+            )
+        except RuntimeError as e:
+            print(f"❌ {e}", file=sys.stderr)
+            return 1
+
+    print(f"✅ Wrote {positions} positions to {args.output}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())